@@ -17,7 +17,10 @@
 #include <shlobj.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <stddef.h>
 #include <string.h>
+#include <ctype.h>
+#include <wctype.h>
 #include <tlhelp32.h>
 #include <psapi.h>
 #include <mmdeviceapi.h>
@@ -25,6 +28,10 @@
 #include <functiondiscoverykeys_devpkey.h>
 #include <endpointvolume.h>
 #include <objbase.h>
+#include <sddl.h>
+#include <io.h>
+
+#include "reset_core.h"
 
 #pragma comment(lib, "ole32.lib")
 #pragma comment(lib, "oleaut32.lib")
@@ -61,25 +68,46 @@ static WCHAR g_recordDefault[256] = L"Microphone (Razer Kraken V4 2.4 - Chat)";
  * This is the "Default Communication Device" in Windows Sound -> Recording tab */
 static WCHAR g_recordComm[256] = L"Microphone (Razer Kraken V4 2.4 - Chat)";
 
+/* Stable endpoint IDs for the four roles above. Resolution tries these first and
+ * only falls back to the friendly names when an ID no longer exists. */
+#define MAX_ENDPOINT_ID 128
+static WCHAR g_playbackDefaultId[MAX_ENDPOINT_ID] = {0};
+static WCHAR g_playbackCommId[MAX_ENDPOINT_ID] = {0};
+static WCHAR g_recordDefaultId[MAX_ENDPOINT_ID] = {0};
+static WCHAR g_recordCommId[MAX_ENDPOINT_ID] = {0};
+
 /* Additional devices to unmute and set to 100% volume after reset */
 static const WCHAR* OUTPUT_RAZER_CHAT = L"Speakers (Razer Kraken V4 2.4 - Chat)";
 static const WCHAR* OUTPUT_RAZER_GAME = L"Speakers (Razer Kraken V4 2.4 - Game)";
 
-/* Timing settings (seconds) */
+/* Timing settings (seconds) - starting points, until reset history
+ * (see Wait Budgets) says how long this machine actually takes */
 static int MAX_SERVICE_WAIT = 30;   /* Max time to wait for audio services */
 static int MAX_DEVICE_WAIT = 60;    /* Max time to wait for Elgato devices */
+static int SETTLE_TIME = 2;         /* Max time to let endpoints settle before setting defaults */
 static int POLL_INTERVAL = 2;       /* How often to check during waits */
+static int MAX_PROCESS_EXIT_WAIT = 5;  /* Max time to wait for killed processes to exit */
 
 /* ========== Globals ========== */
 static char g_logPath[MAX_PATH] = {0};
 static FILE* g_logFile = NULL;
+static CRITICAL_SECTION g_logLock;  /* Reset steps log from several worker threads */
+static int g_logLockReady = 0;
+enum { LOG_DEBUG, LOG_INFO, LOG_WARN, LOG_ERROR };
+static int g_logLevel = LOG_INFO;   /* LOG_LEVEL=debug|info|warn|error */
+static int g_logConsole = 1;        /* Also echo to stdout */
 static char g_waveLinkPath[MAX_PATH] = {0};
 static char g_waveLinkSEPath[MAX_PATH] = {0};
 static char g_streamDeckPath[MAX_PATH] = {0};
 
-/* Saved volume levels for safe reset */
-static float g_savedPlaybackVolume = -1.0f;  /* -1 means not saved */
-static float g_savedCommVolume = -1.0f;
+/* Size and last write time of an exe when its path was cached in config.txt */
+typedef struct ExeStamp {
+    ULONGLONG size;
+    ULONGLONG writeTime;
+} ExeStamp;
+
+static ExeStamp g_waveLinkStamp = {0};
+static ExeStamp g_streamDeckStamp = {0};
 
 /* ========== Audio GUIDs (manually defined) ========== */
 DEFINE_GUID(MY_CLSID_MMDeviceEnumerator, 0xBCDE0395, 0xE52F, 0x467C, 0x8E, 0x3D, 0xC4, 0x57, 0x92, 0x91, 0x69, 0x2E);
@@ -137,12 +165,37 @@ static HWND g_trayHwnd = NULL;
 static const wchar_t* g_trayStatus = L"Starting...";
 static int g_trayAction = 0;  /* 0=none, 1=open config, 2=run reset, 3=exit */
 
-/* ========== Device Lists for GUI ========== */
-#define MAX_DEVICES 32
-static WCHAR g_playbackDeviceNames[MAX_DEVICES][256];
-static WCHAR g_recordDeviceNames[MAX_DEVICES][256];
-static int g_playbackDeviceCount = 0;
-static int g_recordDeviceCount = 0;
+/* ========== Device Registry for GUI ========== */
+/* The endpoints listed in the settings window. A registry is built per
+ * enumeration as one arena: the header, the device table and every ID and
+ * name string are packed into a single block sized for that enumeration, so
+ * any number of endpoints and any name length fit, and replacing the list in
+ * a long-running tray process frees one block instead of many small ones. */
+typedef struct DeviceInfo {
+    const WCHAR* id;
+    const WCHAR* name;
+    EDataFlow dataFlow;
+    DWORD state;                /* DEVICE_STATE_* */
+    UINT formFactor;            /* EndpointFormFactor, UnknownFormFactor if not reported */
+} DeviceInfo;
+
+typedef struct DeviceRegistry {
+    DeviceInfo* devices;        /* Follows the header in the same block */
+    int count;
+} DeviceRegistry;
+
+static DeviceRegistry* g_devices = NULL;  /* Settings window thread only; free() releases it all */
+
+/* Posted to the settings window by the device watch thread; the window frees lParam */
+#define WM_GUI_DEVICES  (WM_APP + 1)    /* DeviceRegistry* */
+#define WM_GUI_DEFAULTS (WM_APP + 2)    /* GuiDefaults* */
+#define WM_GUI_MISMATCH (WM_APP + 3)    /* Posted by the window to itself: ask about a config mismatch */
+
+/* Windows' current defaults, playback/recording x default/comms */
+typedef struct GuiDefaults {
+    WCHAR names[4][256];
+    WCHAR ids[4][MAX_ENDPOINT_ID];
+} GuiDefaults;
 static char g_exeDir[MAX_PATH] = {0};
 static char g_installDir[MAX_PATH] = {0};  /* User-selected install folder */
 static char g_currentExePath[MAX_PATH] = {0};  /* Current exe location */
@@ -150,18 +203,25 @@ static int g_shouldRun = 0;  /* Flag to indicate if we should run reset after GU
 static int g_configExists = 0;  /* Flag to track if config file exists */
 static int g_runInBackground = 0;  /* If true, run silently without GUI */
 static int g_showNotification = 1;  /* If true, show notification on completion */
+static int g_traceEnabled = 0;  /* If true, write a Perfetto trace of the reset (TRACE=1) */
+static int g_tieredReset = 0;  /* If true, escalate from cheap fixes to a full reset (TIERED_RESET=1) */
+static int g_closeGraceMs = 0;  /* WM_CLOSE grace period before terminating apps (CLOSE_GRACE_MS, 0 = off) */
+static int g_watchdogEnabled = 0;  /* If true, the resident instance heals routing drift (WATCHDOG=1) */
+static int g_watchdogDebounceMs = 1500;  /* Quiet time before the watchdog looks (WATCHDOG_DEBOUNCE_MS) */
 
 /* Saved config values (for comparison with current Windows settings) */
 static WCHAR g_savedPlaybackDefault[256] = {0};
 static WCHAR g_savedPlaybackComm[256] = {0};
 static WCHAR g_savedRecordDefault[256] = {0};
 static WCHAR g_savedRecordComm[256] = {0};
+static WCHAR g_savedIds[4][MAX_ENDPOINT_ID] = {0};  /* Same order; empty if the config predates IDs */
 
 /* Current Windows audio settings */
 static WCHAR g_currentPlaybackDefault[256] = {0};
 static WCHAR g_currentPlaybackComm[256] = {0};
 static WCHAR g_currentRecordDefault[256] = {0};
 static WCHAR g_currentRecordComm[256] = {0};
+static WCHAR g_currentIds[4][MAX_ENDPOINT_ID] = {0};
 
 /* ========== Config File Path Helper ========== */
 static void getConfigPath(char* configPath, size_t len) {
@@ -219,10 +279,47 @@ static int loadConfig(const char* exePath) {
         } else if (strcmp(key, "RECORD_COMM") == 0) {
             MultiByteToWideChar(CP_UTF8, 0, value, -1, g_recordComm, 256);
             wcsncpy(g_savedRecordComm, g_recordComm, 256);
+        } else if (strcmp(key, "PLAYBACK_DEFAULT_ID") == 0) {
+            MultiByteToWideChar(CP_UTF8, 0, value, -1, g_playbackDefaultId, MAX_ENDPOINT_ID);
+            wcsncpy(g_savedIds[0], g_playbackDefaultId, MAX_ENDPOINT_ID);
+        } else if (strcmp(key, "PLAYBACK_COMM_ID") == 0) {
+            MultiByteToWideChar(CP_UTF8, 0, value, -1, g_playbackCommId, MAX_ENDPOINT_ID);
+            wcsncpy(g_savedIds[1], g_playbackCommId, MAX_ENDPOINT_ID);
+        } else if (strcmp(key, "RECORD_DEFAULT_ID") == 0) {
+            MultiByteToWideChar(CP_UTF8, 0, value, -1, g_recordDefaultId, MAX_ENDPOINT_ID);
+            wcsncpy(g_savedIds[2], g_recordDefaultId, MAX_ENDPOINT_ID);
+        } else if (strcmp(key, "RECORD_COMM_ID") == 0) {
+            MultiByteToWideChar(CP_UTF8, 0, value, -1, g_recordCommId, MAX_ENDPOINT_ID);
+            wcsncpy(g_savedIds[3], g_recordCommId, MAX_ENDPOINT_ID);
         } else if (strcmp(key, "RUN_IN_BACKGROUND") == 0) {
             g_runInBackground = (strcmp(value, "1") == 0 || _stricmp(value, "true") == 0);
         } else if (strcmp(key, "SHOW_NOTIFICATION") == 0) {
             g_showNotification = (strcmp(value, "1") == 0 || _stricmp(value, "true") == 0);
+        } else if (strcmp(key, "TRACE") == 0) {
+            g_traceEnabled = (strcmp(value, "1") == 0 || _stricmp(value, "true") == 0);
+        } else if (strcmp(key, "LOG_LEVEL") == 0) {
+            const char* levels[] = { "debug", "info", "warn", "error" };
+            for (int i = 0; i < 4; i++) {
+                if (_stricmp(value, levels[i]) == 0) g_logLevel = i;
+            }
+        } else if (strcmp(key, "TIERED_RESET") == 0) {
+            g_tieredReset = (strcmp(value, "1") == 0 || _stricmp(value, "true") == 0);
+        } else if (strcmp(key, "CLOSE_GRACE_MS") == 0) {
+            g_closeGraceMs = atoi(value);
+            if (g_closeGraceMs < 0) g_closeGraceMs = 0;
+        } else if (strcmp(key, "WATCHDOG") == 0) {
+            g_watchdogEnabled = (strcmp(value, "1") == 0 || _stricmp(value, "true") == 0);
+        } else if (strcmp(key, "WATCHDOG_DEBOUNCE_MS") == 0) {
+            g_watchdogDebounceMs = atoi(value);
+            if (g_watchdogDebounceMs < 100) g_watchdogDebounceMs = 100;
+        } else if (strcmp(key, "WAVELINK_PATH") == 0) {
+            strncpy(g_waveLinkPath, value, MAX_PATH - 1);
+        } else if (strcmp(key, "WAVELINK_STAMP") == 0) {
+            sscanf(value, "%llu:%llu", &g_waveLinkStamp.size, &g_waveLinkStamp.writeTime);
+        } else if (strcmp(key, "STREAMDECK_PATH") == 0) {
+            strncpy(g_streamDeckPath, value, MAX_PATH - 1);
+        } else if (strcmp(key, "STREAMDECK_STAMP") == 0) {
+            sscanf(value, "%llu:%llu", &g_streamDeckStamp.size, &g_streamDeckStamp.writeTime);
         }
     }
     
@@ -294,19 +391,9 @@ static int moveToInstallDir(void) {
 }
 
 /* ========== Save Config File ========== */
-static void saveConfig(void) {
-    /* First, move files to install dir if it changed */
-    if (g_installDir[0] != '\0') {
-        moveToInstallDir();
-        /* Use install dir for config */
-        strncpy(g_exeDir, g_installDir, MAX_PATH);
-    }
-    
-    /* Create logs subfolder */
-    char logDir[MAX_PATH];
-    snprintf(logDir, MAX_PATH, "%s\\logs", g_exeDir);
-    CreateDirectoryA(logDir, NULL);
-    
+/* Write the current settings to config.txt in g_exeDir. Also used by the reset
+ * path to record refreshed endpoint IDs, so it never moves files. */
+static void writeConfigFile(void) {
     char configPath[MAX_PATH];
     getConfigPath(configPath, MAX_PATH);
     
@@ -330,324 +417,203 @@ static void saveConfig(void) {
     fprintf(f, "RECORD_DEFAULT=%s\n", buf);
     WideCharToMultiByte(CP_UTF8, 0, g_recordComm, -1, buf, sizeof(buf), NULL, NULL);
     fprintf(f, "RECORD_COMM=%s\n", buf);
+    
+    /* Endpoint IDs survive device renames; names remain the fallback */
+    const WCHAR* ids[] = { g_playbackDefaultId, g_playbackCommId, g_recordDefaultId, g_recordCommId };
+    const char* idKeys[] = { "PLAYBACK_DEFAULT_ID", "PLAYBACK_COMM_ID", "RECORD_DEFAULT_ID", "RECORD_COMM_ID" };
+    for (int i = 0; i < 4; i++) {
+        if (!ids[i][0]) continue;
+        WideCharToMultiByte(CP_UTF8, 0, ids[i], -1, buf, sizeof(buf), NULL, NULL);
+        fprintf(f, "%s=%s\n", idKeys[i], buf);
+    }
     fprintf(f, "RUN_IN_BACKGROUND=%d\n", g_runInBackground ? 1 : 0);
     fprintf(f, "SHOW_NOTIFICATION=%d\n", g_showNotification ? 1 : 0);
+    if (g_traceEnabled) fprintf(f, "TRACE=1\n");
+    if (g_tieredReset) fprintf(f, "TIERED_RESET=1\n");
+    if (g_closeGraceMs > 0) fprintf(f, "CLOSE_GRACE_MS=%d\n", g_closeGraceMs);
+    if (g_watchdogEnabled) fprintf(f, "WATCHDOG=1\n");
+    if (g_watchdogDebounceMs != 1500) fprintf(f, "WATCHDOG_DEBOUNCE_MS=%d\n", g_watchdogDebounceMs);
+    if (g_logLevel != LOG_INFO) {
+        const char* levels[] = { "debug", "info", "warn", "error" };
+        fprintf(f, "LOG_LEVEL=%s\n", levels[g_logLevel]);
+    }
+    
+    /* Discovered install paths, reused while the exe is unchanged */
+    if (g_waveLinkPath[0] && g_waveLinkStamp.size) {
+        fprintf(f, "WAVELINK_PATH=%s\n", g_waveLinkPath);
+        fprintf(f, "WAVELINK_STAMP=%llu:%llu\n", g_waveLinkStamp.size, g_waveLinkStamp.writeTime);
+    }
+    if (g_streamDeckPath[0] && g_streamDeckStamp.size) {
+        fprintf(f, "STREAMDECK_PATH=%s\n", g_streamDeckPath);
+        fprintf(f, "STREAMDECK_STAMP=%llu:%llu\n", g_streamDeckStamp.size, g_streamDeckStamp.writeTime);
+    }
     
     fclose(f);
 }
 
-/* ========== Enumerate Audio Devices for GUI ========== */
-static void enumerateDevicesForGUI(void) {
-    HRESULT hr = CoInitializeEx(NULL, COINIT_APARTMENTTHREADED);
-    if (FAILED(hr) && hr != RPC_E_CHANGED_MODE) return;
-    
-    IMMDeviceEnumerator* pEnum = NULL;
-    hr = CoCreateInstance(&MY_CLSID_MMDeviceEnumerator, NULL, CLSCTX_ALL,
-                          &MY_IID_IMMDeviceEnumerator, (void**)&pEnum);
-    if (FAILED(hr)) { CoUninitialize(); return; }
-    
-    /* Get playback devices */
-    IMMDeviceCollection* pCol = NULL;
-    hr = IMMDeviceEnumerator_EnumAudioEndpoints(pEnum, eRender, DEVICE_STATE_ACTIVE, &pCol);
-    if (SUCCEEDED(hr)) {
-        UINT count = 0;
-        IMMDeviceCollection_GetCount(pCol, &count);
-        g_playbackDeviceCount = 0;
-        for (UINT i = 0; i < count && g_playbackDeviceCount < MAX_DEVICES; i++) {
-            IMMDevice* pDev = NULL;
-            if (SUCCEEDED(IMMDeviceCollection_Item(pCol, i, &pDev))) {
-                IPropertyStore* pStore = NULL;
-                if (SUCCEEDED(IMMDevice_OpenPropertyStore(pDev, STGM_READ, &pStore))) {
-                    PROPVARIANT pv;
-                    PropVariantInit(&pv);
-                    if (SUCCEEDED(IPropertyStore_GetValue(pStore, &PKEY_Device_FriendlyName, &pv)) && pv.pwszVal) {
-                        wcsncpy(g_playbackDeviceNames[g_playbackDeviceCount], pv.pwszVal, 255);
-                        g_playbackDeviceCount++;
-                        PropVariantClear(&pv);
-                    }
-                    IPropertyStore_Release(pStore);
-                }
-                IMMDevice_Release(pDev);
-            }
-        }
-        IMMDeviceCollection_Release(pCol);
+static void saveConfig(void) {
+    /* First, move files to install dir if it changed */
+    if (g_installDir[0] != '\0') {
+        moveToInstallDir();
+        /* Use install dir for config */
+        strncpy(g_exeDir, g_installDir, MAX_PATH);
     }
     
-    /* Get recording devices */
-    hr = IMMDeviceEnumerator_EnumAudioEndpoints(pEnum, eCapture, DEVICE_STATE_ACTIVE, &pCol);
-    if (SUCCEEDED(hr)) {
-        UINT count = 0;
-        IMMDeviceCollection_GetCount(pCol, &count);
-        g_recordDeviceCount = 0;
-        for (UINT i = 0; i < count && g_recordDeviceCount < MAX_DEVICES; i++) {
-            IMMDevice* pDev = NULL;
-            if (SUCCEEDED(IMMDeviceCollection_Item(pCol, i, &pDev))) {
-                IPropertyStore* pStore = NULL;
-                if (SUCCEEDED(IMMDevice_OpenPropertyStore(pDev, STGM_READ, &pStore))) {
-                    PROPVARIANT pv;
-                    PropVariantInit(&pv);
-                    if (SUCCEEDED(IPropertyStore_GetValue(pStore, &PKEY_Device_FriendlyName, &pv)) && pv.pwszVal) {
-                        wcsncpy(g_recordDeviceNames[g_recordDeviceCount], pv.pwszVal, 255);
-                        g_recordDeviceCount++;
-                        PropVariantClear(&pv);
-                    }
-                    IPropertyStore_Release(pStore);
-                }
-                IMMDevice_Release(pDev);
-            }
-        }
-        IMMDeviceCollection_Release(pCol);
-    }
+    /* Create logs subfolder */
+    char logDir[MAX_PATH];
+    snprintf(logDir, MAX_PATH, "%s\\logs", g_exeDir);
+    CreateDirectoryA(logDir, NULL);
     
-    /* Get current defaults */
-    IMMDevice* pDefault = NULL;
-    if (SUCCEEDED(IMMDeviceEnumerator_GetDefaultAudioEndpoint(pEnum, eRender, eConsole, &pDefault))) {
-        IPropertyStore* pStore = NULL;
-        if (SUCCEEDED(IMMDevice_OpenPropertyStore(pDefault, STGM_READ, &pStore))) {
-            PROPVARIANT pv;
-            PropVariantInit(&pv);
-            if (SUCCEEDED(IPropertyStore_GetValue(pStore, &PKEY_Device_FriendlyName, &pv)) && pv.pwszVal) {
-                wcsncpy(g_currentPlaybackDefault, pv.pwszVal, 255);
-                /* Only set as default if no config loaded */
-                if (g_savedPlaybackDefault[0] == L'\0') {
-                    wcsncpy(g_playbackDefault, pv.pwszVal, 255);
-                }
-                PropVariantClear(&pv);
-            }
-            IPropertyStore_Release(pStore);
-        }
-        IMMDevice_Release(pDefault);
-    }
-    if (SUCCEEDED(IMMDeviceEnumerator_GetDefaultAudioEndpoint(pEnum, eRender, eCommunications, &pDefault))) {
-        IPropertyStore* pStore = NULL;
-        if (SUCCEEDED(IMMDevice_OpenPropertyStore(pDefault, STGM_READ, &pStore))) {
-            PROPVARIANT pv;
-            PropVariantInit(&pv);
-            if (SUCCEEDED(IPropertyStore_GetValue(pStore, &PKEY_Device_FriendlyName, &pv)) && pv.pwszVal) {
-                wcsncpy(g_currentPlaybackComm, pv.pwszVal, 255);
-                if (g_savedPlaybackComm[0] == L'\0') {
-                    wcsncpy(g_playbackComm, pv.pwszVal, 255);
-                }
-                PropVariantClear(&pv);
-            }
-            IPropertyStore_Release(pStore);
-        }
-        IMMDevice_Release(pDefault);
-    }
-    if (SUCCEEDED(IMMDeviceEnumerator_GetDefaultAudioEndpoint(pEnum, eCapture, eConsole, &pDefault))) {
-        IPropertyStore* pStore = NULL;
-        if (SUCCEEDED(IMMDevice_OpenPropertyStore(pDefault, STGM_READ, &pStore))) {
-            PROPVARIANT pv;
-            PropVariantInit(&pv);
-            if (SUCCEEDED(IPropertyStore_GetValue(pStore, &PKEY_Device_FriendlyName, &pv)) && pv.pwszVal) {
-                wcsncpy(g_currentRecordDefault, pv.pwszVal, 255);
-                if (g_savedRecordDefault[0] == L'\0') {
-                    wcsncpy(g_recordDefault, pv.pwszVal, 255);
-                }
-                PropVariantClear(&pv);
-            }
-            IPropertyStore_Release(pStore);
-        }
-        IMMDevice_Release(pDefault);
-    }
-    if (SUCCEEDED(IMMDeviceEnumerator_GetDefaultAudioEndpoint(pEnum, eCapture, eCommunications, &pDefault))) {
-        IPropertyStore* pStore = NULL;
-        if (SUCCEEDED(IMMDevice_OpenPropertyStore(pDefault, STGM_READ, &pStore))) {
-            PROPVARIANT pv;
-            PropVariantInit(&pv);
-            if (SUCCEEDED(IPropertyStore_GetValue(pStore, &PKEY_Device_FriendlyName, &pv)) && pv.pwszVal) {
-                wcsncpy(g_currentRecordComm, pv.pwszVal, 255);
-                if (g_savedRecordComm[0] == L'\0') {
-                    wcsncpy(g_recordComm, pv.pwszVal, 255);
-                }
-                PropVariantClear(&pv);
-            }
-            IPropertyStore_Release(pStore);
-        }
-        IMMDevice_Release(pDefault);
-    }
+    writeConfigFile();
+}
+
+/* ========== Check for Config Mismatch ========== */
+/* By endpoint ID when both sides have one - two devices can share a friendly
+ * name - else by name */
+static int roleMismatch(const WCHAR* savedName, const WCHAR* savedId, const WCHAR* currentName, const WCHAR* currentId) {
+    if (savedId[0] && currentId[0]) return wcscmp(savedId, currentId) != 0;
+    return wcscmp(savedName, currentName) != 0;
+}
+
+static int hasConfigMismatch(void) {
+    if (g_savedPlaybackDefault[0] == L'\0') return 0; /* No saved config */
+    
+    if (roleMismatch(g_savedPlaybackDefault, g_savedIds[0], g_currentPlaybackDefault, g_currentIds[0])) return 1;
+    if (roleMismatch(g_savedPlaybackComm, g_savedIds[1], g_currentPlaybackComm, g_currentIds[1])) return 1;
+    if (roleMismatch(g_savedRecordDefault, g_savedIds[2], g_currentRecordDefault, g_currentIds[2])) return 1;
+    if (roleMismatch(g_savedRecordComm, g_savedIds[3], g_currentRecordComm, g_currentIds[3])) return 1;
     
-    IMMDeviceEnumerator_Release(pEnum);
-    CoUninitialize();
+    return 0;
 }
 
-/* ========== GUI Dialog Procedure ========== */
-static LRESULT CALLBACK ConfigDlgProc(HWND hwnd, UINT msg, WPARAM wParam, LPARAM lParam) {
-    static HWND hComboPlaybackDefault, hComboRecordDefault, hComboPlaybackComm, hComboRecordComm;
-    static HWND hEditFolder, hButtonSave, hButtonRun, hButtonBrowse;
-    static HBRUSH hBrushBg, hBrushEdit;
-    static HFONT hFont, hFontBold, hFontSmall;
+/* ========== Mismatch Dialog IDs ========== */
+#define ID_MISMATCH_RESTORE  501
+#define ID_MISMATCH_KEEP     502
+#define ID_MISMATCH_TITLE    503
+#define ID_MISMATCH_SAVED_HDR    504
+#define ID_MISMATCH_CURRENT_HDR  505
+#define ID_MISMATCH_LABEL_BASE   510  /* 510-517 for blue labels */
+
+static int g_mismatchResult = 0;
+
+/* ========== Mismatch Dialog Procedure ========== */
+static LRESULT CALLBACK MismatchDlgProc(HWND hwnd, UINT msg, WPARAM wParam, LPARAM lParam) {
+    static HFONT hFont, hFontBold, hFontDevice;
+    static HBRUSH hBrushBg;
     
     switch (msg) {
         case WM_CREATE: {
-            /* Dark theme colors */
             hBrushBg = CreateSolidBrush(RGB(30, 30, 30));
-            hBrushEdit = CreateSolidBrush(RGB(45, 45, 45));
             hFont = CreateFontW(16, 0, 0, 0, FW_NORMAL, FALSE, FALSE, FALSE, DEFAULT_CHARSET,
                                OUT_DEFAULT_PRECIS, CLIP_DEFAULT_PRECIS, CLEARTYPE_QUALITY,
                                DEFAULT_PITCH | FF_DONTCARE, L"Segoe UI");
-            hFontBold = CreateFontW(20, 0, 0, 0, FW_BOLD, FALSE, FALSE, FALSE, DEFAULT_CHARSET,
+            hFontBold = CreateFontW(18, 0, 0, 0, FW_BOLD, FALSE, FALSE, FALSE, DEFAULT_CHARSET,
                                    OUT_DEFAULT_PRECIS, CLIP_DEFAULT_PRECIS, CLEARTYPE_QUALITY,
                                    DEFAULT_PITCH | FF_DONTCARE, L"Segoe UI");
-            hFontSmall = CreateFontW(14, 0, 0, 0, FW_NORMAL, FALSE, FALSE, FALSE, DEFAULT_CHARSET,
-                                    OUT_DEFAULT_PRECIS, CLIP_DEFAULT_PRECIS, CLEARTYPE_QUALITY,
-                                    DEFAULT_PITCH | FF_DONTCARE, L"Segoe UI");
+            hFontDevice = CreateFontW(14, 0, 0, 0, FW_NORMAL, FALSE, FALSE, FALSE, DEFAULT_CHARSET,
+                                     OUT_DEFAULT_PRECIS, CLIP_DEFAULT_PRECIS, CLEARTYPE_QUALITY,
+                                     DEFAULT_PITCH | FF_DONTCARE, L"Segoe UI");
             
             int yPos = 15;
+            int colWidth = 380;
+            int leftCol = 20;
+            int rightCol = 420;
+            int labelHeight = 18;
+            int deviceHeight = 18;
+            int rowSpacing = 12;
             
-            /* Header */
-            HWND hHeader = CreateWindowW(L"STATIC", L"Device Selection",
-                WS_CHILD | WS_VISIBLE, 20, yPos, 460, 25, hwnd, (HMENU)ID_HEADER, NULL, NULL);
-            SendMessage(hHeader, WM_SETFONT, (WPARAM)hFontBold, TRUE);
-            yPos += 30;
+            /* Title */
+            HWND hTitle = CreateWindowW(L"STATIC", 
+                L"Your saved audio configuration differs from current Windows settings.",
+                WS_CHILD | WS_VISIBLE | SS_CENTER, 20, yPos, 760, 20, hwnd, (HMENU)ID_MISMATCH_TITLE, NULL, NULL);
+            SendMessage(hTitle, WM_SETFONT, (WPARAM)hFont, TRUE);
+            yPos += 40;
             
-            /* Subheader */
-            HWND hSubheader = CreateWindowW(L"STATIC", 
-                L"Select your audio devices and choose where to install.",
-                WS_CHILD | WS_VISIBLE, 20, yPos, 460, 20, hwnd, (HMENU)(ID_DESC_START), NULL, NULL);
-            SendMessage(hSubheader, WM_SETFONT, (WPARAM)hFontSmall, TRUE);
-            yPos += 30;
+            /* Column headers */
+            HWND hSavedHeader = CreateWindowW(L"STATIC", L"Saved Configuration",
+                WS_CHILD | WS_VISIBLE | SS_CENTER, leftCol, yPos, colWidth, 24, hwnd, (HMENU)ID_MISMATCH_SAVED_HDR, NULL, NULL);
+            SendMessage(hSavedHeader, WM_SETFONT, (WPARAM)hFontBold, TRUE);
             
-            /* Install Folder */
-            HWND hLabelFolder = CreateWindowW(L"STATIC", L"Install Folder",
-                WS_CHILD | WS_VISIBLE, 20, yPos, 460, 20, hwnd, (HMENU)(ID_LABEL_START), NULL, NULL);
-            SendMessage(hLabelFolder, WM_SETFONT, (WPARAM)hFont, TRUE);
-            HWND hDescFolder = CreateWindowW(L"STATIC", L"Change this to move everything to a new folder",
-                WS_CHILD | WS_VISIBLE, 20, yPos + 18, 460, 18, hwnd, (HMENU)(ID_DESC_START + 5), NULL, NULL);
-            SendMessage(hDescFolder, WM_SETFONT, (WPARAM)hFontSmall, TRUE);
-            hEditFolder = CreateWindowW(L"EDIT", L"",
-                WS_CHILD | WS_VISIBLE | WS_BORDER | ES_AUTOHSCROLL, 20, yPos + 40, 370, 25,
-                hwnd, (HMENU)ID_EDIT_FOLDER, NULL, NULL);
-            SendMessage(hEditFolder, WM_SETFONT, (WPARAM)hFont, TRUE);
-            hButtonBrowse = CreateWindowW(L"BUTTON", L"Browse...",
-                WS_CHILD | WS_VISIBLE | BS_PUSHBUTTON, 400, yPos + 38, 80, 28,
-                hwnd, (HMENU)ID_BUTTON_BROWSE, NULL, NULL);
-            SendMessage(hButtonBrowse, WM_SETFONT, (WPARAM)hFont, TRUE);
-            yPos += 75;
+            HWND hCurrentHeader = CreateWindowW(L"STATIC", L"Current Windows Settings",
+                WS_CHILD | WS_VISIBLE | SS_CENTER, rightCol, yPos, colWidth, 24, hwnd, (HMENU)ID_MISMATCH_CURRENT_HDR, NULL, NULL);
+            SendMessage(hCurrentHeader, WM_SETFONT, (WPARAM)hFontBold, TRUE);
+            yPos += 35;
             
-            /* Default Playback Device */
-            HWND hLabel1 = CreateWindowW(L"STATIC", L"Default Playback Device",
-                WS_CHILD | WS_VISIBLE, 20, yPos, 460, 20, hwnd, (HMENU)(ID_LABEL_START + 1), NULL, NULL);
-            SendMessage(hLabel1, WM_SETFONT, (WPARAM)hFont, TRUE);
-            HWND hDesc1 = CreateWindowW(L"STATIC", L"Where your system audio plays (games, music, videos, notifications)",
-                WS_CHILD | WS_VISIBLE, 20, yPos + 18, 460, 18, hwnd, (HMENU)(ID_DESC_START + 1), NULL, NULL);
-            SendMessage(hDesc1, WM_SETFONT, (WPARAM)hFontSmall, TRUE);
-            hComboPlaybackDefault = CreateWindowW(L"COMBOBOX", NULL,
-                WS_CHILD | WS_VISIBLE | CBS_DROPDOWNLIST | WS_VSCROLL, 20, yPos + 40, 460, 200,
-                hwnd, (HMENU)ID_COMBO_PLAYBACK_DEFAULT, NULL, NULL);
-            SendMessage(hComboPlaybackDefault, WM_SETFONT, (WPARAM)hFont, TRUE);
-            yPos += 75;
+            /* Row 1: Playback Default */
+            CreateWindowW(L"STATIC", L"Playback Default:",
+                WS_CHILD | WS_VISIBLE | SS_LEFT, leftCol, yPos, colWidth, labelHeight, hwnd, (HMENU)(ID_MISMATCH_LABEL_BASE + 0), NULL, NULL);
+            CreateWindowW(L"STATIC", L"Playback Default:",
+                WS_CHILD | WS_VISIBLE | SS_LEFT, rightCol, yPos, colWidth, labelHeight, hwnd, (HMENU)(ID_MISMATCH_LABEL_BASE + 1), NULL, NULL);
+            yPos += labelHeight;
             
-            /* Default Recording Device */
-            HWND hLabel2 = CreateWindowW(L"STATIC", L"Default Recording Device",
-                WS_CHILD | WS_VISIBLE, 20, yPos, 460, 20, hwnd, (HMENU)(ID_LABEL_START + 2), NULL, NULL);
-            SendMessage(hLabel2, WM_SETFONT, (WPARAM)hFont, TRUE);
-            HWND hDesc2 = CreateWindowW(L"STATIC", L"Default microphone for apps that don't specify one",
-                WS_CHILD | WS_VISIBLE, 20, yPos + 18, 460, 18, hwnd, (HMENU)(ID_DESC_START + 2), NULL, NULL);
-            SendMessage(hDesc2, WM_SETFONT, (WPARAM)hFontSmall, TRUE);
-            hComboRecordDefault = CreateWindowW(L"COMBOBOX", NULL,
-                WS_CHILD | WS_VISIBLE | CBS_DROPDOWNLIST | WS_VSCROLL, 20, yPos + 40, 460, 200,
-                hwnd, (HMENU)ID_COMBO_RECORD_DEFAULT, NULL, NULL);
-            SendMessage(hComboRecordDefault, WM_SETFONT, (WPARAM)hFont, TRUE);
-            yPos += 75;
+            HWND hSavedPD = CreateWindowW(L"STATIC", g_savedPlaybackDefault,
+                WS_CHILD | WS_VISIBLE | SS_LEFT, leftCol, yPos, colWidth, deviceHeight, hwnd, NULL, NULL, NULL);
+            SendMessage(hSavedPD, WM_SETFONT, (WPARAM)hFontDevice, TRUE);
+            HWND hCurrentPD = CreateWindowW(L"STATIC", g_currentPlaybackDefault,
+                WS_CHILD | WS_VISIBLE | SS_LEFT, rightCol, yPos, colWidth, deviceHeight, hwnd, NULL, NULL, NULL);
+            SendMessage(hCurrentPD, WM_SETFONT, (WPARAM)hFontDevice, TRUE);
+            yPos += deviceHeight + rowSpacing;
             
-            /* Communications Playback Device */
-            HWND hLabel3 = CreateWindowW(L"STATIC", L"Communications Playback Device",
-                WS_CHILD | WS_VISIBLE, 20, yPos, 460, 20, hwnd, (HMENU)(ID_LABEL_START + 3), NULL, NULL);
-            SendMessage(hLabel3, WM_SETFONT, (WPARAM)hFont, TRUE);
-            HWND hDesc3 = CreateWindowW(L"STATIC", L"Where you hear voice chat (Discord, Teams, Zoom, etc.)",
-                WS_CHILD | WS_VISIBLE, 20, yPos + 18, 460, 18, hwnd, (HMENU)(ID_DESC_START + 3), NULL, NULL);
-            SendMessage(hDesc3, WM_SETFONT, (WPARAM)hFontSmall, TRUE);
-            hComboPlaybackComm = CreateWindowW(L"COMBOBOX", NULL,
-                WS_CHILD | WS_VISIBLE | CBS_DROPDOWNLIST | WS_VSCROLL, 20, yPos + 40, 460, 200,
-                hwnd, (HMENU)ID_COMBO_PLAYBACK_COMM, NULL, NULL);
-            SendMessage(hComboPlaybackComm, WM_SETFONT, (WPARAM)hFont, TRUE);
-            yPos += 75;
+            /* Row 2: Playback Comms */
+            CreateWindowW(L"STATIC", L"Playback Comms:",
+                WS_CHILD | WS_VISIBLE | SS_LEFT, leftCol, yPos, colWidth, labelHeight, hwnd, (HMENU)(ID_MISMATCH_LABEL_BASE + 2), NULL, NULL);
+            CreateWindowW(L"STATIC", L"Playback Comms:",
+                WS_CHILD | WS_VISIBLE | SS_LEFT, rightCol, yPos, colWidth, labelHeight, hwnd, (HMENU)(ID_MISMATCH_LABEL_BASE + 3), NULL, NULL);
+            yPos += labelHeight;
             
-            /* Communications Recording Device */
-            HWND hLabel4 = CreateWindowW(L"STATIC", L"Communications Recording Device",
-                WS_CHILD | WS_VISIBLE, 20, yPos, 460, 20, hwnd, (HMENU)(ID_LABEL_START + 4), NULL, NULL);
-            SendMessage(hLabel4, WM_SETFONT, (WPARAM)hFont, TRUE);
-            HWND hDesc4 = CreateWindowW(L"STATIC", L"Microphone used for voice chat (Discord, Teams, Zoom, etc.)",
-                WS_CHILD | WS_VISIBLE, 20, yPos + 18, 460, 18, hwnd, (HMENU)(ID_DESC_START + 4), NULL, NULL);
-            SendMessage(hDesc4, WM_SETFONT, (WPARAM)hFontSmall, TRUE);
-            hComboRecordComm = CreateWindowW(L"COMBOBOX", NULL,
-                WS_CHILD | WS_VISIBLE | CBS_DROPDOWNLIST | WS_VSCROLL, 20, yPos + 40, 460, 200,
-                hwnd, (HMENU)ID_COMBO_RECORD_COMM, NULL, NULL);
-            SendMessage(hComboRecordComm, WM_SETFONT, (WPARAM)hFont, TRUE);
-            yPos += 75;
+            HWND hSavedPC = CreateWindowW(L"STATIC", g_savedPlaybackComm,
+                WS_CHILD | WS_VISIBLE | SS_LEFT, leftCol, yPos, colWidth, deviceHeight, hwnd, NULL, NULL, NULL);
+            SendMessage(hSavedPC, WM_SETFONT, (WPARAM)hFontDevice, TRUE);
+            HWND hCurrentPC = CreateWindowW(L"STATIC", g_currentPlaybackComm,
+                WS_CHILD | WS_VISIBLE | SS_LEFT, rightCol, yPos, colWidth, deviceHeight, hwnd, NULL, NULL, NULL);
+            SendMessage(hCurrentPC, WM_SETFONT, (WPARAM)hFontDevice, TRUE);
+            yPos += deviceHeight + rowSpacing;
             
-            /* Checkboxes row - two checkboxes side by side */
-            HWND hCheckRunBackground = CreateWindowW(L"BUTTON", L"Run in background",
-                WS_CHILD | WS_VISIBLE | BS_AUTOCHECKBOX, 20, yPos, 200, 20,
-                hwnd, (HMENU)ID_CHECK_RUN_BACKGROUND, NULL, NULL);
-            SendMessage(hCheckRunBackground, WM_SETFONT, (WPARAM)hFont, TRUE);
-            if (g_runInBackground) {
-                SendMessage(hCheckRunBackground, BM_SETCHECK, BST_CHECKED, 0);
-            }
-            
-            HWND hCheckShowNotify = CreateWindowW(L"BUTTON", L"Show completion notification",
-                WS_CHILD | WS_VISIBLE | BS_AUTOCHECKBOX, 225, yPos, 250, 20,
-                hwnd, (HMENU)ID_CHECK_SHOW_NOTIFY, NULL, NULL);
-            SendMessage(hCheckShowNotify, WM_SETFONT, (WPARAM)hFont, TRUE);
-            if (g_showNotification) {
-                SendMessage(hCheckShowNotify, BM_SETCHECK, BST_CHECKED, 0);
-            }
-            yPos += 40;
+            /* Row 3: Recording Default */
+            CreateWindowW(L"STATIC", L"Recording Default:",
+                WS_CHILD | WS_VISIBLE | SS_LEFT, leftCol, yPos, colWidth, labelHeight, hwnd, (HMENU)(ID_MISMATCH_LABEL_BASE + 4), NULL, NULL);
+            CreateWindowW(L"STATIC", L"Recording Default:",
+                WS_CHILD | WS_VISIBLE | SS_LEFT, rightCol, yPos, colWidth, labelHeight, hwnd, (HMENU)(ID_MISMATCH_LABEL_BASE + 5), NULL, NULL);
+            yPos += labelHeight;
             
-            /* Buttons centered with gap between them */
-            /* Window is 520px wide, buttons are 120px each, 20px gap = 260px total */
-            /* Center: (520 - 260) / 2 = 130px from left */
+            HWND hSavedRD = CreateWindowW(L"STATIC", g_savedRecordDefault,
+                WS_CHILD | WS_VISIBLE | SS_LEFT, leftCol, yPos, colWidth, deviceHeight, hwnd, NULL, NULL, NULL);
+            SendMessage(hSavedRD, WM_SETFONT, (WPARAM)hFontDevice, TRUE);
+            HWND hCurrentRD = CreateWindowW(L"STATIC", g_currentRecordDefault,
+                WS_CHILD | WS_VISIBLE | SS_LEFT, rightCol, yPos, colWidth, deviceHeight, hwnd, NULL, NULL, NULL);
+            SendMessage(hCurrentRD, WM_SETFONT, (WPARAM)hFontDevice, TRUE);
+            yPos += deviceHeight + rowSpacing;
             
-            /* Save button - saves config only */
-            hButtonSave = CreateWindowW(L"BUTTON", L"Save",
-                WS_CHILD | WS_VISIBLE | BS_PUSHBUTTON, 130, yPos, 120, 35,
-                hwnd, (HMENU)ID_BUTTON_SAVE, NULL, NULL);
-            SendMessage(hButtonSave, WM_SETFONT, (WPARAM)hFontBold, TRUE);
+            /* Row 4: Recording Comms */
+            CreateWindowW(L"STATIC", L"Recording Comms:",
+                WS_CHILD | WS_VISIBLE | SS_LEFT, leftCol, yPos, colWidth, labelHeight, hwnd, (HMENU)(ID_MISMATCH_LABEL_BASE + 6), NULL, NULL);
+            CreateWindowW(L"STATIC", L"Recording Comms:",
+                WS_CHILD | WS_VISIBLE | SS_LEFT, rightCol, yPos, colWidth, labelHeight, hwnd, (HMENU)(ID_MISMATCH_LABEL_BASE + 7), NULL, NULL);
+            yPos += labelHeight;
             
-            /* Run button - disabled until config exists */
-            hButtonRun = CreateWindowW(L"BUTTON", L"Reset Audio",
-                WS_CHILD | WS_VISIBLE | BS_PUSHBUTTON | (g_configExists ? 0 : WS_DISABLED), 
-                270, yPos, 120, 35,
-                hwnd, (HMENU)ID_BUTTON_RUN, NULL, NULL);
-            SendMessage(hButtonRun, WM_SETFONT, (WPARAM)hFontBold, TRUE);
+            HWND hSavedRC = CreateWindowW(L"STATIC", g_savedRecordComm,
+                WS_CHILD | WS_VISIBLE | SS_LEFT, leftCol, yPos, colWidth, deviceHeight, hwnd, NULL, NULL, NULL);
+            SendMessage(hSavedRC, WM_SETFONT, (WPARAM)hFontDevice, TRUE);
+            HWND hCurrentRC = CreateWindowW(L"STATIC", g_currentRecordComm,
+                WS_CHILD | WS_VISIBLE | SS_LEFT, rightCol, yPos, colWidth, deviceHeight, hwnd, NULL, NULL, NULL);
+            SendMessage(hCurrentRC, WM_SETFONT, (WPARAM)hFontDevice, TRUE);
+            yPos += deviceHeight + 20;
             
-            /* Populate combos with playback devices */
-            for (int i = 0; i < g_playbackDeviceCount; i++) {
-                SendMessageW(hComboPlaybackDefault, CB_ADDSTRING, 0, (LPARAM)g_playbackDeviceNames[i]);
-                SendMessageW(hComboPlaybackComm, CB_ADDSTRING, 0, (LPARAM)g_playbackDeviceNames[i]);
-            }
-            /* Populate combos with recording devices */
-            for (int i = 0; i < g_recordDeviceCount; i++) {
-                SendMessageW(hComboRecordDefault, CB_ADDSTRING, 0, (LPARAM)g_recordDeviceNames[i]);
-                SendMessageW(hComboRecordComm, CB_ADDSTRING, 0, (LPARAM)g_recordDeviceNames[i]);
-            }
+            /* Buttons - centered in dialog */
+            HWND hBtnRestore = CreateWindowW(L"BUTTON", L"Restore Saved",
+                WS_CHILD | WS_VISIBLE | BS_PUSHBUTTON, 220, yPos, 150, 35,
+                hwnd, (HMENU)ID_MISMATCH_RESTORE, NULL, NULL);
+            SendMessage(hBtnRestore, WM_SETFONT, (WPARAM)hFontBold, TRUE);
             
-            /* Select current defaults */
-            int idx;
-            idx = (int)SendMessageW(hComboPlaybackDefault, CB_FINDSTRINGEXACT, -1, (LPARAM)g_playbackDefault);
-            SendMessage(hComboPlaybackDefault, CB_SETCURSEL, idx >= 0 ? idx : 0, 0);
-            idx = (int)SendMessageW(hComboPlaybackComm, CB_FINDSTRINGEXACT, -1, (LPARAM)g_playbackComm);
-            SendMessage(hComboPlaybackComm, CB_SETCURSEL, idx >= 0 ? idx : 0, 0);
-            idx = (int)SendMessageW(hComboRecordDefault, CB_FINDSTRINGEXACT, -1, (LPARAM)g_recordDefault);
-            SendMessage(hComboRecordDefault, CB_SETCURSEL, idx >= 0 ? idx : 0, 0);
-            idx = (int)SendMessageW(hComboRecordComm, CB_FINDSTRINGEXACT, -1, (LPARAM)g_recordComm);
-            SendMessage(hComboRecordComm, CB_SETCURSEL, idx >= 0 ? idx : 0, 0);
+            HWND hBtnKeep = CreateWindowW(L"BUTTON", L"Keep Current",
+                WS_CHILD | WS_VISIBLE | BS_PUSHBUTTON, 430, yPos, 150, 35,
+                hwnd, (HMENU)ID_MISMATCH_KEEP, NULL, NULL);
+            SendMessage(hBtnKeep, WM_SETFONT, (WPARAM)hFontBold, TRUE);
             
-            /* Always show current exe directory in the folder field */
-            /* If install dir was set via env var, use that; otherwise use exe dir */
-            if (g_installDir[0] == '\0' && g_exeDir[0] != '\0') {
-                strncpy(g_installDir, g_exeDir, MAX_PATH);
-            }
-            if (g_installDir[0] != '\0') {
-                WCHAR wPath[MAX_PATH];
-                MultiByteToWideChar(CP_UTF8, 0, g_installDir, -1, wPath, MAX_PATH);
-                SetWindowTextW(hEditFolder, wPath);
-            } else if (g_exeDir[0] != '\0') {
-                WCHAR wPath[MAX_PATH];
-                MultiByteToWideChar(CP_UTF8, 0, g_exeDir, -1, wPath, MAX_PATH);
-                SetWindowTextW(hEditFolder, wPath);
-                strncpy(g_installDir, g_exeDir, MAX_PATH);
+            /* Apply font to blue labels */
+            for (int i = 0; i < 8; i++) {
+                HWND hLabel = GetDlgItem(hwnd, ID_MISMATCH_LABEL_BASE + i);
+                if (hLabel) SendMessage(hLabel, WM_SETFONT, (WPARAM)hFont, TRUE);
             }
             
             return 0;
@@ -657,134 +623,28 @@ static LRESULT CALLBACK ConfigDlgProc(HWND hwnd, UINT msg, WPARAM wParam, LPARAM
             HDC hdc = (HDC)wParam;
             HWND hCtrl = (HWND)lParam;
             int ctrlId = GetDlgCtrlID(hCtrl);
+            
             SetBkColor(hdc, RGB(30, 30, 30));
-            /* Title labels (ID 150-199) get blue text */
-            if (ctrlId == ID_HEADER || (ctrlId >= ID_LABEL_START && ctrlId < ID_DESC_START)) {
+            
+            /* Blue for headers and subheading labels */
+            if (ctrlId == ID_MISMATCH_TITLE ||
+                ctrlId == ID_MISMATCH_SAVED_HDR ||
+                ctrlId == ID_MISMATCH_CURRENT_HDR ||
+                (ctrlId >= ID_MISMATCH_LABEL_BASE && ctrlId <= ID_MISMATCH_LABEL_BASE + 7)) {
                 SetTextColor(hdc, RGB(100, 200, 255));
-            }
-            /* Description labels (ID >= 200) get gray text */
-            else if (ctrlId >= ID_DESC_START) {
-                SetTextColor(hdc, RGB(140, 140, 140));
-            }
-            /* Everything else (header, etc.) gets white */
-            else {
+            } else {
+                /* White for device names */
                 SetTextColor(hdc, RGB(255, 255, 255));
             }
             return (LRESULT)hBrushBg;
         }
         
-        case WM_CTLCOLOREDIT:
-        case WM_CTLCOLORLISTBOX: {
-            HDC hdc = (HDC)wParam;
-            SetBkColor(hdc, RGB(45, 45, 45));
-            SetTextColor(hdc, RGB(255, 255, 255));
-            return (LRESULT)hBrushEdit;
-        }
-        
         case WM_COMMAND:
-            if (LOWORD(wParam) == ID_BUTTON_BROWSE) {
-                /* Show folder browser dialog */
-                BROWSEINFOW bi = {0};
-                bi.hwndOwner = hwnd;
-                bi.lpszTitle = L"Select Install Folder (optional)";
-                bi.ulFlags = BIF_RETURNONLYFSDIRS | BIF_NEWDIALOGSTYLE;
-                
-                LPITEMIDLIST pidl = SHBrowseForFolderW(&bi);
-                if (pidl) {
-                    WCHAR wPath[MAX_PATH];
-                    if (SHGetPathFromIDListW(pidl, wPath)) {
-                        /* Store in global */
-                        WideCharToMultiByte(CP_UTF8, 0, wPath, -1, g_installDir, MAX_PATH, NULL, NULL);
-                        /* Update edit box */
-                        SetWindowTextW(hEditFolder, wPath);
-                    }
-                    CoTaskMemFree(pidl);
-                }
-                return 0;
-            }
-            else if (LOWORD(wParam) == ID_BUTTON_SAVE) {
-                /* Save button - saves config, enables Run, but doesn't close */
-                int idx = (int)SendMessage(hComboPlaybackDefault, CB_GETCURSEL, 0, 0);
-                if (idx >= 0) SendMessageW(hComboPlaybackDefault, CB_GETLBTEXT, idx, (LPARAM)g_playbackDefault);
-                
-                idx = (int)SendMessage(hComboPlaybackComm, CB_GETCURSEL, 0, 0);
-                if (idx >= 0) SendMessageW(hComboPlaybackComm, CB_GETLBTEXT, idx, (LPARAM)g_playbackComm);
-                
-                idx = (int)SendMessage(hComboRecordDefault, CB_GETCURSEL, 0, 0);
-                if (idx >= 0) SendMessageW(hComboRecordDefault, CB_GETLBTEXT, idx, (LPARAM)g_recordDefault);
-                
-                idx = (int)SendMessage(hComboRecordComm, CB_GETCURSEL, 0, 0);
-                if (idx >= 0) SendMessageW(hComboRecordComm, CB_GETLBTEXT, idx, (LPARAM)g_recordComm);
-                
-                /* Get install folder from edit box */
-                WCHAR wInstallDir[MAX_PATH];
-                GetWindowTextW(hEditFolder, wInstallDir, MAX_PATH);
-                WideCharToMultiByte(CP_UTF8, 0, wInstallDir, -1, g_installDir, MAX_PATH, NULL, NULL);
-                
-                /* Get checkbox states */
-                HWND hCheckBg = GetDlgItem(hwnd, ID_CHECK_RUN_BACKGROUND);
-                g_runInBackground = (SendMessage(hCheckBg, BM_GETCHECK, 0, 0) == BST_CHECKED);
-                HWND hCheckNotify = GetDlgItem(hwnd, ID_CHECK_SHOW_NOTIFY);
-                g_showNotification = (SendMessage(hCheckNotify, BM_GETCHECK, 0, 0) == BST_CHECKED);
-                
-                /* Save config (moves files to install folder if path changed) */
-                saveConfig();
-                g_configExists = 1;
-                
-                /* Enable the Run button now that config exists */
-                EnableWindow(hButtonRun, TRUE);
-                
-                /* Show success message with exe path */
-                char exePath[MAX_PATH];
-                if (g_installDir[0] != '\0') {
-                    snprintf(exePath, MAX_PATH, "%s\\elgato_audio_reset.exe", g_installDir);
-                } else {
-                    strncpy(exePath, g_currentExePath, MAX_PATH);
-                }
-                
-                char msg[1024];
-                snprintf(msg, sizeof(msg), 
-                    "Configuration saved! Run via the \"Reset Audio\" button.\n\n"
-                    "Executable saved:\n%s\n\n"
-                    "You can assign the executable to a hotkey or macro button. "
-                    "If you set the config to run in the background with no notification, "
-                    "your audio will reset silently within a few seconds on key press.",
-                    exePath);
-                MessageBoxA(hwnd, msg, "Elgato Audio Reset", MB_OK | MB_ICONINFORMATION);
-                
-                /* Don't close - user can click Run or X */
-            }
-            else if (LOWORD(wParam) == ID_BUTTON_RUN) {
-                /* Run button - saves config and runs the reset */
-                int idx = (int)SendMessage(hComboPlaybackDefault, CB_GETCURSEL, 0, 0);
-                if (idx >= 0) SendMessageW(hComboPlaybackDefault, CB_GETLBTEXT, idx, (LPARAM)g_playbackDefault);
-                
-                idx = (int)SendMessage(hComboPlaybackComm, CB_GETCURSEL, 0, 0);
-                if (idx >= 0) SendMessageW(hComboPlaybackComm, CB_GETLBTEXT, idx, (LPARAM)g_playbackComm);
-                
-                idx = (int)SendMessage(hComboRecordDefault, CB_GETCURSEL, 0, 0);
-                if (idx >= 0) SendMessageW(hComboRecordDefault, CB_GETLBTEXT, idx, (LPARAM)g_recordDefault);
-                
-                idx = (int)SendMessage(hComboRecordComm, CB_GETCURSEL, 0, 0);
-                if (idx >= 0) SendMessageW(hComboRecordComm, CB_GETLBTEXT, idx, (LPARAM)g_recordComm);
-                
-                /* Get install folder from edit box */
-                WCHAR wInstallDir[MAX_PATH];
-                GetWindowTextW(hEditFolder, wInstallDir, MAX_PATH);
-                WideCharToMultiByte(CP_UTF8, 0, wInstallDir, -1, g_installDir, MAX_PATH, NULL, NULL);
-                
-                /* Get checkbox states */
-                HWND hCheckBg = GetDlgItem(hwnd, ID_CHECK_RUN_BACKGROUND);
-                g_runInBackground = (SendMessage(hCheckBg, BM_GETCHECK, 0, 0) == BST_CHECKED);
-                HWND hCheckNotify = GetDlgItem(hwnd, ID_CHECK_SHOW_NOTIFY);
-                g_showNotification = (SendMessage(hCheckNotify, BM_GETCHECK, 0, 0) == BST_CHECKED);
-                
-                /* Save config (moves files to install folder if path changed) */
-                saveConfig();
-                
-                /* Set flag to run the reset after GUI closes */
-                g_shouldRun = 1;
-                
+            if (LOWORD(wParam) == ID_MISMATCH_RESTORE) {
+                g_mismatchResult = 1;
+                DestroyWindow(hwnd);
+            } else if (LOWORD(wParam) == ID_MISMATCH_KEEP) {
+                g_mismatchResult = 0;
                 DestroyWindow(hwnd);
             }
             return 0;
@@ -798,199 +658,474 @@ static LRESULT CALLBACK ConfigDlgProc(HWND hwnd, UINT msg, WPARAM wParam, LPARAM
         }
         
         case WM_CLOSE:
-            /* User closed via X - just close the window */
+            g_mismatchResult = 0; /* Default to keep current on close */
             DestroyWindow(hwnd);
             return 0;
         
         case WM_DESTROY:
             DeleteObject(hBrushBg);
-            DeleteObject(hBrushEdit);
             DeleteObject(hFont);
             DeleteObject(hFontBold);
-            DeleteObject(hFontSmall);
-            PostQuitMessage(0);
+            DeleteObject(hFontDevice);
             return 0;
     }
     
     return DefWindowProcW(hwnd, msg, wParam, lParam);
 }
 
-/* ========== Check for Config Mismatch ========== */
-static int hasConfigMismatch(void) {
-    if (g_savedPlaybackDefault[0] == L'\0') return 0; /* No saved config */
+/* ========== Show Mismatch Dialog ========== */
+/* Returns 1 if user chose "Restore Saved", 0 if "Keep Current". Modal over
+ * owner the way DialogBox does it: the owner is disabled while the dialog
+ * runs its own loop, which ends when the dialog is destroyed. A WM_QUIT that
+ * arrives meanwhile closes the dialog and is posted again for the owner's
+ * loop. */
+static int showMismatchDialog(HWND owner) {
+    /* Register window class */
+    WNDCLASSW wc = {0};
+    wc.lpfnWndProc = MismatchDlgProc;
+    wc.hInstance = GetModuleHandle(NULL);
+    wc.hCursor = LoadCursor(NULL, IDC_ARROW);
+    wc.lpszClassName = L"ElgatoMismatchDlg";
+    RegisterClassW(&wc);
     
-    if (wcscmp(g_savedPlaybackDefault, g_currentPlaybackDefault) != 0) return 1;
-    if (wcscmp(g_savedPlaybackComm, g_currentPlaybackComm) != 0) return 1;
-    if (wcscmp(g_savedRecordDefault, g_currentRecordDefault) != 0) return 1;
-    if (wcscmp(g_savedRecordComm, g_currentRecordComm) != 0) return 1;
+    /* Calculate center position */
+    int screenW = GetSystemMetrics(SM_CXSCREEN);
+    int screenH = GetSystemMetrics(SM_CYSCREEN);
+    int winW = 820, winH = 380;
+    int x = (screenW - winW) / 2;
+    int y = (screenH - winH) / 2;
     
-    return 0;
+    /* Create window */
+    g_mismatchResult = 0;
+    HWND hwnd = CreateWindowExW(0, L"ElgatoMismatchDlg", L"Audio Configuration Mismatch",
+        WS_OVERLAPPED | WS_CAPTION | WS_SYSMENU,
+        x, y, winW, winH, owner, NULL, GetModuleHandle(NULL), NULL);
+    
+    if (hwnd) {
+        if (owner) EnableWindow(owner, FALSE);
+        ShowWindow(hwnd, SW_SHOW);
+        UpdateWindow(hwnd);
+        
+        MSG msg;
+        while (IsWindow(hwnd)) {
+            BOOL got = GetMessage(&msg, NULL, 0, 0);
+            if (got <= 0) {
+                DestroyWindow(hwnd);
+                if (got == 0) PostQuitMessage((int)msg.wParam);
+                break;
+            }
+            TranslateMessage(&msg);
+            DispatchMessage(&msg);
+        }
+        
+        if (owner) {
+            EnableWindow(owner, TRUE);
+            SetForegroundWindow(owner);
+        }
+    }
+    
+    if (g_mismatchResult == 1) {
+        /* User chose to restore saved defaults */
+        wcsncpy(g_playbackDefault, g_savedPlaybackDefault, 256);
+        wcsncpy(g_playbackComm, g_savedPlaybackComm, 256);
+        wcsncpy(g_recordDefault, g_savedRecordDefault, 256);
+        wcsncpy(g_recordComm, g_savedRecordComm, 256);
+    } else {
+        /* User chose to keep current Windows settings */
+        wcsncpy(g_playbackDefault, g_currentPlaybackDefault, 256);
+        wcsncpy(g_playbackComm, g_currentPlaybackComm, 256);
+        wcsncpy(g_recordDefault, g_currentRecordDefault, 256);
+        wcsncpy(g_recordComm, g_currentRecordComm, 256);
+    }
+    
+    return g_mismatchResult;
 }
 
-/* ========== Mismatch Dialog IDs ========== */
-#define ID_MISMATCH_RESTORE  501
-#define ID_MISMATCH_KEEP     502
-#define ID_MISMATCH_TITLE    503
-#define ID_MISMATCH_SAVED_HDR    504
-#define ID_MISMATCH_CURRENT_HDR  505
-#define ID_MISMATCH_LABEL_BASE   510  /* 510-517 for blue labels */
-
-static int g_mismatchResult = 0;
+/* ========== Device Combos ========== */
+/* Each combo item carries its index into the registry it was filled from */
+static const DeviceInfo* comboDevice(HWND hCombo, const DeviceRegistry* reg) {
+    int idx = (int)SendMessageW(hCombo, CB_GETCURSEL, 0, 0);
+    if (idx < 0 || !reg) return NULL;
+    LRESULT i = SendMessageW(hCombo, CB_GETITEMDATA, idx, 0);
+    return (i >= 0 && i < reg->count) ? &reg->devices[i] : NULL;
+}
 
-/* ========== Mismatch Dialog Procedure ========== */
-static LRESULT CALLBACK MismatchDlgProc(HWND hwnd, UINT msg, WPARAM wParam, LPARAM lParam) {
-    static HFONT hFont, hFontBold, hFontDevice;
-    static HBRUSH hBrushBg;
+/* Refill a device combo from g_devices, keeping the device picked from the
+ * previous registry if it is still there, else the configured one, else the
+ * first entry */
+static void fillDeviceCombo(HWND hCombo, const DeviceRegistry* previous, EDataFlow dataFlow, const WCHAR* configured) {
+    const DeviceInfo* picked = comboDevice(hCombo, previous);
+    int keep = -1, match = -1;
+    
+    SendMessageW(hCombo, WM_SETREDRAW, FALSE, 0);
+    SendMessageW(hCombo, CB_RESETCONTENT, 0, 0);
+    for (int i = 0; g_devices && i < g_devices->count; i++) {
+        const DeviceInfo* d = &g_devices->devices[i];
+        if (d->dataFlow != dataFlow) continue;
+        int pos = (int)SendMessageW(hCombo, CB_ADDSTRING, 0, (LPARAM)d->name);
+        if (pos < 0) continue;
+        SendMessageW(hCombo, CB_SETITEMDATA, pos, i);
+        if (picked && keep < 0 && wcscmp(d->id, picked->id) == 0) keep = pos;
+        if (match < 0 && wcscmp(d->name, configured) == 0) match = pos;
+    }
+    int idx = keep >= 0 ? keep : match;
+    SendMessage(hCombo, CB_SETCURSEL, idx >= 0 ? idx : 0, 0);
+    SendMessageW(hCombo, WM_SETREDRAW, TRUE, 0);
+    InvalidateRect(hCombo, NULL, TRUE);
+}
+
+static void selectDeviceCombo(HWND hCombo, const WCHAR* name) {
+    int idx = (int)SendMessageW(hCombo, CB_FINDSTRINGEXACT, -1, (LPARAM)name);
+    if (idx >= 0) SendMessage(hCombo, CB_SETCURSEL, idx, 0);
+}
+
+/* Copy the picked device into a config role. The config keeps names to 255
+ * characters; the stored ID is what finds a longer-named device again. */
+static void readDeviceCombo(HWND hCombo, WCHAR* name, WCHAR* id) {
+    const DeviceInfo* d = comboDevice(hCombo, g_devices);
+    id[0] = L'\0';
+    if (!d) return;
+    wcsncpy(name, d->name, 255);
+    name[255] = L'\0';
+    if (wcslen(d->id) < MAX_ENDPOINT_ID) wcscpy(id, d->id);
+}
+
+/* ========== GUI Dialog Procedure ========== */
+static LRESULT CALLBACK ConfigDlgProc(HWND hwnd, UINT msg, WPARAM wParam, LPARAM lParam) {
+    static HWND hComboPlaybackDefault, hComboRecordDefault, hComboPlaybackComm, hComboRecordComm;
+    static HWND hEditFolder, hButtonSave, hButtonRun, hButtonBrowse;
+    static HBRUSH hBrushBg, hBrushEdit;
+    static HFONT hFont, hFontBold, hFontSmall;
     
     switch (msg) {
         case WM_CREATE: {
+            /* Dark theme colors */
             hBrushBg = CreateSolidBrush(RGB(30, 30, 30));
+            hBrushEdit = CreateSolidBrush(RGB(45, 45, 45));
             hFont = CreateFontW(16, 0, 0, 0, FW_NORMAL, FALSE, FALSE, FALSE, DEFAULT_CHARSET,
                                OUT_DEFAULT_PRECIS, CLIP_DEFAULT_PRECIS, CLEARTYPE_QUALITY,
                                DEFAULT_PITCH | FF_DONTCARE, L"Segoe UI");
-            hFontBold = CreateFontW(18, 0, 0, 0, FW_BOLD, FALSE, FALSE, FALSE, DEFAULT_CHARSET,
+            hFontBold = CreateFontW(20, 0, 0, 0, FW_BOLD, FALSE, FALSE, FALSE, DEFAULT_CHARSET,
                                    OUT_DEFAULT_PRECIS, CLIP_DEFAULT_PRECIS, CLEARTYPE_QUALITY,
                                    DEFAULT_PITCH | FF_DONTCARE, L"Segoe UI");
-            hFontDevice = CreateFontW(14, 0, 0, 0, FW_NORMAL, FALSE, FALSE, FALSE, DEFAULT_CHARSET,
-                                     OUT_DEFAULT_PRECIS, CLIP_DEFAULT_PRECIS, CLEARTYPE_QUALITY,
-                                     DEFAULT_PITCH | FF_DONTCARE, L"Segoe UI");
+            hFontSmall = CreateFontW(14, 0, 0, 0, FW_NORMAL, FALSE, FALSE, FALSE, DEFAULT_CHARSET,
+                                    OUT_DEFAULT_PRECIS, CLIP_DEFAULT_PRECIS, CLEARTYPE_QUALITY,
+                                    DEFAULT_PITCH | FF_DONTCARE, L"Segoe UI");
             
             int yPos = 15;
-            int colWidth = 380;
-            int leftCol = 20;
-            int rightCol = 420;
-            int labelHeight = 18;
-            int deviceHeight = 18;
-            int rowSpacing = 12;
             
-            /* Title */
-            HWND hTitle = CreateWindowW(L"STATIC", 
-                L"Your saved audio configuration differs from current Windows settings.",
-                WS_CHILD | WS_VISIBLE | SS_CENTER, 20, yPos, 760, 20, hwnd, (HMENU)ID_MISMATCH_TITLE, NULL, NULL);
-            SendMessage(hTitle, WM_SETFONT, (WPARAM)hFont, TRUE);
-            yPos += 40;
+            /* Header */
+            HWND hHeader = CreateWindowW(L"STATIC", L"Device Selection",
+                WS_CHILD | WS_VISIBLE, 20, yPos, 460, 25, hwnd, (HMENU)ID_HEADER, NULL, NULL);
+            SendMessage(hHeader, WM_SETFONT, (WPARAM)hFontBold, TRUE);
+            yPos += 30;
             
-            /* Column headers */
-            HWND hSavedHeader = CreateWindowW(L"STATIC", L"Saved Configuration",
-                WS_CHILD | WS_VISIBLE | SS_CENTER, leftCol, yPos, colWidth, 24, hwnd, (HMENU)ID_MISMATCH_SAVED_HDR, NULL, NULL);
-            SendMessage(hSavedHeader, WM_SETFONT, (WPARAM)hFontBold, TRUE);
+            /* Subheader */
+            HWND hSubheader = CreateWindowW(L"STATIC", 
+                L"Select your audio devices and choose where to install.",
+                WS_CHILD | WS_VISIBLE, 20, yPos, 460, 20, hwnd, (HMENU)(ID_DESC_START), NULL, NULL);
+            SendMessage(hSubheader, WM_SETFONT, (WPARAM)hFontSmall, TRUE);
+            yPos += 30;
             
-            HWND hCurrentHeader = CreateWindowW(L"STATIC", L"Current Windows Settings",
-                WS_CHILD | WS_VISIBLE | SS_CENTER, rightCol, yPos, colWidth, 24, hwnd, (HMENU)ID_MISMATCH_CURRENT_HDR, NULL, NULL);
-            SendMessage(hCurrentHeader, WM_SETFONT, (WPARAM)hFontBold, TRUE);
-            yPos += 35;
+            /* Install Folder */
+            HWND hLabelFolder = CreateWindowW(L"STATIC", L"Install Folder",
+                WS_CHILD | WS_VISIBLE, 20, yPos, 460, 20, hwnd, (HMENU)(ID_LABEL_START), NULL, NULL);
+            SendMessage(hLabelFolder, WM_SETFONT, (WPARAM)hFont, TRUE);
+            HWND hDescFolder = CreateWindowW(L"STATIC", L"Change this to move everything to a new folder",
+                WS_CHILD | WS_VISIBLE, 20, yPos + 18, 460, 18, hwnd, (HMENU)(ID_DESC_START + 5), NULL, NULL);
+            SendMessage(hDescFolder, WM_SETFONT, (WPARAM)hFontSmall, TRUE);
+            hEditFolder = CreateWindowW(L"EDIT", L"",
+                WS_CHILD | WS_VISIBLE | WS_BORDER | ES_AUTOHSCROLL, 20, yPos + 40, 370, 25,
+                hwnd, (HMENU)ID_EDIT_FOLDER, NULL, NULL);
+            SendMessage(hEditFolder, WM_SETFONT, (WPARAM)hFont, TRUE);
+            hButtonBrowse = CreateWindowW(L"BUTTON", L"Browse...",
+                WS_CHILD | WS_VISIBLE | BS_PUSHBUTTON, 400, yPos + 38, 80, 28,
+                hwnd, (HMENU)ID_BUTTON_BROWSE, NULL, NULL);
+            SendMessage(hButtonBrowse, WM_SETFONT, (WPARAM)hFont, TRUE);
+            yPos += 75;
             
-            /* Row 1: Playback Default */
-            CreateWindowW(L"STATIC", L"Playback Default:",
-                WS_CHILD | WS_VISIBLE | SS_LEFT, leftCol, yPos, colWidth, labelHeight, hwnd, (HMENU)(ID_MISMATCH_LABEL_BASE + 0), NULL, NULL);
-            CreateWindowW(L"STATIC", L"Playback Default:",
-                WS_CHILD | WS_VISIBLE | SS_LEFT, rightCol, yPos, colWidth, labelHeight, hwnd, (HMENU)(ID_MISMATCH_LABEL_BASE + 1), NULL, NULL);
-            yPos += labelHeight;
+            /* Default Playback Device */
+            HWND hLabel1 = CreateWindowW(L"STATIC", L"Default Playback Device",
+                WS_CHILD | WS_VISIBLE, 20, yPos, 460, 20, hwnd, (HMENU)(ID_LABEL_START + 1), NULL, NULL);
+            SendMessage(hLabel1, WM_SETFONT, (WPARAM)hFont, TRUE);
+            HWND hDesc1 = CreateWindowW(L"STATIC", L"Where your system audio plays (games, music, videos, notifications)",
+                WS_CHILD | WS_VISIBLE, 20, yPos + 18, 460, 18, hwnd, (HMENU)(ID_DESC_START + 1), NULL, NULL);
+            SendMessage(hDesc1, WM_SETFONT, (WPARAM)hFontSmall, TRUE);
+            hComboPlaybackDefault = CreateWindowW(L"COMBOBOX", NULL,
+                WS_CHILD | WS_VISIBLE | CBS_DROPDOWNLIST | WS_VSCROLL, 20, yPos + 40, 460, 200,
+                hwnd, (HMENU)ID_COMBO_PLAYBACK_DEFAULT, NULL, NULL);
+            SendMessage(hComboPlaybackDefault, WM_SETFONT, (WPARAM)hFont, TRUE);
+            yPos += 75;
             
-            HWND hSavedPD = CreateWindowW(L"STATIC", g_savedPlaybackDefault,
-                WS_CHILD | WS_VISIBLE | SS_LEFT, leftCol, yPos, colWidth, deviceHeight, hwnd, NULL, NULL, NULL);
-            SendMessage(hSavedPD, WM_SETFONT, (WPARAM)hFontDevice, TRUE);
-            HWND hCurrentPD = CreateWindowW(L"STATIC", g_currentPlaybackDefault,
-                WS_CHILD | WS_VISIBLE | SS_LEFT, rightCol, yPos, colWidth, deviceHeight, hwnd, NULL, NULL, NULL);
-            SendMessage(hCurrentPD, WM_SETFONT, (WPARAM)hFontDevice, TRUE);
-            yPos += deviceHeight + rowSpacing;
+            /* Default Recording Device */
+            HWND hLabel2 = CreateWindowW(L"STATIC", L"Default Recording Device",
+                WS_CHILD | WS_VISIBLE, 20, yPos, 460, 20, hwnd, (HMENU)(ID_LABEL_START + 2), NULL, NULL);
+            SendMessage(hLabel2, WM_SETFONT, (WPARAM)hFont, TRUE);
+            HWND hDesc2 = CreateWindowW(L"STATIC", L"Default microphone for apps that don't specify one",
+                WS_CHILD | WS_VISIBLE, 20, yPos + 18, 460, 18, hwnd, (HMENU)(ID_DESC_START + 2), NULL, NULL);
+            SendMessage(hDesc2, WM_SETFONT, (WPARAM)hFontSmall, TRUE);
+            hComboRecordDefault = CreateWindowW(L"COMBOBOX", NULL,
+                WS_CHILD | WS_VISIBLE | CBS_DROPDOWNLIST | WS_VSCROLL, 20, yPos + 40, 460, 200,
+                hwnd, (HMENU)ID_COMBO_RECORD_DEFAULT, NULL, NULL);
+            SendMessage(hComboRecordDefault, WM_SETFONT, (WPARAM)hFont, TRUE);
+            yPos += 75;
             
-            /* Row 2: Playback Comms */
-            CreateWindowW(L"STATIC", L"Playback Comms:",
-                WS_CHILD | WS_VISIBLE | SS_LEFT, leftCol, yPos, colWidth, labelHeight, hwnd, (HMENU)(ID_MISMATCH_LABEL_BASE + 2), NULL, NULL);
-            CreateWindowW(L"STATIC", L"Playback Comms:",
-                WS_CHILD | WS_VISIBLE | SS_LEFT, rightCol, yPos, colWidth, labelHeight, hwnd, (HMENU)(ID_MISMATCH_LABEL_BASE + 3), NULL, NULL);
-            yPos += labelHeight;
+            /* Communications Playback Device */
+            HWND hLabel3 = CreateWindowW(L"STATIC", L"Communications Playback Device",
+                WS_CHILD | WS_VISIBLE, 20, yPos, 460, 20, hwnd, (HMENU)(ID_LABEL_START + 3), NULL, NULL);
+            SendMessage(hLabel3, WM_SETFONT, (WPARAM)hFont, TRUE);
+            HWND hDesc3 = CreateWindowW(L"STATIC", L"Where you hear voice chat (Discord, Teams, Zoom, etc.)",
+                WS_CHILD | WS_VISIBLE, 20, yPos + 18, 460, 18, hwnd, (HMENU)(ID_DESC_START + 3), NULL, NULL);
+            SendMessage(hDesc3, WM_SETFONT, (WPARAM)hFontSmall, TRUE);
+            hComboPlaybackComm = CreateWindowW(L"COMBOBOX", NULL,
+                WS_CHILD | WS_VISIBLE | CBS_DROPDOWNLIST | WS_VSCROLL, 20, yPos + 40, 460, 200,
+                hwnd, (HMENU)ID_COMBO_PLAYBACK_COMM, NULL, NULL);
+            SendMessage(hComboPlaybackComm, WM_SETFONT, (WPARAM)hFont, TRUE);
+            yPos += 75;
             
-            HWND hSavedPC = CreateWindowW(L"STATIC", g_savedPlaybackComm,
-                WS_CHILD | WS_VISIBLE | SS_LEFT, leftCol, yPos, colWidth, deviceHeight, hwnd, NULL, NULL, NULL);
-            SendMessage(hSavedPC, WM_SETFONT, (WPARAM)hFontDevice, TRUE);
-            HWND hCurrentPC = CreateWindowW(L"STATIC", g_currentPlaybackComm,
-                WS_CHILD | WS_VISIBLE | SS_LEFT, rightCol, yPos, colWidth, deviceHeight, hwnd, NULL, NULL, NULL);
-            SendMessage(hCurrentPC, WM_SETFONT, (WPARAM)hFontDevice, TRUE);
-            yPos += deviceHeight + rowSpacing;
+            /* Communications Recording Device */
+            HWND hLabel4 = CreateWindowW(L"STATIC", L"Communications Recording Device",
+                WS_CHILD | WS_VISIBLE, 20, yPos, 460, 20, hwnd, (HMENU)(ID_LABEL_START + 4), NULL, NULL);
+            SendMessage(hLabel4, WM_SETFONT, (WPARAM)hFont, TRUE);
+            HWND hDesc4 = CreateWindowW(L"STATIC", L"Microphone used for voice chat (Discord, Teams, Zoom, etc.)",
+                WS_CHILD | WS_VISIBLE, 20, yPos + 18, 460, 18, hwnd, (HMENU)(ID_DESC_START + 4), NULL, NULL);
+            SendMessage(hDesc4, WM_SETFONT, (WPARAM)hFontSmall, TRUE);
+            hComboRecordComm = CreateWindowW(L"COMBOBOX", NULL,
+                WS_CHILD | WS_VISIBLE | CBS_DROPDOWNLIST | WS_VSCROLL, 20, yPos + 40, 460, 200,
+                hwnd, (HMENU)ID_COMBO_RECORD_COMM, NULL, NULL);
+            SendMessage(hComboRecordComm, WM_SETFONT, (WPARAM)hFont, TRUE);
+            yPos += 75;
             
-            /* Row 3: Recording Default */
-            CreateWindowW(L"STATIC", L"Recording Default:",
-                WS_CHILD | WS_VISIBLE | SS_LEFT, leftCol, yPos, colWidth, labelHeight, hwnd, (HMENU)(ID_MISMATCH_LABEL_BASE + 4), NULL, NULL);
-            CreateWindowW(L"STATIC", L"Recording Default:",
-                WS_CHILD | WS_VISIBLE | SS_LEFT, rightCol, yPos, colWidth, labelHeight, hwnd, (HMENU)(ID_MISMATCH_LABEL_BASE + 5), NULL, NULL);
-            yPos += labelHeight;
+            /* Checkboxes row - two checkboxes side by side */
+            HWND hCheckRunBackground = CreateWindowW(L"BUTTON", L"Run in background",
+                WS_CHILD | WS_VISIBLE | BS_AUTOCHECKBOX, 20, yPos, 200, 20,
+                hwnd, (HMENU)ID_CHECK_RUN_BACKGROUND, NULL, NULL);
+            SendMessage(hCheckRunBackground, WM_SETFONT, (WPARAM)hFont, TRUE);
+            if (g_runInBackground) {
+                SendMessage(hCheckRunBackground, BM_SETCHECK, BST_CHECKED, 0);
+            }
             
-            HWND hSavedRD = CreateWindowW(L"STATIC", g_savedRecordDefault,
-                WS_CHILD | WS_VISIBLE | SS_LEFT, leftCol, yPos, colWidth, deviceHeight, hwnd, NULL, NULL, NULL);
-            SendMessage(hSavedRD, WM_SETFONT, (WPARAM)hFontDevice, TRUE);
-            HWND hCurrentRD = CreateWindowW(L"STATIC", g_currentRecordDefault,
-                WS_CHILD | WS_VISIBLE | SS_LEFT, rightCol, yPos, colWidth, deviceHeight, hwnd, NULL, NULL, NULL);
-            SendMessage(hCurrentRD, WM_SETFONT, (WPARAM)hFontDevice, TRUE);
-            yPos += deviceHeight + rowSpacing;
+            HWND hCheckShowNotify = CreateWindowW(L"BUTTON", L"Show completion notification",
+                WS_CHILD | WS_VISIBLE | BS_AUTOCHECKBOX, 225, yPos, 250, 20,
+                hwnd, (HMENU)ID_CHECK_SHOW_NOTIFY, NULL, NULL);
+            SendMessage(hCheckShowNotify, WM_SETFONT, (WPARAM)hFont, TRUE);
+            if (g_showNotification) {
+                SendMessage(hCheckShowNotify, BM_SETCHECK, BST_CHECKED, 0);
+            }
+            yPos += 40;
             
-            /* Row 4: Recording Comms */
-            CreateWindowW(L"STATIC", L"Recording Comms:",
-                WS_CHILD | WS_VISIBLE | SS_LEFT, leftCol, yPos, colWidth, labelHeight, hwnd, (HMENU)(ID_MISMATCH_LABEL_BASE + 6), NULL, NULL);
-            CreateWindowW(L"STATIC", L"Recording Comms:",
-                WS_CHILD | WS_VISIBLE | SS_LEFT, rightCol, yPos, colWidth, labelHeight, hwnd, (HMENU)(ID_MISMATCH_LABEL_BASE + 7), NULL, NULL);
-            yPos += labelHeight;
+            /* Buttons centered with gap between them */
+            /* Window is 520px wide, buttons are 120px each, 20px gap = 260px total */
+            /* Center: (520 - 260) / 2 = 130px from left */
             
-            HWND hSavedRC = CreateWindowW(L"STATIC", g_savedRecordComm,
-                WS_CHILD | WS_VISIBLE | SS_LEFT, leftCol, yPos, colWidth, deviceHeight, hwnd, NULL, NULL, NULL);
-            SendMessage(hSavedRC, WM_SETFONT, (WPARAM)hFontDevice, TRUE);
-            HWND hCurrentRC = CreateWindowW(L"STATIC", g_currentRecordComm,
-                WS_CHILD | WS_VISIBLE | SS_LEFT, rightCol, yPos, colWidth, deviceHeight, hwnd, NULL, NULL, NULL);
-            SendMessage(hCurrentRC, WM_SETFONT, (WPARAM)hFontDevice, TRUE);
-            yPos += deviceHeight + 20;
+            /* Save button - saves config only; disabled until the device list arrives */
+            hButtonSave = CreateWindowW(L"BUTTON", L"Save",
+                WS_CHILD | WS_VISIBLE | BS_PUSHBUTTON | WS_DISABLED, 130, yPos, 120, 35,
+                hwnd, (HMENU)ID_BUTTON_SAVE, NULL, NULL);
+            SendMessage(hButtonSave, WM_SETFONT, (WPARAM)hFontBold, TRUE);
             
-            /* Buttons - centered in dialog */
-            HWND hBtnRestore = CreateWindowW(L"BUTTON", L"Restore Saved",
-                WS_CHILD | WS_VISIBLE | BS_PUSHBUTTON, 220, yPos, 150, 35,
-                hwnd, (HMENU)ID_MISMATCH_RESTORE, NULL, NULL);
-            SendMessage(hBtnRestore, WM_SETFONT, (WPARAM)hFontBold, TRUE);
+            /* Run button - disabled until config exists and the device list arrives */
+            hButtonRun = CreateWindowW(L"BUTTON", L"Reset Audio",
+                WS_CHILD | WS_VISIBLE | BS_PUSHBUTTON | WS_DISABLED, 
+                270, yPos, 120, 35,
+                hwnd, (HMENU)ID_BUTTON_RUN, NULL, NULL);
+            SendMessage(hButtonRun, WM_SETFONT, (WPARAM)hFontBold, TRUE);
             
-            HWND hBtnKeep = CreateWindowW(L"BUTTON", L"Keep Current",
-                WS_CHILD | WS_VISIBLE | BS_PUSHBUTTON, 430, yPos, 150, 35,
-                hwnd, (HMENU)ID_MISMATCH_KEEP, NULL, NULL);
-            SendMessage(hBtnKeep, WM_SETFONT, (WPARAM)hFontBold, TRUE);
+            /* The device combos are filled by WM_GUI_DEVICES */
             
-            /* Apply font to blue labels */
-            for (int i = 0; i < 8; i++) {
-                HWND hLabel = GetDlgItem(hwnd, ID_MISMATCH_LABEL_BASE + i);
-                if (hLabel) SendMessage(hLabel, WM_SETFONT, (WPARAM)hFont, TRUE);
+            /* Always show current exe directory in the folder field */
+            /* If install dir was set via env var, use that; otherwise use exe dir */
+            if (g_installDir[0] == '\0' && g_exeDir[0] != '\0') {
+                strncpy(g_installDir, g_exeDir, MAX_PATH);
+            }
+            if (g_installDir[0] != '\0') {
+                WCHAR wPath[MAX_PATH];
+                MultiByteToWideChar(CP_UTF8, 0, g_installDir, -1, wPath, MAX_PATH);
+                SetWindowTextW(hEditFolder, wPath);
+            } else if (g_exeDir[0] != '\0') {
+                WCHAR wPath[MAX_PATH];
+                MultiByteToWideChar(CP_UTF8, 0, g_exeDir, -1, wPath, MAX_PATH);
+                SetWindowTextW(hEditFolder, wPath);
+                strncpy(g_installDir, g_exeDir, MAX_PATH);
             }
             
             return 0;
         }
         
-        case WM_CTLCOLORSTATIC: {
-            HDC hdc = (HDC)wParam;
-            HWND hCtrl = (HWND)lParam;
-            int ctrlId = GetDlgCtrlID(hCtrl);
+        case WM_GUI_DEVICES: {
+            /* A fresh registry from the device watch - on open and after every hot-plug */
+            DeviceRegistry* previous = g_devices;
+            g_devices = (DeviceRegistry*)lParam;
+            fillDeviceCombo(hComboPlaybackDefault, previous, eRender, g_playbackDefault);
+            fillDeviceCombo(hComboPlaybackComm, previous, eRender, g_playbackComm);
+            fillDeviceCombo(hComboRecordDefault, previous, eCapture, g_recordDefault);
+            fillDeviceCombo(hComboRecordComm, previous, eCapture, g_recordComm);
+            free(previous);
+            EnableWindow(hButtonSave, TRUE);
+            EnableWindow(hButtonRun, g_configExists);
+            return 0;
+        }
+        
+        case WM_GUI_DEFAULTS: {
+            /* Current Windows defaults, once per window, after the first list */
+            GuiDefaults* defaults = (GuiDefaults*)lParam;
+            wcscpy(g_currentPlaybackDefault, defaults->names[0]);
+            wcscpy(g_currentPlaybackComm, defaults->names[1]);
+            wcscpy(g_currentRecordDefault, defaults->names[2]);
+            wcscpy(g_currentRecordComm, defaults->names[3]);
+            memcpy(g_currentIds, defaults->ids, sizeof(g_currentIds));
+            free(defaults);
             
-            SetBkColor(hdc, RGB(30, 30, 30));
+            /* Only used as the selection if no config loaded */
+            if (g_savedPlaybackDefault[0] == L'\0' && g_currentPlaybackDefault[0]) wcsncpy(g_playbackDefault, g_currentPlaybackDefault, 255);
+            if (g_savedPlaybackComm[0] == L'\0' && g_currentPlaybackComm[0]) wcsncpy(g_playbackComm, g_currentPlaybackComm, 255);
+            if (g_savedRecordDefault[0] == L'\0' && g_currentRecordDefault[0]) wcsncpy(g_recordDefault, g_currentRecordDefault, 255);
+            if (g_savedRecordComm[0] == L'\0' && g_currentRecordComm[0]) wcsncpy(g_recordComm, g_currentRecordComm, 255);
             
-            /* Blue for headers and subheading labels */
-            if (ctrlId == ID_MISMATCH_TITLE ||
-                ctrlId == ID_MISMATCH_SAVED_HDR ||
-                ctrlId == ID_MISMATCH_CURRENT_HDR ||
-                (ctrlId >= ID_MISMATCH_LABEL_BASE && ctrlId <= ID_MISMATCH_LABEL_BASE + 7)) {
-                SetTextColor(hdc, RGB(100, 200, 255));
-            } else {
-                /* White for device names */
-                SetTextColor(hdc, RGB(255, 255, 255));
+            selectDeviceCombo(hComboPlaybackDefault, g_playbackDefault);
+            selectDeviceCombo(hComboPlaybackComm, g_playbackComm);
+            selectDeviceCombo(hComboRecordDefault, g_recordDefault);
+            selectDeviceCombo(hComboRecordComm, g_recordComm);
+            
+            /* Check for mismatch between saved config and current Windows
+             * settings - asked once this message is done, not from inside it */
+            if (g_configExists && hasConfigMismatch()) {
+                PostMessageW(hwnd, WM_GUI_MISMATCH, 0, 0);
             }
-            return (LRESULT)hBrushBg;
+            return 0;
         }
         
-        case WM_COMMAND:
-            if (LOWORD(wParam) == ID_MISMATCH_RESTORE) {
-                g_mismatchResult = 1;
-                DestroyWindow(hwnd);
-            } else if (LOWORD(wParam) == ID_MISMATCH_KEEP) {
-                g_mismatchResult = 0;
-                DestroyWindow(hwnd);
-            }
+        case WM_GUI_MISMATCH:
+            showMismatchDialog(hwnd);
+            selectDeviceCombo(hComboPlaybackDefault, g_playbackDefault);
+            selectDeviceCombo(hComboPlaybackComm, g_playbackComm);
+            selectDeviceCombo(hComboRecordDefault, g_recordDefault);
+            selectDeviceCombo(hComboRecordComm, g_recordComm);
             return 0;
         
-        case WM_ERASEBKGND: {
+        case WM_CTLCOLORSTATIC: {
+            HDC hdc = (HDC)wParam;
+            HWND hCtrl = (HWND)lParam;
+            int ctrlId = GetDlgCtrlID(hCtrl);
+            SetBkColor(hdc, RGB(30, 30, 30));
+            /* Title labels (ID 150-199) get blue text */
+            if (ctrlId == ID_HEADER || (ctrlId >= ID_LABEL_START && ctrlId < ID_DESC_START)) {
+                SetTextColor(hdc, RGB(100, 200, 255));
+            }
+            /* Description labels (ID >= 200) get gray text */
+            else if (ctrlId >= ID_DESC_START) {
+                SetTextColor(hdc, RGB(140, 140, 140));
+            }
+            /* Everything else (header, etc.) gets white */
+            else {
+                SetTextColor(hdc, RGB(255, 255, 255));
+            }
+            return (LRESULT)hBrushBg;
+        }
+        
+        case WM_CTLCOLOREDIT:
+        case WM_CTLCOLORLISTBOX: {
+            HDC hdc = (HDC)wParam;
+            SetBkColor(hdc, RGB(45, 45, 45));
+            SetTextColor(hdc, RGB(255, 255, 255));
+            return (LRESULT)hBrushEdit;
+        }
+        
+        case WM_COMMAND:
+            if (LOWORD(wParam) == ID_BUTTON_BROWSE) {
+                /* Show folder browser dialog */
+                BROWSEINFOW bi = {0};
+                bi.hwndOwner = hwnd;
+                bi.lpszTitle = L"Select Install Folder (optional)";
+                bi.ulFlags = BIF_RETURNONLYFSDIRS | BIF_NEWDIALOGSTYLE;
+                
+                LPITEMIDLIST pidl = SHBrowseForFolderW(&bi);
+                if (pidl) {
+                    WCHAR wPath[MAX_PATH];
+                    if (SHGetPathFromIDListW(pidl, wPath)) {
+                        /* Store in global */
+                        WideCharToMultiByte(CP_UTF8, 0, wPath, -1, g_installDir, MAX_PATH, NULL, NULL);
+                        /* Update edit box */
+                        SetWindowTextW(hEditFolder, wPath);
+                    }
+                    CoTaskMemFree(pidl);
+                }
+                return 0;
+            }
+            else if (LOWORD(wParam) == ID_BUTTON_SAVE) {
+                /* Save button - saves config, enables Run, but doesn't close */
+                readDeviceCombo(hComboPlaybackDefault, g_playbackDefault, g_playbackDefaultId);
+                readDeviceCombo(hComboPlaybackComm, g_playbackComm, g_playbackCommId);
+                readDeviceCombo(hComboRecordDefault, g_recordDefault, g_recordDefaultId);
+                readDeviceCombo(hComboRecordComm, g_recordComm, g_recordCommId);
+                
+                /* Get install folder from edit box */
+                WCHAR wInstallDir[MAX_PATH];
+                GetWindowTextW(hEditFolder, wInstallDir, MAX_PATH);
+                WideCharToMultiByte(CP_UTF8, 0, wInstallDir, -1, g_installDir, MAX_PATH, NULL, NULL);
+                
+                /* Get checkbox states */
+                HWND hCheckBg = GetDlgItem(hwnd, ID_CHECK_RUN_BACKGROUND);
+                g_runInBackground = (SendMessage(hCheckBg, BM_GETCHECK, 0, 0) == BST_CHECKED);
+                HWND hCheckNotify = GetDlgItem(hwnd, ID_CHECK_SHOW_NOTIFY);
+                g_showNotification = (SendMessage(hCheckNotify, BM_GETCHECK, 0, 0) == BST_CHECKED);
+                
+                /* Save config (moves files to install folder if path changed) */
+                saveConfig();
+                g_configExists = 1;
+                
+                /* Enable the Run button now that config exists */
+                EnableWindow(hButtonRun, TRUE);
+                
+                /* Show success message with exe path */
+                char exePath[MAX_PATH];
+                if (g_installDir[0] != '\0') {
+                    snprintf(exePath, MAX_PATH, "%s\\elgato_audio_reset.exe", g_installDir);
+                } else {
+                    strncpy(exePath, g_currentExePath, MAX_PATH);
+                }
+                
+                char msg[1024];
+                snprintf(msg, sizeof(msg), 
+                    "Configuration saved! Run via the \"Reset Audio\" button.\n\n"
+                    "Executable saved:\n%s\n\n"
+                    "You can assign the executable to a hotkey or macro button. "
+                    "If you set the config to run in the background with no notification, "
+                    "your audio will reset silently within a few seconds on key press.",
+                    exePath);
+                MessageBoxA(hwnd, msg, "Elgato Audio Reset", MB_OK | MB_ICONINFORMATION);
+                
+                /* Don't close - user can click Run or X */
+            }
+            else if (LOWORD(wParam) == ID_BUTTON_RUN) {
+                /* Run button - saves config and runs the reset */
+                readDeviceCombo(hComboPlaybackDefault, g_playbackDefault, g_playbackDefaultId);
+                readDeviceCombo(hComboPlaybackComm, g_playbackComm, g_playbackCommId);
+                readDeviceCombo(hComboRecordDefault, g_recordDefault, g_recordDefaultId);
+                readDeviceCombo(hComboRecordComm, g_recordComm, g_recordCommId);
+                
+                /* Get install folder from edit box */
+                WCHAR wInstallDir[MAX_PATH];
+                GetWindowTextW(hEditFolder, wInstallDir, MAX_PATH);
+                WideCharToMultiByte(CP_UTF8, 0, wInstallDir, -1, g_installDir, MAX_PATH, NULL, NULL);
+                
+                /* Get checkbox states */
+                HWND hCheckBg = GetDlgItem(hwnd, ID_CHECK_RUN_BACKGROUND);
+                g_runInBackground = (SendMessage(hCheckBg, BM_GETCHECK, 0, 0) == BST_CHECKED);
+                HWND hCheckNotify = GetDlgItem(hwnd, ID_CHECK_SHOW_NOTIFY);
+                g_showNotification = (SendMessage(hCheckNotify, BM_GETCHECK, 0, 0) == BST_CHECKED);
+                
+                /* Save config (moves files to install folder if path changed) */
+                saveConfig();
+                
+                /* Set flag to run the reset after GUI closes */
+                g_shouldRun = 1;
+                
+                DestroyWindow(hwnd);
+            }
+            return 0;
+        
+        case WM_ERASEBKGND: {
             HDC hdc = (HDC)wParam;
             RECT rc;
             GetClientRect(hwnd, &rc);
@@ -999,15 +1134,18 @@ static LRESULT CALLBACK MismatchDlgProc(HWND hwnd, UINT msg, WPARAM wParam, LPAR
         }
         
         case WM_CLOSE:
-            g_mismatchResult = 0; /* Default to keep current on close */
+            /* User closed via X - just close the window */
             DestroyWindow(hwnd);
             return 0;
         
         case WM_DESTROY:
             DeleteObject(hBrushBg);
+            DeleteObject(hBrushEdit);
             DeleteObject(hFont);
             DeleteObject(hFontBold);
-            DeleteObject(hFontDevice);
+            DeleteObject(hFontSmall);
+            free(g_devices);
+            g_devices = NULL;
             PostQuitMessage(0);
             return 0;
     }
@@ -1015,118 +1153,382 @@ static LRESULT CALLBACK MismatchDlgProc(HWND hwnd, UINT msg, WPARAM wParam, LPAR
     return DefWindowProcW(hwnd, msg, wParam, lParam);
 }
 
-/* ========== Show Mismatch Dialog ========== */
-/* Returns 1 if user chose "Restore Saved", 0 if "Keep Current" */
-static int showMismatchDialog(void) {
-    /* Register window class */
-    WNDCLASSW wc = {0};
-    wc.lpfnWndProc = MismatchDlgProc;
-    wc.hInstance = GetModuleHandle(NULL);
-    wc.hCursor = LoadCursor(NULL, IDC_ARROW);
-    wc.lpszClassName = L"ElgatoMismatchDlg";
-    RegisterClassW(&wc);
-    
-    /* Calculate center position */
-    int screenW = GetSystemMetrics(SM_CXSCREEN);
-    int screenH = GetSystemMetrics(SM_CYSCREEN);
-    int winW = 820, winH = 380;
-    int x = (screenW - winW) / 2;
-    int y = (screenH - winH) / 2;
-    
-    /* Create window */
-    HWND hwnd = CreateWindowExW(0, L"ElgatoMismatchDlg", L"Audio Configuration Mismatch",
-        WS_OVERLAPPED | WS_CAPTION | WS_SYSMENU,
-        x, y, winW, winH, NULL, NULL, GetModuleHandle(NULL), NULL);
-    
-    ShowWindow(hwnd, SW_SHOW);
-    UpdateWindow(hwnd);
-    
-    /* Message loop */
-    MSG msg;
-    while (GetMessage(&msg, NULL, 0, 0)) {
-        TranslateMessage(&msg);
-        DispatchMessage(&msg);
+/* ========== Status Block ========== */
+/* Progress for overlays and Stream Deck plugins without parsing the log:
+ * while a job runs, its process publishes a fixed-layout block in the shared
+ * memory section "Local\ElgatoAudioReset.Status" - the job, every step of
+ * the current graph with start and end times, the tray text and the last
+ * warning or error. Readers map it read-only and poll it at any rate,
+ * without locks or syscalls, by seqlock (statusRead below):
+ *
+ *   do { wait until sequence is even; s = sequence; copy; } while (sequence != s);
+ *
+ * Only the process holding the run mutex writes, and threads within it
+ * serialize on a critical section. The block outlives a job for as long as
+ * its process (or any reader's view) is around. Times are UTC FILETIME
+ * ticks (100 ns since 1601). New fields are only ever added at the end (size
+ * grows); STATUS_BLOCK_VERSION changes if an existing field does. The
+ * layout and the seqlock itself are in reset_core.h. */
+#define STATUS_BLOCK_NAME       "Local\\ElgatoAudioReset.Status"
+
+static struct {
+    CRITICAL_SECTION lock;
+    int lockReady;
+    HANDLE hMapping;
+    StatusBlock* block;
+    volatile LONG active;   /* A job is being published */
+} g_status = {0};
+
+static ULONGLONG statusNow(void) {
+    FILETIME ft;
+    GetSystemTimeAsFileTime(&ft);
+    return ((ULONGLONG)ft.dwHighDateTime << 32) | ft.dwLowDateTime;
+}
+
+static void statusWriteBegin(void) {
+    EnterCriticalSection(&g_status.lock);
+    statusSeqBegin(g_status.block);
+}
+
+static void statusWriteEnd(void) {
+    statusSeqEnd(g_status.block);
+    LeaveCriticalSection(&g_status.lock);
+}
+
+/* Create or reuse the section; the interactive user may map it for reading */
+static int statusOpen(void) {
+    if (g_status.block) return 1;
+    if (!g_status.lockReady) {
+        InitializeCriticalSection(&g_status.lock);
+        g_status.lockReady = 1;
     }
     
-    if (g_mismatchResult == 1) {
-        /* User chose to restore saved defaults */
-        wcsncpy(g_playbackDefault, g_savedPlaybackDefault, 256);
-        wcsncpy(g_playbackComm, g_savedPlaybackComm, 256);
-        wcsncpy(g_recordDefault, g_savedRecordDefault, 256);
-        wcsncpy(g_recordComm, g_savedRecordComm, 256);
-    } else {
-        /* User chose to keep current Windows settings */
-        wcsncpy(g_playbackDefault, g_currentPlaybackDefault, 256);
-        wcsncpy(g_playbackComm, g_currentPlaybackComm, 256);
-        wcsncpy(g_recordDefault, g_currentRecordDefault, 256);
-        wcsncpy(g_recordComm, g_currentRecordComm, 256);
+    SECURITY_ATTRIBUTES sa = { sizeof(sa), NULL, FALSE };
+    ConvertStringSecurityDescriptorToSecurityDescriptorA("D:(A;;GA;;;SY)(A;;GA;;;BA)(A;;GR;;;IU)",
+                                                         SDDL_REVISION_1, &sa.lpSecurityDescriptor, NULL);
+    g_status.hMapping = CreateFileMappingA(INVALID_HANDLE_VALUE, sa.lpSecurityDescriptor ? &sa : NULL,
+                                           PAGE_READWRITE, 0, sizeof(StatusBlock), STATUS_BLOCK_NAME);
+    int existed = (GetLastError() == ERROR_ALREADY_EXISTS);
+    if (sa.lpSecurityDescriptor) LocalFree(sa.lpSecurityDescriptor);
+    if (!g_status.hMapping) return 0;
+    
+    g_status.block = (StatusBlock*)MapViewOfFile(g_status.hMapping, FILE_MAP_WRITE, 0, 0, sizeof(StatusBlock));
+    if (!g_status.block) {
+        CloseHandle(g_status.hMapping);
+        g_status.hMapping = NULL;
+        return 0;
     }
     
-    return g_mismatchResult;
+    /* Left by an earlier instance with the same layout - keep its count */
+    StatusBlock* b = g_status.block;
+    if (existed && b->magic == STATUS_BLOCK_MAGIC && b->version == STATUS_BLOCK_VERSION &&
+        b->size == sizeof(StatusBlock)) {
+        return 1;
+    }
+    statusWriteBegin();
+    LONG sequence = b->sequence;
+    memset(b, 0, sizeof(*b));
+    b->sequence = sequence;
+    b->magic = STATUS_BLOCK_MAGIC;
+    b->version = STATUS_BLOCK_VERSION;
+    b->size = (WORD)sizeof(StatusBlock);
+    b->currentStep = -1;
+    statusWriteEnd();
+    return 1;
 }
 
-/* ========== Show Config GUI ========== */
-static void showConfigGUI(void) {
-    /* Enumerate devices first */
-    enumerateDevicesForGUI();
-    
-    /* Check for mismatch between saved config and current Windows settings */
-    if (g_configExists && hasConfigMismatch()) {
-        showMismatchDialog();
+static void statusJobBegin(int job) {
+    if (!statusOpen()) return;
+    StatusBlock* b = g_status.block;
+    statusWriteBegin();
+    b->pid = GetCurrentProcessId();
+    b->state = STATUS_RUNNING;
+    b->job = job;
+    b->currentStep = -1;
+    b->stepCount = 0;
+    b->jobStarted = statusNow();
+    b->jobFinished = 0;
+    b->lastErrorLevel = 0;
+    b->lastErrorTime = 0;
+    memset(b->steps, 0, sizeof(b->steps));
+    b->status[0] = '\0';
+    b->lastError[0] = '\0';
+    statusWriteEnd();
+    InterlockedExchange(&g_status.active, 1);
+}
+
+static void statusJobEnd(void) {
+    if (!InterlockedExchange(&g_status.active, 0)) return;
+    StatusBlock* b = g_status.block;
+    statusWriteBegin();
+    b->state = STATUS_DONE;
+    b->currentStep = -1;
+    b->jobFinished = statusNow();
+    b->jobsCompleted++;
+    statusWriteEnd();
+}
+
+/* A step graph is about to run; steps in the skip mask were done by an
+ * interrupted run */
+static void statusGraphBegin(const char* const* names, int count, unsigned int skip) {
+    if (!g_status.active) return;
+    StatusBlock* b = g_status.block;
+    ULONGLONG now = statusNow();
+    if (count > STATUS_MAX_STEPS) count = STATUS_MAX_STEPS;
+    
+    statusWriteBegin();
+    memset(b->steps, 0, sizeof(b->steps));
+    for (int i = 0; i < count; i++) {
+        snprintf(b->steps[i].name, STATUS_STEP_NAME, "%s", names[i]);
+        if (skip & (1u << i)) b->steps[i].started = b->steps[i].finished = now;
     }
+    b->stepCount = count;
+    b->currentStep = -1;
+    statusWriteEnd();
+}
+
+static void statusStepStart(int idx, const wchar_t* status) {
+    if (!g_status.active || idx >= STATUS_MAX_STEPS) return;
+    StatusBlock* b = g_status.block;
+    statusWriteBegin();
+    b->steps[idx].started = statusNow();
+    b->currentStep = idx;
+    if (status) WideCharToMultiByte(CP_UTF8, 0, status, -1, b->status, STATUS_TEXT_LEN, NULL, NULL);
+    b->status[STATUS_TEXT_LEN - 1] = '\0';
+    statusWriteEnd();
+}
+
+static void statusStepEnd(int idx) {
+    if (!g_status.active || idx >= STATUS_MAX_STEPS) return;
+    statusWriteBegin();
+    g_status.block->steps[idx].finished = statusNow();
+    statusWriteEnd();
+}
+
+/* Called for every warning and error logged while a job runs */
+static void statusNoteError(int level, const char* text) {
+    if (!g_status.active) return;
+    while (*text == ' ') text++;
+    if (strncmp(text, "[!] ", 4) == 0) text += 4;
+    
+    StatusBlock* b = g_status.block;
+    statusWriteBegin();
+    snprintf(b->lastError, STATUS_ERROR_LEN, "%s", text);
+    size_t n = strlen(b->lastError);
+    while (n > 0 && (b->lastError[n - 1] == '\n' || b->lastError[n - 1] == '\r')) b->lastError[--n] = '\0';
+    b->lastErrorLevel = level;
+    b->lastErrorTime = statusNow();
+    statusWriteEnd();
+}
+
+/* The job most recently published by any process. Returns 0 if the block
+ * can't be mapped or read. */
+static int statusLatest(StatusBlock* out) {
+    return statusOpen() && statusRead(g_status.block, out);
+}
+
+/* ========== Logging ========== */
+/* logMsg() formats on the calling thread into a slot of a fixed ring and
+ * returns; a writer thread drains the ring to stdout and the log file and
+ * flushes every LOG_FLUSH_MS. The ring is the lock-free LogRing from
+ * reset_core.h, so logging never takes a lock or touches the disk on the
+ * reset threads. logFlush() waits until everything logged so far is
+ * written - used when a run ends and at exit. Until the writer starts (or if
+ * it can't), messages are written synchronously as before. */
+#define LOG_RING_SLOTS  1024        /* Power of two */
+#define LOG_FLUSH_MS    250
+
+static LogRing g_logRing = {0};
+static HANDLE g_logHandle = NULL;       /* g_logFile's OS handle, for the crash handler */
+static HANDLE g_logWake = NULL;         /* Auto-reset; set to drain right away */
+static HANDLE g_logDrained = NULL;      /* Auto-reset; set after each drain pass */
+static DWORD g_logWriterTid = 0;
+
+/* Write straight through - the pre-writer path, and the writer's own output */
+static void logWriteSync(const char* text) {
+    if (g_logLockReady) EnterCriticalSection(&g_logLock);
+    if (g_logConsole) {
+        printf("%s", text);
+        fflush(stdout);
+    }
+    if (g_logFile) {
+        fprintf(g_logFile, "%s", text);
+        fflush(g_logFile);
+    }
+    if (g_logLockReady) LeaveCriticalSection(&g_logLock);
+}
+
+/* Drain whatever is published. Single consumer: the writer thread, or the
+ * writer's own logFlush() - logCrashHandler() drains without this, as the
+ * last thing the process does. */
+static int logDrain(void) {
+    int written = 0;
+    if (g_logLockReady) EnterCriticalSection(&g_logLock);
+    const char* text;
+    while ((text = logRingPeek(&g_logRing)) != NULL) {
+        if (g_logConsole) printf("%s", text);
+        if (g_logFile) fputs(text, g_logFile);
+        logRingPop(&g_logRing);
+        written++;
+    }
+    if (written) {
+        if (g_logConsole) fflush(stdout);
+        if (g_logFile) fflush(g_logFile);
+    }
+    if (g_logLockReady) LeaveCriticalSection(&g_logLock);
+    return written;
+}
+
+static DWORD WINAPI logWriterThread(LPVOID param) {
+    (void)param;
+    for (;;) {
+        WaitForSingleObject(g_logWake, LOG_FLUSH_MS);
+        logDrain();
+        SetEvent(g_logDrained);
+    }
+    return 0;
+}
+
+static void logEnqueue(LogRing* ring, HANDLE hWake, const char* text) {
+    LONG ticket = logRingClaim(ring);
     
-    /* Register window class */
-    WNDCLASSW wc = {0};
-    wc.lpfnWndProc = ConfigDlgProc;
-    wc.hInstance = GetModuleHandle(NULL);
-    wc.hCursor = LoadCursor(NULL, IDC_ARROW);
-    wc.lpszClassName = L"ElgatoResetConfig";
-    RegisterClassW(&wc);
-    
-    /* Calculate center position */
-    int screenW = GetSystemMetrics(SM_CXSCREEN);
-    int screenH = GetSystemMetrics(SM_CYSCREEN);
-    int winW = 520, winH = 600;
-    int x = (screenW - winW) / 2;
-    int y = (screenH - winH) / 2;
-    
-    /* Create window */
-    WCHAR windowTitle[64];
-    swprintf(windowTitle, 64, L"Elgato Audio Reset v%s", APP_VERSION);
-    HWND hwnd = CreateWindowExW(0, L"ElgatoResetConfig", windowTitle,
-        WS_OVERLAPPED | WS_CAPTION | WS_SYSMENU,
-        x, y, winW, winH, NULL, NULL, GetModuleHandle(NULL), NULL);
+    /* Ring full - wait for the writer to free this slot */
+    while (!logRingSlotFree(ring, ticket)) {
+        SetEvent(hWake);
+        SwitchToThread();
+    }
+    logRingPublish(ring, ticket, text);
+}
+
+static void logWriteV(int level, const char* fmt, va_list args) {
+    if (level < g_logLevel) return;
     
-    ShowWindow(hwnd, SW_SHOW);
-    UpdateWindow(hwnd);
+    char buf[LOG_LINE_MAX];
+    vsnprintf(buf, sizeof(buf), fmt, args);
+    buf[sizeof(buf) - 1] = '\0';
+    if (level >= LOG_WARN) statusNoteError(level, buf);
     
-    /* Message loop */
-    MSG msg;
-    while (GetMessage(&msg, NULL, 0, 0)) {
-        TranslateMessage(&msg);
-        DispatchMessage(&msg);
+    if (g_logWriterTid && GetCurrentThreadId() != g_logWriterTid) {
+        logEnqueue(&g_logRing, g_logWake, buf);
+    } else {
+        logWriteSync(buf);
     }
 }
 
-/* ========== Logging ========== */
+static void logAt(int level, const char* fmt, ...) {
+    va_list args;
+    va_start(args, fmt);
+    logWriteV(level, fmt, args);
+    va_end(args);
+}
+
 static void logMsg(const char* fmt, ...) {
     va_list args;
-    char buf[1024];
-    
     va_start(args, fmt);
-    vsnprintf(buf, sizeof(buf), fmt, args);
+    logWriteV(LOG_INFO, fmt, args);
     va_end(args);
-    
-    printf("%s", buf);
-    fflush(stdout);
-    
-    if (g_logFile) {
-        fprintf(g_logFile, "%s", buf);
-        fflush(g_logFile);
-    }
+}
+
+/* Block until everything logged before this call is written (or timeoutMs) */
+static void logFlush(DWORD timeoutMs) {
+    if (!g_logWriterTid) return;
+    if (GetCurrentThreadId() == g_logWriterTid) {
+        logDrain();
+        return;
+    }
+    
+    LONG target = g_logRing.head;
+    DWORD start = GetTickCount();
+    while (g_logRing.tail < target && GetTickCount() - start < timeoutMs) {
+        SetEvent(g_logWake);
+        WaitForSingleObject(g_logDrained, 50);
+    }
+}
+
+static void logClose(void) {
+    logFlush(INFINITE);
+    if (g_logLockReady) EnterCriticalSection(&g_logLock);
+    if (g_logFile) fclose(g_logFile);
+    g_logFile = NULL;
+    g_logHandle = NULL;
+    if (g_logLockReady) LeaveCriticalSection(&g_logLock);
+}
+
+static void logAtExit(void) {
+    logFlush(2000);
+}
+
+/* Write v as `digits` upper-case hex digits */
+static char* formatHex(char* out, ULONGLONG v, int digits) {
+    for (int i = digits - 1; i >= 0; i--) {
+        out[i] = "0123456789ABCDEF"[v & 0xF];
+        v >>= 4;
+    }
+    return out + digits;
+}
+
+/* Record the crash in the log file. The state of the process is unknown
+ * here - the heap, the CRT, the log lock or the writer thread may be what
+ * broke, and the writer rarely gets to run again - so this takes no lock,
+ * calls nothing from the CRT and never waits. It becomes the consumer: the
+ * lines already published go straight to the file handle, stopping at the
+ * first slot a producer hasn't finished, then the crash line, put together
+ * by hand on the stack. Anything the writer had in g_logFile's buffer was
+ * flushed at the end of its last pass. */
+static LONG WINAPI logCrashHandler(EXCEPTION_POINTERS* info) {
+    static const char prefix[] = "\r\n[!] Crash: exception 0x";
+    static const char at[] = " at 0x";
+    HANDLE h = g_logHandle;
+    DWORD written;
+    if (!h || h == INVALID_HANDLE_VALUE) return EXCEPTION_CONTINUE_SEARCH;
+    
+    if (g_logRing.slots) {
+        const char* text;
+        while ((text = logRingPeek(&g_logRing)) != NULL) {
+            WriteFile(h, text, (DWORD)lstrlenA(text), &written, NULL);
+            logRingPop(&g_logRing);
+        }
+    }
+    
+    char line[sizeof(prefix) + sizeof(at) + 8 + 16 + 2];
+    char* p = line;
+    memcpy(p, prefix, sizeof(prefix) - 1);
+    p += sizeof(prefix) - 1;
+    p = formatHex(p, info->ExceptionRecord->ExceptionCode, 8);
+    memcpy(p, at, sizeof(at) - 1);
+    p += sizeof(at) - 1;
+    p = formatHex(p, (ULONGLONG)(ULONG_PTR)info->ExceptionRecord->ExceptionAddress, (int)sizeof(void*) * 2);
+    *p++ = '\r';
+    *p++ = '\n';
+    WriteFile(h, line, (DWORD)(p - line), &written, NULL);
+    return EXCEPTION_CONTINUE_SEARCH;
+}
+
+static void startLogWriter(void) {
+    LogSlot* slots = (LogSlot*)malloc(LOG_RING_SLOTS * sizeof(LogSlot));
+    if (!slots) return;
+    logRingInit(&g_logRing, slots, LOG_RING_SLOTS);
+    
+    g_logWake = CreateEventA(NULL, FALSE, FALSE, NULL);
+    g_logDrained = CreateEventA(NULL, FALSE, FALSE, NULL);
+    HANDLE hThread = CreateThread(NULL, 0, logWriterThread, NULL, 0, &g_logWriterTid);
+    if (!hThread) {
+        g_logWriterTid = 0;
+        return;
+    }
+    CloseHandle(hThread);
+    
+    atexit(logAtExit);
+    SetUnhandledExceptionFilter(logCrashHandler);
 }
 
 static void initLog(const char* exePath) {
+    if (!g_logLockReady) {
+        InitializeCriticalSection(&g_logLock);
+        g_logLockReady = 1;
+        startLogWriter();
+    }
+    
     SYSTEMTIME st;
     GetLocalTime(&st);
     
@@ -1148,686 +1550,4429 @@ static void initLog(const char* exePath) {
     snprintf(g_logPath, MAX_PATH, "%s\\ElgatoReset_%02d-%s-%04d_%02d-%02d-%02d.log",
              logDir, st.wDay, months[st.wMonth], st.wYear, st.wHour, st.wMinute, st.wSecond);
     
+    /* Anything still queued belongs to the previous file */
+    logFlush(INFINITE);
+    if (g_logLockReady) EnterCriticalSection(&g_logLock);
     g_logFile = fopen(g_logPath, "w");
+    g_logHandle = g_logFile ? (HANDLE)_get_osfhandle(_fileno(g_logFile)) : NULL;
+    if (g_logLockReady) LeaveCriticalSection(&g_logLock);
 }
 
-/* ========== Protected Processes ========== */
-static const char* g_protected[] = {
-    "svchost.exe", "audiodg.exe", "System", "Idle", "dwm.exe", "explorer.exe",
-    "csrss.exe", "wininit.exe", "services.exe", "lsass.exe", "smss.exe",
-    "winlogon.exe", "fontdrvhost.exe", "sihost.exe", "taskhostw.exe",
-    "RuntimeBroker.exe", "ShellExperienceHost.exe", "SearchHost.exe",
-    "ctfmon.exe", "conhost.exe", "dllhost.exe", "powershell.exe", "cmd.exe",
-    "Code.exe", "devenv.exe", "elgato_reset.exe",
-    NULL
-};
+/* ========== Tracing ========== */
+/* Optional span recorder (TRACE=1 in config.txt). Every step and the COM,
+ * service, process and wait operations inside it record a begin/end pair from
+ * QueryPerformanceCounter; at the end of the run the spans are written as
+ * Chrome trace-event JSON next to the log, which opens directly in Perfetto
+ * (ui.perfetto.dev) or chrome://tracing. When tracing is off traceBegin()
+ * returns 0 and traceEnd() returns on its first check. */
+#define TRACE_MAX_EVENTS 4096
 
-static int isProtected(const char* name) {
-    for (int i = 0; g_protected[i]; i++) {
-        if (_stricmp(name, g_protected[i]) == 0) return 1;
+typedef struct TraceEvent {
+    const char* category;   /* Static strings only */
+    const char* name;
+    char arg[64];           /* Optional detail (service, app, device...) */
+    LONGLONG start;
+    LONGLONG end;
+    DWORD tid;
+} TraceEvent;
+
+static TraceEvent* g_traceEvents = NULL;
+static volatile LONG g_traceCount = 0;
+static LARGE_INTEGER g_traceFreq;
+static LARGE_INTEGER g_traceOrigin;
+
+static void traceInit(void) {
+    if (!g_traceEnabled) return;
+    if (g_traceEvents) {
+        /* Resident mode: reuse the buffer for the next reset */
+        memset(g_traceEvents, 0, TRACE_MAX_EVENTS * sizeof(TraceEvent));
+        g_traceCount = 0;
+    } else {
+        g_traceEvents = (TraceEvent*)calloc(TRACE_MAX_EVENTS, sizeof(TraceEvent));
+        if (!g_traceEvents) {
+            g_traceEnabled = 0;
+            return;
+        }
     }
-    return 0;
+    QueryPerformanceFrequency(&g_traceFreq);
+    QueryPerformanceCounter(&g_traceOrigin);
 }
 
-static int isElgatoProcess(const char* name) {
-    return (strstr(name, "WaveLink") || strstr(name, "StreamDeck") || strstr(name, "Elgato"));
+/* Returns the span start, or 0 when tracing is off */
+static LONGLONG traceBegin(void) {
+    if (!g_traceEvents) return 0;
+    LARGE_INTEGER now;
+    QueryPerformanceCounter(&now);
+    return now.QuadPart;
 }
 
-/* ========== Registry Path Discovery ========== */
-static int findInstallPath(const char* appName, char* outPath, size_t outLen) {
-    const char* regPaths[] = {
-        "SOFTWARE\\Microsoft\\Windows\\CurrentVersion\\Uninstall",
-        "SOFTWARE\\WOW6432Node\\Microsoft\\Windows\\CurrentVersion\\Uninstall",
-        NULL
-    };
+static void traceEnd(const char* category, const char* name, const char* arg, LONGLONG start) {
+    if (!start) return;
+    
+    LARGE_INTEGER now;
+    QueryPerformanceCounter(&now);
+    LONG idx = InterlockedIncrement(&g_traceCount) - 1;
+    if (idx >= TRACE_MAX_EVENTS) return;  /* Buffer full - drop */
+    
+    TraceEvent* ev = &g_traceEvents[idx];
+    ev->category = category;
+    ev->name = name;
+    if (arg) {
+        strncpy(ev->arg, arg, sizeof(ev->arg) - 1);
+        ev->arg[sizeof(ev->arg) - 1] = '\0';
+    }
+    ev->start = start;
+    ev->end = now.QuadPart;
+    ev->tid = GetCurrentThreadId();
+}
+
+static void traceWriteJsonString(FILE* f, const char* str) {
+    fputc('"', f);
+    for (; *str; str++) {
+        unsigned char c = (unsigned char)*str;
+        if (c == '"' || c == '\\') fprintf(f, "\\%c", c);
+        else if (c < 0x20) fprintf(f, "\\u%04x", c);
+        else fputc(c, f);
+    }
+    fputc('"', f);
+}
+
+/* Write logs/<log name>_trace.json. Call once all steps have finished. */
+static void traceWrite(void) {
+    if (!g_traceEvents || !g_logPath[0]) return;
+    
+    char tracePath[MAX_PATH];
+    strncpy(tracePath, g_logPath, MAX_PATH);
+    tracePath[MAX_PATH - 1] = '\0';
+    char* ext = strrchr(tracePath, '.');
+    if (ext) *ext = '\0';
+    strncat(tracePath, "_trace.json", MAX_PATH - strlen(tracePath) - 1);
+    
+    FILE* f = fopen(tracePath, "w");
+    if (!f) return;
     
-    for (int r = 0; regPaths[r]; r++) {
-        HKEY hKey;
-        if (RegOpenKeyExA(HKEY_LOCAL_MACHINE, regPaths[r], 0, KEY_READ, &hKey) == ERROR_SUCCESS) {
-            char subKeyName[256];
-            DWORD subKeyLen;
-            for (DWORD i = 0; ; i++) {
-                subKeyLen = sizeof(subKeyName);
-                if (RegEnumKeyExA(hKey, i, subKeyName, &subKeyLen, NULL, NULL, NULL, NULL) != ERROR_SUCCESS)
-                    break;
-                
-                HKEY hSubKey;
-                char fullPath[512];
-                snprintf(fullPath, sizeof(fullPath), "%s\\%s", regPaths[r], subKeyName);
-                
-                if (RegOpenKeyExA(HKEY_LOCAL_MACHINE, fullPath, 0, KEY_READ, &hSubKey) == ERROR_SUCCESS) {
-                    char displayName[256] = {0};
-                    DWORD displayLen = sizeof(displayName);
-                    RegQueryValueExA(hSubKey, "DisplayName", NULL, NULL, (LPBYTE)displayName, &displayLen);
-                    
-                    if (strstr(displayName, appName)) {
-                        char installLoc[MAX_PATH] = {0};
-                        DWORD installLen = sizeof(installLoc);
-                        if (RegQueryValueExA(hSubKey, "InstallLocation", NULL, NULL, (LPBYTE)installLoc, &installLen) == ERROR_SUCCESS
-                            && installLoc[0] != '\0') {  /* Make sure it's not empty! */
-                            strncpy(outPath, installLoc, outLen);
-                            RegCloseKey(hSubKey);
-                            RegCloseKey(hKey);
-                            return 1;
-                        }
-                    }
-                    RegCloseKey(hSubKey);
-                }
+    LONG count = g_traceCount < TRACE_MAX_EVENTS ? g_traceCount : TRACE_MAX_EVENTS;
+    double usPerTick = 1000000.0 / (double)g_traceFreq.QuadPart;
+    
+    fprintf(f, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+    fprintf(f, "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,\"args\":{\"name\":\"Elgato Audio Reset\"}}");
+    for (LONG i = 0; i < count; i++) {
+        const TraceEvent* ev = &g_traceEvents[i];
+        if (!ev->name) continue;  /* Slot reserved but never filled */
+        fprintf(f, ",\n{\"name\":");
+        traceWriteJsonString(f, ev->name);
+        fprintf(f, ",\"cat\":");
+        traceWriteJsonString(f, ev->category);
+        fprintf(f, ",\"ph\":\"X\",\"pid\":1,\"tid\":%lu,\"ts\":%.1f,\"dur\":%.1f",
+                ev->tid, (ev->start - g_traceOrigin.QuadPart) * usPerTick,
+                (ev->end - ev->start) * usPerTick);
+        if (ev->arg[0]) {
+            fprintf(f, ",\"args\":{\"detail\":");
+            traceWriteJsonString(f, ev->arg);
+            fputc('}', f);
+        }
+        fputc('}', f);
+    }
+    fprintf(f, "\n]}\n");
+    fclose(f);
+    
+    if (g_traceCount > TRACE_MAX_EVENTS) {
+        logAt(LOG_WARN, "[!] Trace buffer full - %ld spans dropped.\n", g_traceCount - TRACE_MAX_EVENTS);
+    }
+    logMsg("[i] Trace saved to:\n    %s\n", tracePath);
+}
+
+/* ========== Endpoint Snapshot ========== */
+/* One EnumAudioEndpoints pass captures every endpoint's ID, friendly name,
+ * data flow and state. Names are case-folded once and hashed together with the
+ * flow, so each later lookup is O(1) instead of re-enumerating the collection
+ * and reopening every property store. */
+DEFINE_GUID(MY_IID_IMMEndpoint, 0x1BE09788, 0x6894, 0x4089, 0x85, 0x86, 0x9A, 0x2A, 0x6C, 0x26, 0x5A, 0xC5);
+
+typedef struct EndpointEntry {
+    LPWSTR id;          /* From IMMDevice_GetId (CoTaskMem) */
+    WCHAR* name;        /* Friendly name as reported */
+    WCHAR* folded;      /* Lower-cased name used for lookups */
+    EDataFlow dataFlow;
+    DWORD state;
+    UINT formFactor;    /* EndpointFormFactor */
+    unsigned int hash;
+} EndpointEntry;
+
+typedef struct EndpointSnapshot {
+    EndpointEntry* entries;
+    int count;
+    int* slots;         /* Open-addressed table of entry indices, -1 = empty */
+    int* idSlots;       /* Same, keyed on endpoint ID */
+    unsigned int slotMask;
+} EndpointSnapshot;
+
+static void foldName(WCHAR* dst, const WCHAR* src, size_t len) {
+    size_t i = 0;
+    for (; i + 1 < len && src[i]; i++) dst[i] = (WCHAR)towlower(src[i]);
+    dst[i] = L'\0';
+}
+
+/* FNV-1a over the folded name, mixed with the data flow */
+static unsigned int hashEndpointName(const WCHAR* folded, EDataFlow dataFlow) {
+    unsigned int h = 2166136261u ^ (unsigned int)dataFlow;
+    for (; *folded; folded++) {
+        h ^= (unsigned int)*folded;
+        h *= 16777619u;
+    }
+    return h;
+}
+
+static unsigned int hashEndpointId(const WCHAR* id) {
+    unsigned int h = 2166136261u;
+    for (; *id; id++) {
+        h ^= (unsigned int)*id;
+        h *= 16777619u;
+    }
+    return h;
+}
+
+static void endpointSnapshotFree(EndpointSnapshot* snap) {
+    for (int i = 0; i < snap->count; i++) {
+        CoTaskMemFree(snap->entries[i].id);
+        free(snap->entries[i].name);
+        free(snap->entries[i].folded);
+    }
+    free(snap->entries);
+    free(snap->slots);
+    free(snap->idSlots);
+    memset(snap, 0, sizeof(*snap));
+}
+
+/* Capture all endpoints matching stateMask. Returns 0 on failure (snap is left empty). */
+static int endpointSnapshotBuild(EndpointSnapshot* snap, IMMDeviceEnumerator* pEnum, DWORD stateMask) {
+    memset(snap, 0, sizeof(*snap));
+    LONGLONG span = traceBegin();
+    
+    IMMDeviceCollection* pCol = NULL;
+    if (FAILED(IMMDeviceEnumerator_EnumAudioEndpoints(pEnum, eAll, stateMask, &pCol))) return 0;
+    
+    UINT count = 0;
+    IMMDeviceCollection_GetCount(pCol, &count);
+    
+    unsigned int slotCount = 8;
+    while (slotCount < count * 2) slotCount <<= 1;
+    snap->entries = (EndpointEntry*)calloc(count ? count : 1, sizeof(EndpointEntry));
+    snap->slots = (int*)malloc(slotCount * sizeof(int));
+    snap->idSlots = (int*)malloc(slotCount * sizeof(int));
+    if (!snap->entries || !snap->slots || !snap->idSlots) {
+        IMMDeviceCollection_Release(pCol);
+        endpointSnapshotFree(snap);
+        return 0;
+    }
+    memset(snap->slots, 0xFF, slotCount * sizeof(int));
+    memset(snap->idSlots, 0xFF, slotCount * sizeof(int));
+    snap->slotMask = slotCount - 1;
+    
+    for (UINT i = 0; i < count; i++) {
+        IMMDevice* pDev = NULL;
+        if (FAILED(IMMDeviceCollection_Item(pCol, i, &pDev))) continue;
+        
+        EndpointEntry* e = &snap->entries[snap->count];
+        IMMEndpoint* pEndpoint = NULL;
+        IPropertyStore* pStore = NULL;
+        
+        if (SUCCEEDED(IMMDevice_GetId(pDev, &e->id)) &&
+            SUCCEEDED(IMMDevice_QueryInterface(pDev, &MY_IID_IMMEndpoint, (void**)&pEndpoint)) &&
+            SUCCEEDED(IMMEndpoint_GetDataFlow(pEndpoint, &e->dataFlow)) &&
+            SUCCEEDED(IMMDevice_OpenPropertyStore(pDev, STGM_READ, &pStore))) {
+            PROPVARIANT pv;
+            PropVariantInit(&pv);
+            if (SUCCEEDED(IPropertyStore_GetValue(pStore, &PKEY_Device_FriendlyName, &pv)) && pv.pwszVal) {
+                size_t len = wcslen(pv.pwszVal) + 1;
+                e->name = _wcsdup(pv.pwszVal);
+                e->folded = (WCHAR*)malloc(len * sizeof(WCHAR));
+                if (e->folded) foldName(e->folded, pv.pwszVal, len);
+                PropVariantClear(&pv);
+            }
+            e->formFactor = UnknownFormFactor;
+            PropVariantInit(&pv);
+            if (SUCCEEDED(IPropertyStore_GetValue(pStore, &PKEY_AudioEndpoint_FormFactor, &pv)) && pv.vt == VT_UI4) {
+                e->formFactor = pv.ulVal;
+            }
+            PropVariantClear(&pv);
+        }
+        if (pStore) IPropertyStore_Release(pStore);
+        if (pEndpoint) IMMEndpoint_Release(pEndpoint);
+        IMMDevice_GetState(pDev, &e->state);
+        IMMDevice_Release(pDev);
+        
+        if (!e->id || !e->name || !e->folded) {
+            CoTaskMemFree(e->id);
+            free(e->name);
+            free(e->folded);
+            memset(e, 0, sizeof(*e));
+            continue;
+        }
+        
+        /* First endpoint with a given name wins, matching the old linear scan */
+        e->hash = hashEndpointName(e->folded, e->dataFlow);
+        unsigned int slot = e->hash & snap->slotMask;
+        int duplicate = 0;
+        while (snap->slots[slot] >= 0) {
+            const EndpointEntry* other = &snap->entries[snap->slots[slot]];
+            if (other->hash == e->hash && other->dataFlow == e->dataFlow && wcscmp(other->folded, e->folded) == 0) {
+                duplicate = 1;
+                break;
             }
-            RegCloseKey(hKey);
+            slot = (slot + 1) & snap->slotMask;
+        }
+        if (!duplicate) snap->slots[slot] = snap->count;
+        
+        /* IDs are unique */
+        slot = hashEndpointId(e->id) & snap->slotMask;
+        while (snap->idSlots[slot] >= 0) slot = (slot + 1) & snap->slotMask;
+        snap->idSlots[slot] = snap->count;
+        snap->count++;
+    }
+    
+    IMMDeviceCollection_Release(pCol);
+    traceEnd("com", "endpointSnapshotBuild", NULL, span);
+    return 1;
+}
+
+static const EndpointEntry* endpointSnapshotFind(const EndpointSnapshot* snap, const WCHAR* name, EDataFlow dataFlow) {
+    if (!snap->slots || !name[0]) return NULL;
+    
+    WCHAR folded[256];
+    foldName(folded, name, 256);
+    unsigned int hash = hashEndpointName(folded, dataFlow);
+    
+    for (unsigned int slot = hash & snap->slotMask; snap->slots[slot] >= 0; slot = (slot + 1) & snap->slotMask) {
+        const EndpointEntry* e = &snap->entries[snap->slots[slot]];
+        if (e->hash == hash && e->dataFlow == dataFlow && wcscmp(e->folded, folded) == 0) return e;
+    }
+    return NULL;
+}
+
+static const EndpointEntry* endpointSnapshotFindId(const EndpointSnapshot* snap, const WCHAR* id) {
+    if (!snap->idSlots || !id[0]) return NULL;
+    
+    unsigned int hash = hashEndpointId(id);
+    for (unsigned int slot = hash & snap->slotMask; snap->idSlots[slot] >= 0; slot = (slot + 1) & snap->slotMask) {
+        const EndpointEntry* e = &snap->entries[snap->idSlots[slot]];
+        if (wcscmp(e->id, id) == 0) return e;
+    }
+    return NULL;
+}
+
+/* ========== Message Pumping ========== */
+/* Threads that own windows keep serving messages while they wait. Posted
+ * and input messages are dispatched only by the tray and reset loops, where
+ * re-entering the window procedure is expected; a WM_QUIT met there is
+ * posted again so the thread's own message loop still ends. Other waits
+ * serve only messages sent from other threads. */
+
+/* Dispatch everything queued. Returns 0 if it met WM_QUIT (re-posted). */
+static int pumpMessages(void) {
+    MSG msg;
+    while (PeekMessageW(&msg, NULL, 0, 0, PM_REMOVE)) {
+        if (msg.message == WM_QUIT) {
+            PostQuitMessage((int)msg.wParam);
+            return 0;
+        }
+        TranslateMessage(&msg);
+        DispatchMessageW(&msg);
+    }
+    return 1;
+}
+
+/* Deliver messages sent from other threads; the posted queue is left alone */
+static void serveSentMessages(void) {
+    MSG msg;
+    PeekMessageW(&msg, NULL, 0, 0, PM_NOREMOVE | PM_QS_SENDMESSAGE);
+}
+
+/* Wait for h while serving messages: all of them if pumpAll (until WM_QUIT
+ * turns up), else only sent ones. Returns the wait result for h. */
+static DWORD waitWithMessages(HANDLE h, int pumpAll) {
+    DWORD wake = pumpAll ? QS_ALLINPUT : QS_SENDMESSAGE;
+    DWORD result;
+    while ((result = MsgWaitForMultipleObjects(1, &h, FALSE, INFINITE, wake)) == WAIT_OBJECT_0 + 1) {
+        if (wake == QS_SENDMESSAGE) serveSentMessages();
+        else if (!pumpMessages()) wake = QS_SENDMESSAGE;
+    }
+    return result;
+}
+
+/* ========== Audio Actor ========== */
+/* One thread owns every audio COM object for the life of the process: the
+ * device enumerator, the IPolicyConfig client, the endpoint notification
+ * registrations and the volume objects that carry volume callbacks. It lives
+ * in the MTA and serves a FIFO of typed commands, so no other thread
+ * initializes COM or creates these objects, and the GUI and tray threads keep
+ * serving sent messages while a command runs. A restart of the audio services (or
+ * a failed enumeration) marks the objects stale; the next command probes the
+ * enumerator and, if it is dead, recreates both objects, re-registers every
+ * subscription and signals it so subscribers re-read. */
+DEFINE_GUID(MY_IID_IUnknown, 0x00000000, 0x0000, 0x0000, 0xC0, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x46);
+DEFINE_GUID(MY_IID_IMMNotificationClient, 0x7991EEC9, 0x7E89, 0x4D85, 0x83, 0x90, 0x6C, 0x70, 0x3C, 0xEC, 0x60, 0xC0);
+
+#define MAX_AUDIO_SUBSCRIPTIONS 8
+#define MAX_VOLUME_WATCHES      32
+
+/* What a subscription wants to be signalled for */
+#define AUDIO_EVENT_ENDPOINTS   1   /* Endpoint added, removed, state or name changed */
+#define AUDIO_EVENT_DEFAULTS    2   /* A default device changed */
+
+enum {
+    AUDIO_CMD_ENUMERATE,        /* stateMask -> *snapshot */
+    AUDIO_CMD_GET_STATE,        /* id -> state */
+    AUDIO_CMD_GET_DEFAULTS,     /* -> defaults[4] (+ defaultIds[4]): render console/comms, capture console/comms */
+    AUDIO_CMD_SET_DEFAULT,      /* id, role */
+    AUDIO_CMD_GET_VOLUME,       /* id -> level */
+    AUDIO_CMD_GET_MUTE,         /* id -> mute */
+    AUDIO_CMD_SET_VOLUME,       /* id, level, context */
+    AUDIO_CMD_MUTE,             /* id, mute, context */
+    AUDIO_CMD_SUBSCRIBE,        /* hEvent, events: signalled on every AUDIO_EVENT_* asked for */
+    AUDIO_CMD_UNSUBSCRIBE,      /* hEvent */
+    AUDIO_CMD_WATCH_VOLUME,     /* id, callback -> level */
+    AUDIO_CMD_UNWATCH_VOLUME,   /* callback */
+    AUDIO_CMD_COUNT
+};
+
+static const char* g_audioCommandNames[AUDIO_CMD_COUNT] = {
+    "enumerate", "get-state", "get-defaults", "set-default", "get-volume", "get-mute",
+    "set-volume", "mute", "subscribe", "unsubscribe", "watch-volume", "unwatch-volume"
+};
+
+typedef struct AudioCommand {
+    int kind;
+    const WCHAR* id;
+    ERole role;
+    DWORD stateMask;
+    float level;                    /* In for SET_VOLUME, out for GET/WATCH_VOLUME */
+    BOOL mute;
+    const GUID* context;            /* Event context for volume/mute changes */
+    HANDLE hEvent;
+    DWORD events;
+    IAudioEndpointVolumeCallback* callback;
+    EndpointSnapshot* snapshot;
+    WCHAR (*defaults)[256];
+    WCHAR (*defaultIds)[MAX_ENDPOINT_ID];   /* Optional */
+    DWORD state;
+    int renewed;                    /* A watched endpoint had to be re-activated */
+    HRESULT hr;
+    HANDLE hDone;
+    struct AudioCommand* next;
+} AudioCommand;
+
+typedef struct AudioSubscription {
+    IMMNotificationClient client;   /* Embedded so the callbacks can find the event */
+    HANDLE hEvent;                  /* NULL = free slot */
+    DWORD events;                   /* AUDIO_EVENT_* */
+    int registered;
+} AudioSubscription;
+
+/* A volume callback stays attached to one endpoint; the volume object is
+ * dropped when the endpoint dies and re-activated on the next use */
+typedef struct VolumeWatch {
+    IAudioEndpointVolumeCallback* callback;     /* NULL = free slot */
+    IAudioEndpointVolume* pVol;
+    WCHAR id[MAX_ENDPOINT_ID];
+} VolumeWatch;
+
+typedef struct AudioActor {
+    CRITICAL_SECTION lock;          /* Guards the queue and subscription events */
+    CONDITION_VARIABLE queued;
+    AudioCommand* head;
+    AudioCommand* tail;
+    int running;
+    HANDLE hThread;
+    volatile LONG stale;            /* Audio services restarted since the last probe */
+    /* Owned by the actor thread */
+    IMMDeviceEnumerator* pEnum;
+    IPolicyConfig* pPolicy;
+    AudioSubscription subs[MAX_AUDIO_SUBSCRIPTIONS];
+    VolumeWatch watches[MAX_VOLUME_WATCHES];
+} AudioActor;
+
+static AudioActor g_audio = {0};
+
+#define SUBSCRIPTION_FROM_CLIENT(p) ((AudioSubscription*)((char*)(p) - offsetof(AudioSubscription, client)))
+
+static HRESULT STDMETHODCALLTYPE NotifyClient_QueryInterface(IMMNotificationClient* This, REFIID riid, void** ppv) {
+    if (IsEqualIID(riid, &MY_IID_IUnknown) || IsEqualIID(riid, &MY_IID_IMMNotificationClient)) {
+        *ppv = This;
+        return S_OK;
+    }
+    *ppv = NULL;
+    return E_NOINTERFACE;
+}
+
+/* Slots are static and unregistered before reuse, so counts are nominal */
+static ULONG STDMETHODCALLTYPE NotifyClient_AddRef(IMMNotificationClient* This) { (void)This; return 1; }
+static ULONG STDMETHODCALLTYPE NotifyClient_Release(IMMNotificationClient* This) { (void)This; return 1; }
+
+/* Runs on a COM worker thread. Under the lock so that once actorUnsubscribe()
+ * has cleared the slot, the subscriber can close its event without a late
+ * callback signalling the closed (or reused) handle. */
+static void notifyClientSignal(IMMNotificationClient* This, DWORD event) {
+    AudioSubscription* s = SUBSCRIPTION_FROM_CLIENT(This);
+    EnterCriticalSection(&g_audio.lock);
+    if (s->hEvent && (s->events & event)) SetEvent(s->hEvent);
+    LeaveCriticalSection(&g_audio.lock);
+}
+
+static HRESULT STDMETHODCALLTYPE NotifyClient_OnDeviceStateChanged(IMMNotificationClient* This, LPCWSTR id, DWORD state) {
+    (void)id; (void)state;
+    notifyClientSignal(This, AUDIO_EVENT_ENDPOINTS);
+    return S_OK;
+}
+
+static HRESULT STDMETHODCALLTYPE NotifyClient_OnDeviceAdded(IMMNotificationClient* This, LPCWSTR id) {
+    (void)id;
+    notifyClientSignal(This, AUDIO_EVENT_ENDPOINTS);
+    return S_OK;
+}
+
+static HRESULT STDMETHODCALLTYPE NotifyClient_OnDeviceRemoved(IMMNotificationClient* This, LPCWSTR id) {
+    (void)id;
+    notifyClientSignal(This, AUDIO_EVENT_ENDPOINTS);
+    return S_OK;
+}
+
+static HRESULT STDMETHODCALLTYPE NotifyClient_OnDefaultDeviceChanged(IMMNotificationClient* This, EDataFlow flow, ERole role, LPCWSTR id) {
+    (void)flow; (void)role; (void)id;
+    notifyClientSignal(This, AUDIO_EVENT_DEFAULTS);
+    return S_OK;
+}
+
+static HRESULT STDMETHODCALLTYPE NotifyClient_OnPropertyValueChanged(IMMNotificationClient* This, LPCWSTR id, const PROPERTYKEY key) {
+    (void)id;
+    /* WaveLink names its endpoints after creating them */
+    if (IsEqualGUID(&key.fmtid, &PKEY_Device_FriendlyName.fmtid) && key.pid == PKEY_Device_FriendlyName.pid) {
+        notifyClientSignal(This, AUDIO_EVENT_ENDPOINTS);
+    }
+    return S_OK;
+}
+
+static IMMNotificationClientVtbl g_notifyClientVtbl = {
+    NotifyClient_QueryInterface,
+    NotifyClient_AddRef,
+    NotifyClient_Release,
+    NotifyClient_OnDeviceStateChanged,
+    NotifyClient_OnDeviceAdded,
+    NotifyClient_OnDeviceRemoved,
+    NotifyClient_OnDefaultDeviceChanged,
+    NotifyClient_OnPropertyValueChanged
+};
+
+static HRESULT createDeviceEnumerator(IMMDeviceEnumerator** ppEnum) {
+    LONGLONG span = traceBegin();
+    HRESULT hr = CoCreateInstance(&MY_CLSID_MMDeviceEnumerator, NULL, CLSCTX_ALL,
+                                  &MY_IID_IMMDeviceEnumerator, (void**)ppEnum);
+    traceEnd("com", "CoCreateInstance", "MMDeviceEnumerator", span);
+    return hr;
+}
+
+static HRESULT createPolicyConfig(IPolicyConfig** ppPolicy) {
+    LONGLONG span = traceBegin();
+    HRESULT hr = CoCreateInstance(&CLSID_PolicyConfigClient, NULL, CLSCTX_ALL,
+                                  &IID_IPolicyConfig, (void**)ppPolicy);
+    traceEnd("com", "CoCreateInstance", "PolicyConfigClient", span);
+    return hr;
+}
+
+/* Everything below up to audioActorThread runs on the actor thread only */
+static void actorDetachWatch(VolumeWatch* w) {
+    if (!w->pVol) return;
+    IAudioEndpointVolume_UnregisterControlChangeNotify(w->pVol, w->callback);
+    IAudioEndpointVolume_Release(w->pVol);
+    w->pVol = NULL;
+}
+
+static HRESULT actorActivateVolume(const WCHAR* id, IAudioEndpointVolume** ppVol) {
+    *ppVol = NULL;
+    IMMDevice* pDev = NULL;
+    HRESULT hr = g_audio.pEnum ? IMMDeviceEnumerator_GetDevice(g_audio.pEnum, id, &pDev) : E_FAIL;
+    if (FAILED(hr)) return hr;
+    hr = IMMDevice_Activate(pDev, &MY_IID_IAudioEndpointVolume, CLSCTX_ALL, NULL, (void**)ppVol);
+    IMMDevice_Release(pDev);
+    if (SUCCEEDED(hr) && !*ppVol) hr = E_FAIL;
+    return hr;
+}
+
+/* Subscribe before anyone reads the level so a jump in between isn't lost */
+static HRESULT actorAttachWatch(VolumeWatch* w) {
+    actorDetachWatch(w);
+    HRESULT hr = actorActivateVolume(w->id, &w->pVol);
+    if (SUCCEEDED(hr)) hr = IAudioEndpointVolume_RegisterControlChangeNotify(w->pVol, w->callback);
+    return hr;
+}
+
+static VolumeWatch* actorFindWatch(IAudioEndpointVolumeCallback* callback, const WCHAR* id) {
+    for (int i = 0; i < MAX_VOLUME_WATCHES; i++) {
+        VolumeWatch* w = &g_audio.watches[i];
+        if (!w->callback) continue;
+        if (callback ? w->callback == callback : wcscmp(w->id, id) == 0) return w;
+    }
+    return NULL;
+}
+
+static void actorConnect(void) {
+    if (FAILED(createDeviceEnumerator(&g_audio.pEnum))) g_audio.pEnum = NULL;
+    if (FAILED(createPolicyConfig(&g_audio.pPolicy))) g_audio.pPolicy = NULL;
+    if (!g_audio.pEnum) return;
+    for (int i = 0; i < MAX_AUDIO_SUBSCRIPTIONS; i++) {
+        AudioSubscription* s = &g_audio.subs[i];
+        if (!s->hEvent) continue;
+        s->registered = SUCCEEDED(IMMDeviceEnumerator_RegisterEndpointNotificationCallback(g_audio.pEnum, &s->client));
+    }
+}
+
+/* Subscriptions and watches keep their slots and are re-attached on reconnect */
+static void actorDisconnect(void) {
+    for (int i = 0; i < MAX_VOLUME_WATCHES; i++) actorDetachWatch(&g_audio.watches[i]);
+    for (int i = 0; i < MAX_AUDIO_SUBSCRIPTIONS; i++) {
+        AudioSubscription* s = &g_audio.subs[i];
+        if (s->registered) IMMDeviceEnumerator_UnregisterEndpointNotificationCallback(g_audio.pEnum, &s->client);
+        s->registered = 0;
+    }
+    if (g_audio.pPolicy) g_audio.pPolicy->lpVtbl->Release(g_audio.pPolicy);
+    if (g_audio.pEnum) IMMDeviceEnumerator_Release(g_audio.pEnum);
+    g_audio.pPolicy = NULL;
+    g_audio.pEnum = NULL;
+}
+
+static void actorRevalidate(void) {
+    if (!InterlockedExchange(&g_audio.stale, 0) && g_audio.pEnum && g_audio.pPolicy) return;
+    
+    if (g_audio.pEnum && g_audio.pPolicy) {
+        IMMDeviceCollection* pColl = NULL;
+        if (SUCCEEDED(IMMDeviceEnumerator_EnumAudioEndpoints(g_audio.pEnum, eAll, DEVICE_STATE_ACTIVE, &pColl))) {
+            IMMDeviceCollection_Release(pColl);
+            return;
+        }
+    }
+    actorDisconnect();
+    actorConnect();
+    if (!g_audio.pEnum) return;
+    
+    /* Anything may have changed while the objects were dead */
+    for (int i = 0; i < MAX_AUDIO_SUBSCRIPTIONS; i++) {
+        if (g_audio.subs[i].registered) SetEvent(g_audio.subs[i].hEvent);
+    }
+}
+
+/* Friendly name (and optionally ID) of the current default endpoint for a
+ * flow/role ("" if none) */
+static void actorDefaultName(EDataFlow dataFlow, ERole role, WCHAR* out, size_t len, WCHAR* idOut) {
+    out[0] = L'\0';
+    if (idOut) idOut[0] = L'\0';
+    IMMDevice* pDefault = NULL;
+    if (FAILED(IMMDeviceEnumerator_GetDefaultAudioEndpoint(g_audio.pEnum, dataFlow, role, &pDefault))) return;
+    
+    LPWSTR id = NULL;
+    if (idOut && SUCCEEDED(IMMDevice_GetId(pDefault, &id)) && id) {
+        if (wcslen(id) < MAX_ENDPOINT_ID) wcscpy(idOut, id);
+        CoTaskMemFree(id);
+    }
+    
+    IPropertyStore* pStore = NULL;
+    if (SUCCEEDED(IMMDevice_OpenPropertyStore(pDefault, STGM_READ, &pStore))) {
+        PROPVARIANT pv;
+        PropVariantInit(&pv);
+        if (SUCCEEDED(IPropertyStore_GetValue(pStore, &PKEY_Device_FriendlyName, &pv)) && pv.pwszVal) {
+            wcsncpy(out, pv.pwszVal, len - 1);
+            out[len - 1] = L'\0';
+            PropVariantClear(&pv);
+        }
+        IPropertyStore_Release(pStore);
+    }
+    IMMDevice_Release(pDefault);
+}
+
+static HRESULT actorApplyVolume(IAudioEndpointVolume* pVol, AudioCommand* cmd) {
+    switch (cmd->kind) {
+    case AUDIO_CMD_GET_VOLUME:
+        return IAudioEndpointVolume_GetMasterVolumeLevelScalar(pVol, &cmd->level);
+    case AUDIO_CMD_GET_MUTE:
+        return IAudioEndpointVolume_GetMute(pVol, &cmd->mute);
+    case AUDIO_CMD_SET_VOLUME:
+        return IAudioEndpointVolume_SetMasterVolumeLevelScalar(pVol, cmd->level, cmd->context);
+    default:
+        return IAudioEndpointVolume_SetMute(pVol, cmd->mute, cmd->context);
+    }
+}
+
+/* Uses the watched volume object when the endpoint has one (re-activating it
+ * once if it died with the audio service), else a temporary one */
+static HRESULT actorVolumeCommand(AudioCommand* cmd) {
+    VolumeWatch* w = actorFindWatch(NULL, cmd->id);
+    if (!w) {
+        IAudioEndpointVolume* pVol = NULL;
+        HRESULT hr = actorActivateVolume(cmd->id, &pVol);
+        if (FAILED(hr)) return hr;
+        hr = actorApplyVolume(pVol, cmd);
+        IAudioEndpointVolume_Release(pVol);
+        return hr;
+    }
+    
+    HRESULT hr = w->pVol ? actorApplyVolume(w->pVol, cmd) : E_FAIL;
+    if (FAILED(hr) && SUCCEEDED(actorAttachWatch(w))) {
+        cmd->renewed = 1;
+        hr = actorApplyVolume(w->pVol, cmd);
+    }
+    return hr;
+}
+
+static HRESULT actorWatchVolume(AudioCommand* cmd) {
+    if (wcslen(cmd->id) >= MAX_ENDPOINT_ID) return E_INVALIDARG;
+    VolumeWatch* w = actorFindWatch(cmd->callback, NULL);
+    for (int i = 0; !w && i < MAX_VOLUME_WATCHES; i++) {
+        if (!g_audio.watches[i].callback) w = &g_audio.watches[i];
+    }
+    if (!w) return E_OUTOFMEMORY;
+    
+    actorDetachWatch(w);
+    w->callback = cmd->callback;
+    wcscpy(w->id, cmd->id);
+    HRESULT hr = actorAttachWatch(w);
+    if (SUCCEEDED(hr)) hr = IAudioEndpointVolume_GetMasterVolumeLevelScalar(w->pVol, &cmd->level);
+    if (FAILED(hr)) {
+        actorDetachWatch(w);
+        w->callback = NULL;
+    }
+    return hr;
+}
+
+static HRESULT actorSubscribe(HANDLE hEvent, DWORD events) {
+    for (int i = 0; i < MAX_AUDIO_SUBSCRIPTIONS; i++) {
+        AudioSubscription* s = &g_audio.subs[i];
+        if (s->hEvent) continue;
+        s->client.lpVtbl = &g_notifyClientVtbl;
+        EnterCriticalSection(&g_audio.lock);
+        s->events = events;
+        s->hEvent = hEvent;
+        LeaveCriticalSection(&g_audio.lock);
+        HRESULT hr = IMMDeviceEnumerator_RegisterEndpointNotificationCallback(g_audio.pEnum, &s->client);
+        s->registered = SUCCEEDED(hr);
+        if (FAILED(hr)) {
+            EnterCriticalSection(&g_audio.lock);
+            s->hEvent = NULL;
+            LeaveCriticalSection(&g_audio.lock);
+        }
+        return hr;
+    }
+    return E_OUTOFMEMORY;
+}
+
+static void actorUnsubscribe(HANDLE hEvent) {
+    for (int i = 0; i < MAX_AUDIO_SUBSCRIPTIONS; i++) {
+        AudioSubscription* s = &g_audio.subs[i];
+        if (s->hEvent != hEvent) continue;
+        /* Cleared first, under the lock: Unregister waits for callbacks in
+         * flight, which take the lock themselves */
+        EnterCriticalSection(&g_audio.lock);
+        s->hEvent = NULL;
+        LeaveCriticalSection(&g_audio.lock);
+        if (s->registered) IMMDeviceEnumerator_UnregisterEndpointNotificationCallback(g_audio.pEnum, &s->client);
+        s->registered = 0;
+    }
+}
+
+static void actorExecute(AudioCommand* cmd) {
+    LONGLONG span = traceBegin();
+    actorRevalidate();
+    
+    HRESULT hr = g_audio.pEnum ? S_OK : E_FAIL;
+    IMMDevice* pDev = NULL;
+    switch (cmd->kind) {
+    case AUDIO_CMD_ENUMERATE:
+        if (!g_audio.pEnum || !endpointSnapshotBuild(cmd->snapshot, g_audio.pEnum, cmd->stateMask)) {
+            memset(cmd->snapshot, 0, sizeof(*cmd->snapshot));
+            InterlockedExchange(&g_audio.stale, 1);  /* Probe before the next command */
+            hr = E_FAIL;
+        }
+        break;
+    case AUDIO_CMD_GET_STATE:
+        cmd->state = 0;
+        if (SUCCEEDED(hr)) hr = IMMDeviceEnumerator_GetDevice(g_audio.pEnum, cmd->id, &pDev);
+        if (SUCCEEDED(hr)) {
+            hr = IMMDevice_GetState(pDev, &cmd->state);
+            IMMDevice_Release(pDev);
+        }
+        break;
+    case AUDIO_CMD_GET_DEFAULTS:
+        for (int i = 0; i < 4; i++) {
+            WCHAR* idOut = cmd->defaultIds ? cmd->defaultIds[i] : NULL;
+            cmd->defaults[i][0] = L'\0';
+            if (idOut) idOut[0] = L'\0';
+            if (SUCCEEDED(hr)) actorDefaultName(i < 2 ? eRender : eCapture, i % 2 ? eCommunications : eConsole, cmd->defaults[i], 256, idOut);
+        }
+        break;
+    case AUDIO_CMD_SET_DEFAULT:
+        hr = g_audio.pPolicy ? g_audio.pPolicy->lpVtbl->SetDefaultEndpoint(g_audio.pPolicy, cmd->id, cmd->role) : E_FAIL;
+        break;
+    case AUDIO_CMD_GET_VOLUME:
+    case AUDIO_CMD_GET_MUTE:
+    case AUDIO_CMD_SET_VOLUME:
+    case AUDIO_CMD_MUTE:
+        if (SUCCEEDED(hr)) hr = actorVolumeCommand(cmd);
+        break;
+    case AUDIO_CMD_SUBSCRIBE:
+        if (SUCCEEDED(hr)) hr = actorSubscribe(cmd->hEvent, cmd->events);
+        break;
+    case AUDIO_CMD_UNSUBSCRIBE:
+        actorUnsubscribe(cmd->hEvent);
+        hr = S_OK;
+        break;
+    case AUDIO_CMD_WATCH_VOLUME:
+        if (SUCCEEDED(hr)) hr = actorWatchVolume(cmd);
+        break;
+    case AUDIO_CMD_UNWATCH_VOLUME: {
+        VolumeWatch* w = actorFindWatch(cmd->callback, NULL);
+        if (w) {
+            actorDetachWatch(w);
+            w->callback = NULL;
+        }
+        hr = S_OK;
+        break;
+    }
+    default:
+        hr = E_INVALIDARG;
+        break;
+    }
+    cmd->hr = hr;
+    traceEnd("com", g_audioCommandNames[cmd->kind], FAILED(hr) ? "failed" : NULL, span);
+}
+
+static DWORD WINAPI audioActorThread(LPVOID param) {
+    HRESULT hr = CoInitializeEx(NULL, COINIT_MULTITHREADED);
+    int comReady = SUCCEEDED(hr);
+    (void)param;
+    if (comReady) actorConnect();  /* Pre-create while nobody is waiting yet */
+    
+    for (;;) {
+        EnterCriticalSection(&g_audio.lock);
+        while (!g_audio.head && g_audio.running) {
+            SleepConditionVariableCS(&g_audio.queued, &g_audio.lock, INFINITE);
+        }
+        AudioCommand* cmd = g_audio.head;
+        if (cmd) {
+            g_audio.head = cmd->next;
+            if (!g_audio.head) g_audio.tail = NULL;
+        }
+        LeaveCriticalSection(&g_audio.lock);
+        if (!cmd) break;
+    
+        if (comReady) actorExecute(cmd);
+        else cmd->hr = hr;
+        SetEvent(cmd->hDone);
+    }
+    
+    if (comReady) {
+        actorDisconnect();
+        CoUninitialize();
+    }
+    return 0;
+}
+
+/* Start the actor. The COM objects are created on its thread in the
+ * background, so this returns immediately. */
+static int audioActorStart(void) {
+    if (g_audio.hThread) return 1;
+    InitializeCriticalSection(&g_audio.lock);
+    InitializeConditionVariable(&g_audio.queued);
+    g_audio.running = 1;
+    g_audio.hThread = CreateThread(NULL, 0, audioActorThread, NULL, 0, NULL);
+    if (!g_audio.hThread) {
+        g_audio.running = 0;
+        logAt(LOG_ERROR, "[!] Could not start the audio thread.\n");
+        return 0;
+    }
+    return 1;
+}
+
+/* Drain the queue, release everything and stop the thread */
+static void audioActorStop(void) {
+    if (!g_audio.hThread) return;
+    EnterCriticalSection(&g_audio.lock);
+    g_audio.running = 0;
+    LeaveCriticalSection(&g_audio.lock);
+    WakeConditionVariable(&g_audio.queued);
+    WaitForSingleObject(g_audio.hThread, 5000);
+    CloseHandle(g_audio.hThread);
+    g_audio.hThread = NULL;
+}
+
+/* Called after the audio services restart; the next command probes the objects */
+static void audioActorMarkStale(void) {
+    InterlockedExchange(&g_audio.stale, 1);
+}
+
+/* Queue a command and wait for it. Callers can be window procedures, so the
+ * wait serves only messages sent from other threads: dispatching posted or
+ * input messages here would re-enter the caller's window procedure and could
+ * eat the WM_QUIT its message loop is waiting for. Returns cmd->hr. */
+static HRESULT audioActorCall(AudioCommand* cmd) {
+    cmd->hr = E_FAIL;
+    cmd->next = NULL;
+    if (!g_audio.hThread) return cmd->hr;
+    cmd->hDone = CreateEventA(NULL, FALSE, FALSE, NULL);
+    if (!cmd->hDone) return cmd->hr;
+    
+    EnterCriticalSection(&g_audio.lock);
+    int accepted = g_audio.running;
+    if (accepted) {
+        if (g_audio.tail) g_audio.tail->next = cmd;
+        else g_audio.head = cmd;
+        g_audio.tail = cmd;
+    }
+    LeaveCriticalSection(&g_audio.lock);
+    
+    if (accepted) {
+        WakeConditionVariable(&g_audio.queued);
+        waitWithMessages(cmd->hDone, 0);
+    }
+    CloseHandle(cmd->hDone);
+    return cmd->hr;
+}
+
+static int audioEnumerate(EndpointSnapshot* snap, DWORD stateMask) {
+    AudioCommand cmd = {0};
+    cmd.kind = AUDIO_CMD_ENUMERATE;
+    cmd.snapshot = snap;
+    cmd.stateMask = stateMask;
+    memset(snap, 0, sizeof(*snap));
+    return SUCCEEDED(audioActorCall(&cmd));
+}
+
+/* DEVICE_STATE_* of an endpoint, 0 if it can't be found */
+static DWORD audioGetState(const WCHAR* id) {
+    AudioCommand cmd = {0};
+    cmd.kind = AUDIO_CMD_GET_STATE;
+    cmd.id = id;
+    return SUCCEEDED(audioActorCall(&cmd)) ? cmd.state : 0;
+}
+
+/* ids (optional) gets each default's endpoint ID */
+static int audioGetDefaults(WCHAR defaults[4][256], WCHAR ids[4][MAX_ENDPOINT_ID]) {
+    AudioCommand cmd = {0};
+    cmd.kind = AUDIO_CMD_GET_DEFAULTS;
+    cmd.defaults = defaults;
+    cmd.defaultIds = ids;
+    return SUCCEEDED(audioActorCall(&cmd));
+}
+
+static int audioSetDefault(const WCHAR* id, ERole role) {
+    AudioCommand cmd = {0};
+    cmd.kind = AUDIO_CMD_SET_DEFAULT;
+    cmd.id = id;
+    cmd.role = role;
+    return SUCCEEDED(audioActorCall(&cmd));
+}
+
+/* renewed (optional) is set if a watched endpoint had to be re-activated */
+static int audioGetVolume(const WCHAR* id, float* level, int* renewed) {
+    AudioCommand cmd = {0};
+    cmd.kind = AUDIO_CMD_GET_VOLUME;
+    cmd.id = id;
+    HRESULT hr = audioActorCall(&cmd);
+    *level = cmd.level;
+    if (renewed) *renewed = cmd.renewed;
+    return SUCCEEDED(hr);
+}
+
+static int audioGetMute(const WCHAR* id, BOOL* mute) {
+    AudioCommand cmd = {0};
+    cmd.kind = AUDIO_CMD_GET_MUTE;
+    cmd.id = id;
+    HRESULT hr = audioActorCall(&cmd);
+    *mute = cmd.mute;
+    return SUCCEEDED(hr);
+}
+
+static int audioSetVolume(const WCHAR* id, float level, const GUID* context) {
+    AudioCommand cmd = {0};
+    cmd.kind = AUDIO_CMD_SET_VOLUME;
+    cmd.id = id;
+    cmd.level = level;
+    cmd.context = context;
+    return SUCCEEDED(audioActorCall(&cmd));
+}
+
+static int audioSetMute(const WCHAR* id, BOOL mute, const GUID* context) {
+    AudioCommand cmd = {0};
+    cmd.kind = AUDIO_CMD_MUTE;
+    cmd.id = id;
+    cmd.mute = mute;
+    cmd.context = context;
+    return SUCCEEDED(audioActorCall(&cmd));
+}
+
+/* Signal hEvent on every AUDIO_EVENT_* in events until unsubscribed */
+static int audioSubscribe(HANDLE hEvent, DWORD events) {
+    AudioCommand cmd = {0};
+    cmd.kind = AUDIO_CMD_SUBSCRIBE;
+    cmd.hEvent = hEvent;
+    cmd.events = events;
+    return SUCCEEDED(audioActorCall(&cmd));
+}
+
+static void audioUnsubscribe(HANDLE hEvent) {
+    AudioCommand cmd = {0};
+    cmd.kind = AUDIO_CMD_UNSUBSCRIBE;
+    cmd.hEvent = hEvent;
+    audioActorCall(&cmd);
+}
+
+/* Attach callback to the endpoint's volume (moving it from any earlier
+ * endpoint) and read the level after subscribing */
+static int audioWatchVolume(const WCHAR* id, IAudioEndpointVolumeCallback* callback, float* level) {
+    AudioCommand cmd = {0};
+    cmd.kind = AUDIO_CMD_WATCH_VOLUME;
+    cmd.id = id;
+    cmd.callback = callback;
+    HRESULT hr = audioActorCall(&cmd);
+    *level = cmd.level;
+    return SUCCEEDED(hr);
+}
+
+static void audioUnwatchVolume(IAudioEndpointVolumeCallback* callback) {
+    AudioCommand cmd = {0};
+    cmd.kind = AUDIO_CMD_UNWATCH_VOLUME;
+    cmd.callback = callback;
+    audioActorCall(&cmd);
+}
+
+/* ========== GUI Device Watch ========== */
+/* The settings window is shown before any audio work is done. This thread
+ * fills it through posted messages - the device lists first, then Windows'
+ * current defaults - and posts fresh lists whenever endpoints come and go
+ * while the window is open, so ConfigDlgProc never waits on the audio actor. */
+#define GUI_REFRESH_SETTLE_MS 150   /* Coalesce a burst of endpoint events into one refresh */
+
+typedef struct GuiDeviceWatch {
+    HANDLE hThread;
+    HANDLE hStop;
+} GuiDeviceWatch;
+
+static GuiDeviceWatch g_guiWatch = {0};
+
+/* Pack a snapshot into one registry block: header, device table, then the
+ * strings. Endpoints keep their enumeration order. */
+static DeviceRegistry* deviceRegistryBuild(const EndpointSnapshot* snap) {
+    size_t chars = 0;
+    for (int i = 0; i < snap->count; i++) {
+        chars += wcslen(snap->entries[i].id) + 1 + wcslen(snap->entries[i].name) + 1;
+    }
+    size_t tableBytes = sizeof(DeviceRegistry) + snap->count * sizeof(DeviceInfo);
+    DeviceRegistry* reg = (DeviceRegistry*)malloc(tableBytes + chars * sizeof(WCHAR));
+    if (!reg) return NULL;
+    
+    reg->devices = (DeviceInfo*)(reg + 1);
+    reg->count = snap->count;
+    WCHAR* arena = (WCHAR*)((char*)reg + tableBytes);
+    for (int i = 0; i < snap->count; i++) {
+        const EndpointEntry* e = &snap->entries[i];
+        DeviceInfo* d = &reg->devices[i];
+        size_t len = wcslen(e->id) + 1;
+        memcpy(arena, e->id, len * sizeof(WCHAR));
+        d->id = arena;
+        arena += len;
+        len = wcslen(e->name) + 1;
+        memcpy(arena, e->name, len * sizeof(WCHAR));
+        d->name = arena;
+        arena += len;
+        d->dataFlow = e->dataFlow;
+        d->state = e->state;
+        d->formFactor = e->formFactor;
+    }
+    return reg;
+}
+
+static void guiPostDeviceList(HWND hwnd) {
+    EndpointSnapshot snap;
+    if (!audioEnumerate(&snap, DEVICE_STATE_ACTIVE)) return;
+    DeviceRegistry* reg = deviceRegistryBuild(&snap);
+    endpointSnapshotFree(&snap);
+    if (reg && !PostMessageW(hwnd, WM_GUI_DEVICES, 0, (LPARAM)reg)) free(reg);
+}
+
+static void guiPostDefaults(HWND hwnd) {
+    GuiDefaults* defaults = (GuiDefaults*)calloc(1, sizeof(*defaults));
+    if (!defaults) return;
+    if (!audioGetDefaults(defaults->names, defaults->ids) || !PostMessageW(hwnd, WM_GUI_DEFAULTS, 0, (LPARAM)defaults)) {
+        free(defaults);
+    }
+}
+
+static DWORD WINAPI guiDeviceWatchThread(LPVOID param) {
+    HWND hwnd = (HWND)param;
+    HANDLE hChanged = CreateEventA(NULL, FALSE, FALSE, NULL);
+    int subscribed = hChanged && audioSubscribe(hChanged, AUDIO_EVENT_ENDPOINTS);
+    
+    guiPostDeviceList(hwnd);
+    guiPostDefaults(hwnd);
+    
+    /* Without a subscription the lists stay as first posted */
+    HANDLE waits[2];
+    waits[0] = g_guiWatch.hStop;
+    waits[1] = hChanged;
+    while (WaitForMultipleObjects(subscribed ? 2 : 1, waits, FALSE, INFINITE) == WAIT_OBJECT_0 + 1) {
+        if (WaitForSingleObject(g_guiWatch.hStop, GUI_REFRESH_SETTLE_MS) == WAIT_OBJECT_0) break;
+        guiPostDeviceList(hwnd);
+    }
+    
+    if (subscribed) audioUnsubscribe(hChanged);
+    if (hChanged) CloseHandle(hChanged);
+    return 0;
+}
+
+static void guiDeviceWatchStart(HWND hwnd) {
+    g_guiWatch.hStop = CreateEventA(NULL, TRUE, FALSE, NULL);
+    if (!g_guiWatch.hStop) return;
+    g_guiWatch.hThread = CreateThread(NULL, 0, guiDeviceWatchThread, hwnd, 0, NULL);
+    if (!g_guiWatch.hThread) {
+        CloseHandle(g_guiWatch.hStop);
+        g_guiWatch.hStop = NULL;
+    }
+}
+
+/* After the window is gone: stop the thread and free anything it posted
+ * that the window never received */
+static void guiDeviceWatchStop(void) {
+    if (!g_guiWatch.hThread) return;
+    SetEvent(g_guiWatch.hStop);
+    WaitForSingleObject(g_guiWatch.hThread, 5000);
+    CloseHandle(g_guiWatch.hThread);
+    CloseHandle(g_guiWatch.hStop);
+    g_guiWatch.hThread = NULL;
+    g_guiWatch.hStop = NULL;
+    
+    MSG msg;
+    while (PeekMessageW(&msg, NULL, WM_GUI_DEVICES, WM_GUI_DEFAULTS, PM_REMOVE)) {
+        free((void*)msg.lParam);
+    }
+}
+
+/* ========== Show Config GUI ========== */
+static void showConfigGUI(void) {
+    /* Register window class */
+    WNDCLASSW wc = {0};
+    wc.lpfnWndProc = ConfigDlgProc;
+    wc.hInstance = GetModuleHandle(NULL);
+    wc.hCursor = LoadCursor(NULL, IDC_ARROW);
+    wc.lpszClassName = L"ElgatoResetConfig";
+    RegisterClassW(&wc);
+    
+    /* Calculate center position */
+    int screenW = GetSystemMetrics(SM_CXSCREEN);
+    int screenH = GetSystemMetrics(SM_CYSCREEN);
+    int winW = 520, winH = 600;
+    int x = (screenW - winW) / 2;
+    int y = (screenH - winH) / 2;
+    
+    /* Create window */
+    WCHAR windowTitle[64];
+    swprintf(windowTitle, 64, L"Elgato Audio Reset v%s", APP_VERSION);
+    HWND hwnd = CreateWindowExW(0, L"ElgatoResetConfig", windowTitle,
+        WS_OVERLAPPED | WS_CAPTION | WS_SYSMENU,
+        x, y, winW, winH, NULL, NULL, GetModuleHandle(NULL), NULL);
+    
+    ShowWindow(hwnd, SW_SHOW);
+    UpdateWindow(hwnd);
+    
+    /* Devices and the mismatch check arrive once the window is up */
+    guiDeviceWatchStart(hwnd);
+    
+    /* Message loop */
+    MSG msg;
+    while (GetMessage(&msg, NULL, 0, 0)) {
+        TranslateMessage(&msg);
+        DispatchMessage(&msg);
+    }
+    guiDeviceWatchStop();
+}
+
+/* ========== Protected Processes ========== */
+static const char* g_protected[] = {
+    "svchost.exe", "audiodg.exe", "System", "Idle", "dwm.exe", "explorer.exe",
+    "csrss.exe", "wininit.exe", "services.exe", "lsass.exe", "smss.exe",
+    "winlogon.exe", "fontdrvhost.exe", "sihost.exe", "taskhostw.exe",
+    "RuntimeBroker.exe", "ShellExperienceHost.exe", "SearchHost.exe",
+    "ctfmon.exe", "conhost.exe", "dllhost.exe", "powershell.exe", "cmd.exe",
+    "Code.exe", "devenv.exe", "elgato_reset.exe",
+    NULL
+};
+
+static int isProtected(const char* name) {
+    for (int i = 0; g_protected[i]; i++) {
+        if (_stricmp(name, g_protected[i]) == 0) return 1;
+    }
+    return 0;
+}
+
+static int isElgatoProcess(const char* name) {
+    return (strstr(name, "WaveLink") || strstr(name, "StreamDeck") || strstr(name, "Elgato"));
+}
+
+/* ========== Registry Path Discovery ========== */
+/* Install paths come from the cheapest source that still holds: the paths
+ * this process already has or config.txt cached, kept as long as the exe's
+ * size and write time are unchanged; then a single pass over the Uninstall
+ * keys for whatever is left; then the default install folders. Fresh
+ * results are written back to config.txt. */
+typedef struct InstallTarget {
+    const char* displayName;    /* Matched as a substring of DisplayName */
+    char installDir[MAX_PATH];  /* InstallLocation, "" if not found */
+} InstallTarget;
+
+/* One pass over both Uninstall hives for every target: each subkey is opened
+ * once and checked against all targets still missing, and the pass stops as
+ * soon as all are found. Returns how many were found. */
+static int findInstallPaths(InstallTarget* targets, int count) {
+    const char* regPaths[] = {
+        "SOFTWARE\\Microsoft\\Windows\\CurrentVersion\\Uninstall",
+        "SOFTWARE\\WOW6432Node\\Microsoft\\Windows\\CurrentVersion\\Uninstall",
+        NULL
+    };
+    int found = 0;
+    for (int i = 0; i < count; i++) targets[i].installDir[0] = '\0';
+    
+    for (int r = 0; regPaths[r] && found < count; r++) {
+        HKEY hKey;
+        if (RegOpenKeyExA(HKEY_LOCAL_MACHINE, regPaths[r], 0, KEY_READ, &hKey) != ERROR_SUCCESS) continue;
+        
+        char subKeyName[256];
+        DWORD subKeyLen;
+        for (DWORD i = 0; found < count; i++) {
+            subKeyLen = sizeof(subKeyName);
+            if (RegEnumKeyExA(hKey, i, subKeyName, &subKeyLen, NULL, NULL, NULL, NULL) != ERROR_SUCCESS)
+                break;
+            
+            HKEY hSubKey;
+            if (RegOpenKeyExA(hKey, subKeyName, 0, KEY_READ, &hSubKey) != ERROR_SUCCESS) continue;
+            
+            char displayName[256] = {0};
+            DWORD displayLen = sizeof(displayName) - 1;
+            RegQueryValueExA(hSubKey, "DisplayName", NULL, NULL, (LPBYTE)displayName, &displayLen);
+            
+            for (int t = 0; t < count; t++) {
+                if (targets[t].installDir[0] || !strstr(displayName, targets[t].displayName)) continue;
+                char installLoc[MAX_PATH] = {0};
+                DWORD installLen = sizeof(installLoc) - 1;
+                if (RegQueryValueExA(hSubKey, "InstallLocation", NULL, NULL, (LPBYTE)installLoc, &installLen) == ERROR_SUCCESS
+                    && installLoc[0] != '\0') {  /* Make sure it's not empty! */
+                    strcpy(targets[t].installDir, installLoc);
+                    found++;
+                }
+            }
+            RegCloseKey(hSubKey);
+        }
+        RegCloseKey(hKey);
+    }
+    return found;
+}
+
+/* 0 if the file doesn't exist */
+static int readExeStamp(const char* path, ExeStamp* stamp) {
+    WIN32_FILE_ATTRIBUTE_DATA data;
+    memset(stamp, 0, sizeof(*stamp));
+    if (!path[0] || !GetFileAttributesExA(path, GetFileExInfoStandard, &data)) return 0;
+    stamp->size = ((ULONGLONG)data.nFileSizeHigh << 32) | data.nFileSizeLow;
+    stamp->writeTime = ((ULONGLONG)data.ftLastWriteTime.dwHighDateTime << 32) | data.ftLastWriteTime.dwLowDateTime;
+    return 1;
+}
+
+/* The cached path still points at the exe it was cached for */
+static int cachedPathValid(const char* path, const ExeStamp* cached) {
+    ExeStamp now;
+    return cached->size && readExeStamp(path, &now) &&
+           now.size == cached->size && now.writeTime == cached->writeTime;
+}
+
+/* WaveLinkSE.exe sits next to WaveLink.exe */
+static void setWaveLinkSEPath(void) {
+    g_waveLinkSEPath[0] = '\0';
+    const char* slash = strrchr(g_waveLinkPath, '\\');
+    if (slash) {
+        snprintf(g_waveLinkSEPath, MAX_PATH, "%.*s\\WaveLinkSE.exe", (int)(slash - g_waveLinkPath), g_waveLinkPath);
+    }
+}
+
+/* Resolve one app from the registry pass (installDir) or its default folder,
+ * and re-stamp it. Returns 1 if the path or stamp changed. */
+static int resolveInstallPath(char* path, ExeStamp* stamp, const char* installDir, const char* exeName,
+                              const char* defaultPath) {
+    char old[MAX_PATH];
+    ExeStamp oldStamp = *stamp;
+    strcpy(old, path);
+    
+    path[0] = '\0';
+    if (installDir[0]) {
+        snprintf(path, MAX_PATH, "%s\\%s", installDir, exeName);
+    } else if (GetFileAttributesA(defaultPath) != INVALID_FILE_ATTRIBUTES) {
+        strcpy(path, defaultPath);
+    }
+    readExeStamp(path, stamp);
+    return strcmp(old, path) != 0 || memcmp(&oldStamp, stamp, sizeof(oldStamp)) != 0;
+}
+
+static void discoverPaths(void) {
+    int waveLinkCached = cachedPathValid(g_waveLinkPath, &g_waveLinkStamp);
+    int streamDeckCached = cachedPathValid(g_streamDeckPath, &g_streamDeckStamp);
+    if (waveLinkCached && streamDeckCached) {
+        setWaveLinkSEPath();
+        logMsg("[i] Using cached paths (WaveLink, StreamDeck unchanged).\n");
+        return;
+    }
+    
+    /* One registry pass for whichever apps aren't cached */
+    InstallTarget targets[2];
+    InstallTarget* waveLink = NULL;
+    InstallTarget* streamDeck = NULL;
+    int count = 0;
+    if (!waveLinkCached) {
+        waveLink = &targets[count++];
+        waveLink->displayName = "Wave Link";
+    }
+    if (!streamDeckCached) {
+        streamDeck = &targets[count++];
+        streamDeck->displayName = "Stream Deck";
+    }
+    LONGLONG span = traceBegin();
+    findInstallPaths(targets, count);
+    traceEnd("registry", "findInstallPaths", NULL, span);
+    
+    int changed = 0;
+    if (waveLink) {
+        changed |= resolveInstallPath(g_waveLinkPath, &g_waveLinkStamp, waveLink->installDir, "WaveLink.exe",
+                                      "C:\\Program Files\\Elgato\\WaveLink\\WaveLink.exe");
+    }
+    if (streamDeck) {
+        changed |= resolveInstallPath(g_streamDeckPath, &g_streamDeckStamp, streamDeck->installDir, "StreamDeck.exe",
+                                      "C:\\Program Files\\Elgato\\StreamDeck\\StreamDeck.exe");
+    }
+    setWaveLinkSEPath();
+    
+    logMsg("[i] Discovered paths:\n");
+    logMsg("    WaveLink: %s%s\n", g_waveLinkPath[0] ? g_waveLinkPath : "NOT FOUND", waveLinkCached ? " (cached)" : "");
+    logMsg("    WaveLinkSE: %s\n", g_waveLinkSEPath[0] ? g_waveLinkSEPath : "NOT FOUND");
+    logMsg("    StreamDeck: %s%s\n", g_streamDeckPath[0] ? g_streamDeckPath : "NOT FOUND",
+           streamDeckCached ? " (cached)" : "");
+    
+    /* Launch steps depend on this one, so nothing else writes the config meanwhile */
+    if (changed && g_configExists) {
+        writeConfigFile();
+        logMsg("    [i] Cached install paths in config.\n");
+    }
+}
+
+/* ========== Process Table ========== */
+/* One Toolhelp snapshot captured into a flat array, with exe names case-folded
+ * and hashed once (entries with the same name are chained), plus a PID ->
+ * top-level windows map built from a single EnumWindows pass and kept sorted
+ * by PID. Reset steps share g_procTable and refresh it on demand; the window
+ * map can be refreshed on its own while waiting for a window. Buffers are
+ * reused across refreshes. */
+typedef struct ProcessEntry {
+    DWORD pid;
+    unsigned int hash;      /* Of the folded name */
+    int name;               /* Offsets into names[] */
+    int folded;
+    int nextSameName;       /* Next entry with this folded name, -1 = none */
+} ProcessEntry;
+
+typedef struct ProcessWindow {
+    DWORD pid;
+    HWND hwnd;
+} ProcessWindow;
+
+typedef struct ProcessTable {
+    CRITICAL_SECTION lock;  /* Launch steps query it from several workers */
+    int ready;
+    ProcessEntry* entries;
+    int count, capacity;
+    char* names;
+    int namesUsed, namesCapacity;
+    int* slots;             /* Open-addressed: first entry per folded name, -1 = empty */
+    unsigned int slotMask;
+    ProcessWindow* windows;
+    int windowCount, windowCapacity;
+} ProcessTable;
+
+static ProcessTable g_procTable;
+
+static void foldExeName(char* dst, const char* src, size_t len) {
+    size_t i = 0;
+    for (; i + 1 < len && src[i]; i++) dst[i] = (char)tolower((unsigned char)src[i]);
+    dst[i] = '\0';
+}
+
+static unsigned int hashExeName(const char* folded) {
+    unsigned int h = 2166136261u;
+    for (; *folded; folded++) {
+        h ^= (unsigned char)*folded;
+        h *= 16777619u;
+    }
+    return h;
+}
+
+/* Called before reset workers start, so the lock needs no lazy-init guard */
+static void processTableInit(void) {
+    if (g_procTable.ready) return;
+    InitializeCriticalSection(&g_procTable.lock);
+    g_procTable.ready = 1;
+}
+
+static int appendProcessName(const char* name) {
+    int len = (int)strlen(name) + 1;
+    if (g_procTable.namesUsed + len > g_procTable.namesCapacity) {
+        int capacity = g_procTable.namesCapacity ? g_procTable.namesCapacity * 2 : 16384;
+        while (capacity < g_procTable.namesUsed + len) capacity *= 2;
+        char* names = (char*)realloc(g_procTable.names, capacity);
+        if (!names) return -1;
+        g_procTable.names = names;
+        g_procTable.namesCapacity = capacity;
+    }
+    int offset = g_procTable.namesUsed;
+    memcpy(g_procTable.names + offset, name, len);
+    g_procTable.namesUsed += len;
+    return offset;
+}
+
+static BOOL CALLBACK collectWindowCallback(HWND hwnd, LPARAM lParam) {
+    (void)lParam;
+    if (g_procTable.windowCount == g_procTable.windowCapacity) {
+        int capacity = g_procTable.windowCapacity ? g_procTable.windowCapacity * 2 : 512;
+        ProcessWindow* windows = (ProcessWindow*)realloc(g_procTable.windows, capacity * sizeof(ProcessWindow));
+        if (!windows) return FALSE;
+        g_procTable.windows = windows;
+        g_procTable.windowCapacity = capacity;
+    }
+    ProcessWindow* w = &g_procTable.windows[g_procTable.windowCount++];
+    w->pid = 0;
+    GetWindowThreadProcessId(hwnd, &w->pid);
+    w->hwnd = hwnd;
+    return TRUE;
+}
+
+static int compareProcessWindows(const void* a, const void* b) {
+    DWORD pa = ((const ProcessWindow*)a)->pid, pb = ((const ProcessWindow*)b)->pid;
+    return (pa > pb) - (pa < pb);
+}
+
+/* Re-read just the window map (one EnumWindows pass) */
+static void processTableRefreshWindows(void) {
+    EnterCriticalSection(&g_procTable.lock);
+    LONGLONG span = traceBegin();
+    g_procTable.windowCount = 0;
+    EnumWindows(collectWindowCallback, 0);
+    qsort(g_procTable.windows, g_procTable.windowCount, sizeof(ProcessWindow), compareProcessWindows);
+    traceEnd("process", "EnumWindows", NULL, span);
+    LeaveCriticalSection(&g_procTable.lock);
+}
+
+/* Re-capture the process list and the window map. Returns 0 if the snapshot failed. */
+static int processTableRefresh(void) {
+    LONGLONG span = traceBegin();
+    HANDLE hSnap = CreateToolhelp32Snapshot(TH32CS_SNAPPROCESS, 0);
+    traceEnd("process", "CreateToolhelp32Snapshot", NULL, span);
+    if (hSnap == INVALID_HANDLE_VALUE) return 0;
+    
+    EnterCriticalSection(&g_procTable.lock);
+    g_procTable.count = 0;
+    g_procTable.namesUsed = 0;
+    
+    PROCESSENTRY32 pe;
+    pe.dwSize = sizeof(pe);
+    if (Process32First(hSnap, &pe)) {
+        do {
+            if (g_procTable.count == g_procTable.capacity) {
+                int capacity = g_procTable.capacity ? g_procTable.capacity * 2 : 256;
+                ProcessEntry* entries = (ProcessEntry*)realloc(g_procTable.entries, capacity * sizeof(ProcessEntry));
+                if (!entries) break;
+                g_procTable.entries = entries;
+                g_procTable.capacity = capacity;
+            }
+            char folded[MAX_PATH];
+            foldExeName(folded, pe.szExeFile, MAX_PATH);
+            ProcessEntry* e = &g_procTable.entries[g_procTable.count];
+            e->pid = pe.th32ProcessID;
+            e->hash = hashExeName(folded);
+            e->name = appendProcessName(pe.szExeFile);
+            e->folded = appendProcessName(folded);
+            if (e->name < 0 || e->folded < 0) break;
+            g_procTable.count++;
+        } while (Process32Next(hSnap, &pe));
+    }
+    CloseHandle(hSnap);
+    
+    /* Size the index for the capacity so it only grows with the entry array */
+    unsigned int slotCount = 8;
+    while (slotCount < (unsigned int)g_procTable.capacity * 2) slotCount <<= 1;
+    if (slotCount - 1 != g_procTable.slotMask || !g_procTable.slots) {
+        free(g_procTable.slots);
+        g_procTable.slots = (int*)malloc(slotCount * sizeof(int));
+        g_procTable.slotMask = g_procTable.slots ? slotCount - 1 : 0;
+    }
+    if (g_procTable.slots) {
+        memset(g_procTable.slots, 0xFF, (g_procTable.slotMask + 1) * sizeof(int));
+        /* Insert in reverse so each chain runs in snapshot order */
+        for (int i = g_procTable.count - 1; i >= 0; i--) {
+            ProcessEntry* e = &g_procTable.entries[i];
+            const char* folded = g_procTable.names + e->folded;
+            e->nextSameName = -1;
+            unsigned int slot = e->hash & g_procTable.slotMask;
+            while (g_procTable.slots[slot] >= 0) {
+                ProcessEntry* head = &g_procTable.entries[g_procTable.slots[slot]];
+                if (head->hash == e->hash && strcmp(g_procTable.names + head->folded, folded) == 0) {
+                    e->nextSameName = g_procTable.slots[slot];
+                    break;
+                }
+                slot = (slot + 1) & g_procTable.slotMask;
+            }
+            g_procTable.slots[slot] = i;
+        }
+    }
+    LeaveCriticalSection(&g_procTable.lock);
+    
+    processTableRefreshWindows();
+    return 1;
+}
+
+/* Caller holds the lock. Returns the first entry for exeName, or -1. */
+static int processTableLookup(const char* exeName) {
+    if (!g_procTable.slots) return -1;
+    char folded[MAX_PATH];
+    foldExeName(folded, exeName, MAX_PATH);
+    unsigned int hash = hashExeName(folded);
+    
+    for (unsigned int slot = hash & g_procTable.slotMask; g_procTable.slots[slot] >= 0;
+         slot = (slot + 1) & g_procTable.slotMask) {
+        const ProcessEntry* e = &g_procTable.entries[g_procTable.slots[slot]];
+        if (e->hash == hash && strcmp(g_procTable.names + e->folded, folded) == 0) return g_procTable.slots[slot];
+    }
+    return -1;
+}
+
+/* PIDs of every process named exeName; returns how many (at most max) */
+static int processTableFind(const char* exeName, DWORD* pids, int max) {
+    int n = 0;
+    EnterCriticalSection(&g_procTable.lock);
+    for (int i = processTableLookup(exeName); i >= 0 && n < max; i = g_procTable.entries[i].nextSameName) {
+        pids[n++] = g_procTable.entries[i].pid;
+    }
+    LeaveCriticalSection(&g_procTable.lock);
+    return n;
+}
+
+/* Processes whose exe name passes match(); names are copied out */
+typedef struct ProcessMatch {
+    DWORD pid;
+    char exeName[MAX_PATH];
+} ProcessMatch;
+
+static int processTableMatch(int (*match)(const char* exeName), ProcessMatch* out, int max) {
+    int n = 0;
+    EnterCriticalSection(&g_procTable.lock);
+    for (int i = 0; i < g_procTable.count && n < max; i++) {
+        const char* name = g_procTable.names + g_procTable.entries[i].name;
+        if (!match(name)) continue;
+        out[n].pid = g_procTable.entries[i].pid;
+        strncpy(out[n].exeName, name, MAX_PATH - 1);
+        out[n].exeName[MAX_PATH - 1] = '\0';
+        n++;
+    }
+    LeaveCriticalSection(&g_procTable.lock);
+    return n;
+}
+
+/* Top-level windows of pid from the last window pass; returns how many (at most max) */
+static int processTableWindows(DWORD pid, HWND* hwnds, int max) {
+    int n = 0;
+    EnterCriticalSection(&g_procTable.lock);
+    int lo = 0, hi = g_procTable.windowCount;
+    while (lo < hi) {
+        int mid = (lo + hi) / 2;
+        if (g_procTable.windows[mid].pid < pid) lo = mid + 1;
+        else hi = mid;
+    }
+    for (int i = lo; i < g_procTable.windowCount && g_procTable.windows[i].pid == pid && n < max; i++) {
+        hwnds[n++] = g_procTable.windows[i].hwnd;
+    }
+    LeaveCriticalSection(&g_procTable.lock);
+    return n;
+}
+
+/* ========== Process Functions ========== */
+/* Processes are stopped by handle: each match is opened once, optionally asked
+ * to close via WM_CLOSE (CLOSE_GRACE_MS) if it has a window to ask, terminated
+ * if it has none or is still alive after the grace, and then waited on
+ * together, so the step ends as soon as the last one has exited. */
+#define MAX_STOP_PROCESSES MAXIMUM_WAIT_OBJECTS
+
+typedef struct StopTarget {
+    DWORD pid;
+    char exeName[MAX_PATH];
+    HANDLE hProc;
+    DWORD requestedAt;      /* Tick when close/terminate was issued */
+    DWORD exitMs;           /* Request -> handle signalled */
+    int exited;
+    int terminated;         /* 0 = closed on WM_CLOSE */
+} StopTarget;
+
+typedef struct StopSet {
+    StopTarget targets[MAX_STOP_PROCESSES];
+    int count;
+} StopSet;
+
+static int isKillableElgato(const char* exeName) {
+    return !isProtected(exeName) && isElgatoProcess(exeName);
+}
+
+static int isWaveLinkExe(const char* exeName) {
+    return _stricmp(exeName, "WaveLink.exe") == 0 || _stricmp(exeName, "WaveLinkSE.exe") == 0;
+}
+
+/* Post WM_CLOSE to the target's visible top-level windows; returns how many */
+static int closeTargetWindows(const StopTarget* t) {
+    HWND hwnds[64];
+    int closed = 0;
+    int n = processTableWindows(t->pid, hwnds, 64);
+    for (int i = 0; i < n; i++) {
+        if (!IsWindowVisible(hwnds[i]) || GetWindow(hwnds[i], GW_OWNER)) continue;
+        PostMessageW(hwnds[i], WM_CLOSE, 0, 0);
+        closed++;
+    }
+    return closed;
+}
+
+/* Terminate the target unless it is already gone */
+static void terminateTarget(StopTarget* t) {
+    LONGLONG span = traceBegin();
+    if (TerminateProcess(t->hProc, 1)) {
+        t->terminated = 1;
+        t->requestedAt = GetTickCount();
+    } else if (WaitForSingleObject(t->hProc, 0) == WAIT_OBJECT_0) {
+        t->exited = 1;  /* Exited before it could be terminated */
+    }
+    traceEnd("process", "TerminateProcess", t->exeName, span);
+}
+
+/* Wait until every target has exited or the deadline passes, recording each
+ * exit as it happens. Returns 1 if all exited. */
+static int waitTargetsExit(StopSet* set, DWORD deadline) {
+    HANDLE handles[MAX_STOP_PROCESSES];
+    int index[MAX_STOP_PROCESSES];
+    
+    for (;;) {
+        int n = 0;
+        for (int i = 0; i < set->count; i++) {
+            if (set->targets[i].exited || !set->targets[i].requestedAt) continue;
+            handles[n] = set->targets[i].hProc;
+            index[n++] = i;
+        }
+        if (n == 0) return 1;
+        
+        DWORD now = GetTickCount();
+        if ((LONG)(deadline - now) <= 0) return 0;
+        DWORD r = WaitForMultipleObjects((DWORD)n, handles, FALSE, deadline - now);
+        if (r >= WAIT_OBJECT_0 && r < WAIT_OBJECT_0 + (DWORD)n) {
+            StopTarget* t = &set->targets[index[r - WAIT_OBJECT_0]];
+            t->exited = 1;
+            t->exitMs = GetTickCount() - t->requestedAt;
+        } else {
+            return 0;
+        }
+    }
+}
+
+/* Stop every process whose exe name matches. Returns how many were found. */
+static int stopProcesses(int (*match)(const char* exeName)) {
+    /* Per call, not static: steps on different reset workers may stop processes at the same time */
+    StopSet* set = (StopSet*)calloc(1, sizeof(StopSet));
+    ProcessMatch* matches = (ProcessMatch*)malloc(MAX_STOP_PROCESSES * sizeof(ProcessMatch));
+    int found = (set && matches && processTableRefresh()) ? processTableMatch(match, matches, MAX_STOP_PROCESSES) : 0;
+    for (int i = 0; i < found; i++) {
+        HANDLE hProc = OpenProcess(PROCESS_TERMINATE | SYNCHRONIZE, FALSE, matches[i].pid);
+        if (!hProc) continue;
+        StopTarget* t = &set->targets[set->count++];
+        t->pid = matches[i].pid;
+        strcpy(t->exeName, matches[i].exeName);
+        t->hProc = hProc;
+    }
+    free(matches);
+    if (!set || set->count == 0) {
+        free(set);
+        return 0;
+    }
+    
+    LONGLONG span;
+    
+    /* Ask politely first; whatever is still alive after the grace gets terminated */
+    if (g_closeGraceMs > 0) {
+        DWORD now = GetTickCount();
+        int asked = 0;
+        for (int i = 0; i < set->count; i++) {
+            if (closeTargetWindows(&set->targets[i]) > 0) {
+                set->targets[i].requestedAt = now;
+                asked++;
+            }
+        }
+        /* A process without a window was never asked, so it has nothing to wait out */
+        for (int i = 0; i < set->count; i++) {
+            if (!set->targets[i].requestedAt) terminateTarget(&set->targets[i]);
+        }
+        span = traceBegin();
+        if (asked > 0) {
+            waitTargetsExit(set, now + (DWORD)g_closeGraceMs);
+        }
+        traceEnd("wait", "process-close", NULL, span);
+    }
+    
+    for (int i = 0; i < set->count; i++) {
+        StopTarget* t = &set->targets[i];
+        if (!t->exited && !t->terminated) terminateTarget(t);
+    }
+    
+    span = traceBegin();
+    waitTargetsExit(set, GetTickCount() + (DWORD)MAX_PROCESS_EXIT_WAIT * 1000);
+    traceEnd("wait", "process-exit", NULL, span);
+    
+    for (int i = 0; i < set->count; i++) {
+        StopTarget* t = &set->targets[i];
+        if (t->exited && t->requestedAt) {
+            logMsg("    [+] %s: %s (PID %lu, exited in %lu ms)\n", t->terminated ? "Killed" : "Closed",
+                   t->exeName, t->pid, t->exitMs);
+        } else if (!t->exited) {
+            logAt(LOG_WARN, "    [!] %s (PID %lu) still running after %d sec\n", t->exeName, t->pid,
+                  MAX_PROCESS_EXIT_WAIT);
+        }
+        CloseHandle(t->hProc);
+    }
+    int stopped = set->count;
+    free(set);
+    return stopped;
+}
+
+static void killElgatoProcesses(void) {
+    logMsg("[i] Discovering and killing Elgato processes...\n");
+    if (stopProcesses(isKillableElgato) == 0) {
+        logMsg("    [i] No Elgato processes found to kill.\n");
+    }
+}
+
+/* ========== Wait Budgets ========== */
+/* Every reset appends how long each of its waits took to wait_history.bin
+ * next to the config (a ring of the last BUDGET_SAMPLES per phase), and
+ * later runs size their waits from it: the timeout is the observed p99 times
+ * BUDGET_MARGIN plus BUDGET_SLACK_MS, kept within a per-phase range, and a
+ * wait that has to poll backs off exponentially toward the observed p50 and
+ * checks finely around it. A phase with fewer than BUDGET_MIN_SAMPLES
+ * samples uses the timing settings above. Only waits that finished count;
+ * running out a learned timeout shorter than the default also counts (at
+ * the timeout), so a budget that was cut too fine grows back, while a device
+ * that is simply gone doesn't stretch every later wait. The sample count,
+ * margins and the p99 math itself are in reset_core.h. */
+#define BUDGET_FILE         "wait_history.bin"
+#define BUDGET_MAGIC        0x31425745u     /* "EWB1" */
+#define SETTLE_QUIET_MS     300             /* Endpoints count as settled after this long without a change */
+
+enum {
+    PHASE_SERVICE_STOP,     /* One service reaching STOPPED */
+    PHASE_SERVICE_START,    /* One service reaching RUNNING */
+    PHASE_DEVICES,          /* Configured devices active after the restart */
+    PHASE_SETTLE,           /* Endpoint churn dying down before defaults are set */
+    PHASE_COUNT
+};
+
+typedef struct WaitPhase {
+    const char* name;
+    const int* defaultSec;  /* Timing setting used without enough history */
+    DWORD minMs;            /* Learned timeouts stay at or above this */
+    int maxFactor;          /* ...and at or below this many times the default */
+} WaitPhase;
+
+static const WaitPhase g_waitPhases[PHASE_COUNT] = {
+    { "service-stop",  &MAX_SERVICE_WAIT, 2000,            2 },
+    { "service-start", &MAX_SERVICE_WAIT, 2000,            2 },
+    { "devices",       &MAX_DEVICE_WAIT,  5000,            2 },
+    { "settle",        &SETTLE_TIME,      SETTLE_QUIET_MS, 1 },
+};
+
+/* On-disk layout, written whole */
+typedef struct WaitHistory {
+    DWORD magic;
+    DWORD count[PHASE_COUNT];                   /* Samples held, up to BUDGET_SAMPLES */
+    DWORD next[PHASE_COUNT];                    /* Ring slot for the next sample */
+    DWORD samples[PHASE_COUNT][BUDGET_SAMPLES]; /* ms */
+} WaitHistory;
+
+static struct {
+    CRITICAL_SECTION lock;  /* Waits on different workers record at the same time */
+    int lockReady;
+    int dirty;
+    WaitHistory history;
+} g_budgets = {0};
+
+static void waitBudgetPath(char* out, size_t len) {
+    snprintf(out, len, "%s\\" BUDGET_FILE, g_exeDir);
+}
+
+/* Re-read the history at the start of a run (another instance may have
+ * added to it). A missing or foreign file starts an empty history. */
+static void waitBudgetLoad(void) {
+    if (!g_budgets.lockReady) {
+        InitializeCriticalSection(&g_budgets.lock);
+        g_budgets.lockReady = 1;
+    }
+    
+    char path[MAX_PATH];
+    waitBudgetPath(path, MAX_PATH);
+    EnterCriticalSection(&g_budgets.lock);
+    memset(&g_budgets.history, 0, sizeof(g_budgets.history));
+    FILE* f = fopen(path, "rb");
+    if (f) {
+        if (fread(&g_budgets.history, sizeof(g_budgets.history), 1, f) != 1 || g_budgets.history.magic != BUDGET_MAGIC) {
+            memset(&g_budgets.history, 0, sizeof(g_budgets.history));
+        }
+        fclose(f);
+    }
+    for (int p = 0; p < PHASE_COUNT; p++) {
+        if (g_budgets.history.count[p] > BUDGET_SAMPLES || g_budgets.history.next[p] >= BUDGET_SAMPLES) {
+            g_budgets.history.count[p] = 0;
+            g_budgets.history.next[p] = 0;
+        }
+    }
+    g_budgets.history.magic = BUDGET_MAGIC;
+    g_budgets.dirty = 0;
+    LeaveCriticalSection(&g_budgets.lock);
+}
+
+/* Write the history back if this run added to it. Written to a temporary
+ * file and moved over the old one, so a crash never leaves half a file. */
+static void waitBudgetSave(void) {
+    if (!g_budgets.lockReady) return;
+    char path[MAX_PATH], tmpPath[MAX_PATH];
+    waitBudgetPath(path, MAX_PATH);
+    snprintf(tmpPath, MAX_PATH, "%s.tmp", path);
+    
+    EnterCriticalSection(&g_budgets.lock);
+    if (g_budgets.dirty) {
+        FILE* f = fopen(tmpPath, "wb");
+        int written = f && fwrite(&g_budgets.history, sizeof(g_budgets.history), 1, f) == 1;
+        if (f && fclose(f) != 0) written = 0;
+        if (written && MoveFileExA(tmpPath, path, MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH)) {
+            g_budgets.dirty = 0;
+        } else {
+            DeleteFileA(tmpPath);
+        }
+    }
+    LeaveCriticalSection(&g_budgets.lock);
+}
+
+static WaitBudget waitBudget(int phase) {
+    const WaitPhase* ph = &g_waitPhases[phase];
+    DWORD defaultMs = (DWORD)*ph->defaultSec * 1000;
+    DWORD sorted[BUDGET_SAMPLES];
+    DWORD n = 0;
+    if (g_budgets.lockReady) {
+        EnterCriticalSection(&g_budgets.lock);
+        n = g_budgets.history.count[phase];
+        memcpy(sorted, g_budgets.history.samples[phase], n * sizeof(DWORD));
+        LeaveCriticalSection(&g_budgets.lock);
+    }
+    return waitBudgetFromSamples(sorted, n, defaultMs, ph->minMs, ph->maxFactor, (DWORD)POLL_INTERVAL * 1000);
+}
+
+/* Record how long a wait took; completed = it didn't run out the budget */
+static void waitBudgetRecord(int phase, const WaitBudget* b, DWORD tookMs, int completed) {
+    if (!g_budgets.lockReady) return;
+    if (!completed) {
+        DWORD defaultMs = (DWORD)*g_waitPhases[phase].defaultSec * 1000;
+        if (!b->learned || b->timeoutMs >= defaultMs) return;
+        tookMs = b->timeoutMs;
+    }
+    
+    EnterCriticalSection(&g_budgets.lock);
+    WaitHistory* h = &g_budgets.history;
+    h->samples[phase][h->next[phase]] = tookMs;
+    h->next[phase] = (h->next[phase] + 1) % BUDGET_SAMPLES;
+    if (h->count[phase] < BUDGET_SAMPLES) h->count[phase]++;
+    g_budgets.dirty = 1;
+    LeaveCriticalSection(&g_budgets.lock);
+}
+
+/* One line with each phase's timeout for this run, logged whole */
+static void waitBudgetLog(void) {
+    char line[LOG_LINE_MAX - 1];
+    size_t len = (size_t)snprintf(line, sizeof(line), "[i] Wait budgets:");
+    for (int p = 0; p < PHASE_COUNT && len < sizeof(line); p++) {
+        WaitBudget b = waitBudget(p);
+        len += (size_t)snprintf(line + len, sizeof(line) - len, " %s %.1fs%s",
+                                g_waitPhases[p].name, b.timeoutMs / 1000.0, b.learned ? "" : " (default)");
+    }
+    logMsg("%s\n", line);
+}
+
+/* ========== Service Control ========== */
+/* One SCM connection and one handle per service, opened on first use and kept
+ * for the life of the process (resident mode opens them at startup). Only the
+ * restart step touches services, so there is no locking. Service handles
+ * survive the service restarting; if a call still reports a dead handle the
+ * cache is dropped and the call retried once with fresh handles. */
+#define MAX_CACHED_SERVICES 16
+#define MAX_PLAN_SERVICES 16
+#define SERVICE_NAME_LEN 256
+
+typedef struct CachedService {
+    char name[SERVICE_NAME_LEN];
+    SC_HANDLE hSvc;
+} CachedService;
+
+static SC_HANDLE g_scm = NULL;
+static CachedService g_services[MAX_CACHED_SERVICES];
+static int g_serviceCount = 0;
+
+static void closeServiceHandles(void) {
+    for (int i = 0; i < g_serviceCount; i++) CloseServiceHandle(g_services[i].hSvc);
+    g_serviceCount = 0;
+    if (g_scm) CloseServiceHandle(g_scm);
+    g_scm = NULL;
+}
+
+static int openServiceManager(void) {
+    if (g_scm) return 1;
+    LONGLONG span = traceBegin();
+    g_scm = OpenSCManagerA(NULL, NULL, SC_MANAGER_CONNECT);
+    traceEnd("service", "OpenSCManager", NULL, span);
+    return g_scm != NULL;
+}
+
+static SC_HANDLE openCachedService(const char* svcName) {
+    for (int i = 0; i < g_serviceCount; i++) {
+        if (_stricmp(g_services[i].name, svcName) == 0) return g_services[i].hSvc;
+    }
+    
+    if (!openServiceManager()) return NULL;
+    
+    SC_HANDLE hSvc = OpenServiceA(g_scm, svcName, SERVICE_START | SERVICE_STOP | SERVICE_QUERY_STATUS |
+                                  SERVICE_QUERY_CONFIG | SERVICE_ENUMERATE_DEPENDENTS);
+    if (hSvc && g_serviceCount < MAX_CACHED_SERVICES) {
+        strncpy(g_services[g_serviceCount].name, svcName, SERVICE_NAME_LEN - 1);
+        g_services[g_serviceCount].name[SERVICE_NAME_LEN - 1] = '\0';
+        g_services[g_serviceCount].hSvc = hSvc;
+        g_serviceCount++;
+    } else if (hSvc) {
+        CloseServiceHandle(hSvc);  /* Cache full - shouldn't happen */
+        hSvc = NULL;
+    }
+    return hSvc;
+}
+
+static int controlService(const char* svcName, int start) {
+    SERVICE_STATUS status;
+    int result = 0;
+    DWORD err = 0;
+    
+    for (int attempt = 0; attempt < 2; attempt++) {
+        SC_HANDLE hSvc = openCachedService(svcName);
+        if (!hSvc) return 0;
+        
+        LONGLONG span = traceBegin();
+        if (start) {
+            result = StartServiceA(hSvc, 0, NULL);
+        } else {
+            result = ControlService(hSvc, SERVICE_CONTROL_STOP, &status);
+        }
+        err = result ? 0 : GetLastError();
+        traceEnd("service", start ? "StartService" : "ControlService(STOP)", svcName, span);
+        
+        if (err != ERROR_INVALID_HANDLE) break;
+        closeServiceHandles();
+    }
+    if (start) return result || err == ERROR_SERVICE_ALREADY_RUNNING;
+    /* Already stopped, or already stopping - either way the wait decides */
+    return result || err == ERROR_SERVICE_NOT_ACTIVE || err == ERROR_SERVICE_CANNOT_ACCEPT_CTRL;
+}
+
+static int isServiceRunning(const char* svcName) {
+    LONGLONG span = traceBegin();
+    SERVICE_STATUS status;
+    int running = 0;
+    
+    for (int attempt = 0; attempt < 2; attempt++) {
+        SC_HANDLE hSvc = openCachedService(svcName);
+        if (!hSvc) break;
+        if (QueryServiceStatus(hSvc, &status)) {
+            running = (status.dwCurrentState == SERVICE_RUNNING);
+            break;
+        }
+        if (GetLastError() != ERROR_INVALID_HANDLE) break;
+        closeServiceHandles();
+    }
+    
+    traceEnd("service", "QueryServiceStatus", svcName, span);
+    return running;
+}
+
+static void CALLBACK onServiceNotify(void* param) {
+    SERVICE_NOTIFYA* notify = (SERVICE_NOTIFYA*)param;
+    *(volatile LONG*)notify->pContext = 1;
+}
+
+/* Wait until the service reaches `state` (SERVICE_STOPPED or SERVICE_RUNNING),
+ * within that phase's wait budget. Sleeps alertably on a status-change
+ * notification; if the SCM refuses one, falls back to the budget's poll
+ * schedule (or a tenth of the service's own wait hint before there is any
+ * history). A service
+ * that drops back to STOPPED while we wait for RUNNING failed to start, so we
+ * return early with its exit code instead of running out the clock.
+ * The notification needs a handle of its own: closing it is the only way to
+ * cancel a pending registration, which the cached handles must never carry. */
+static int waitServiceState(const char* svcName, DWORD state, DWORD* exitCode) {
+    int phase = (state == SERVICE_RUNNING) ? PHASE_SERVICE_START : PHASE_SERVICE_STOP;
+    WaitBudget budget = waitBudget(phase);
+    DWORD timeoutMs = budget.timeoutMs;
+    int timedOut = 0;
+    if (exitCode) *exitCode = 0;
+    if (!openServiceManager()) return 0;
+    SC_HANDLE hSvc = OpenServiceA(g_scm, svcName, SERVICE_QUERY_STATUS);
+    if (!hSvc) return 0;
+    
+    DWORD mask = (state == SERVICE_RUNNING) ? SERVICE_NOTIFY_RUNNING | SERVICE_NOTIFY_STOPPED
+                                            : SERVICE_NOTIFY_STOPPED;
+    volatile LONG fired = 0;
+    SERVICE_NOTIFYA notify;
+    memset(&notify, 0, sizeof(notify));
+    notify.dwVersion = SERVICE_NOTIFY_STATUS_CHANGE;
+    notify.pfnNotifyCallback = onServiceNotify;
+    notify.pContext = (void*)&fired;
+    int pending = 0;
+    int reached = 0;
+    
+    DWORD start = GetTickCount();
+    for (;;) {
+        SERVICE_STATUS_PROCESS ssp;
+        DWORD needed = 0;
+        if (!QueryServiceStatusEx(hSvc, SC_STATUS_PROCESS_INFO, (LPBYTE)&ssp, sizeof(ssp), &needed)) break;
+        if (ssp.dwCurrentState == state) {
+            reached = 1;
+            break;
+        }
+        if (state == SERVICE_RUNNING && ssp.dwCurrentState == SERVICE_STOPPED) {
+            if (exitCode) {
+                *exitCode = (ssp.dwWin32ExitCode == ERROR_SERVICE_SPECIFIC_ERROR)
+                    ? ssp.dwServiceSpecificExitCode : ssp.dwWin32ExitCode;
+            }
+            break;
+        }
+        
+        DWORD elapsed = GetTickCount() - start;
+        if (elapsed >= timeoutMs) {
+            timedOut = 1;
+            break;
+        }
+        DWORD remaining = timeoutMs - elapsed;
+        
+        if (fired) {
+            fired = 0;
+            pending = 0;
+        }
+        if (!pending && NotifyServiceStatusChangeA(hSvc, mask, &notify) == ERROR_SUCCESS) pending = 1;
+        
+        if (pending) {
+            SleepEx(remaining < 1000 ? remaining : 1000, TRUE);
+        } else {
+            DWORD hint = ssp.dwWaitHint / 10;
+            if (hint < 50) hint = 50;
+            if (hint > 500) hint = 500;
+            if (budget.p50Ms) hint = waitBudgetPollMs(&budget, elapsed);
+            Sleep(hint < remaining ? hint : remaining);
+        }
+    }
+    
+    CloseServiceHandle(hSvc);
+    if (pending) SleepEx(0, TRUE);  /* Let a callback that raced the close run while `notify` is alive */
+    if (reached || timedOut) waitBudgetRecord(phase, &budget, GetTickCount() - start, reached);
+    return reached;
+}
+
+static int findPlanService(char names[][SERVICE_NAME_LEN], int count, const char* name) {
+    for (int i = 0; i < count; i++) {
+        if (_stricmp(names[i], name) == 0) return i;
+    }
+    return -1;
+}
+
+/* Expand the targets with their running dependents (those have to stop first
+ * or the SCM refuses the stop) and order the set so that nothing is stopped
+ * while something still running in the set depends on it. Dependencies come
+ * from each service's own configuration, so the order follows the machine
+ * rather than a hard-coded list. Returns the stop order; start is its reverse. */
+static int buildServicePlan(const char* const* targets, int targetCount, char order[][SERVICE_NAME_LEN]) {
+    static char names[MAX_PLAN_SERVICES][SERVICE_NAME_LEN];
+    static unsigned int dependsOn[MAX_PLAN_SERVICES];   /* Bit j: service i depends on service j */
+    static BYTE buffer[8192];
+    int count = 0;
+    
+    for (int t = 0; t < targetCount; t++) {
+        if (count < MAX_PLAN_SERVICES && findPlanService(names, count, targets[t]) < 0) {
+            strncpy(names[count], targets[t], SERVICE_NAME_LEN - 1);
+            names[count][SERVICE_NAME_LEN - 1] = '\0';
+            count++;
+        }
+        
+        SC_HANDLE hSvc = openCachedService(targets[t]);
+        if (!hSvc) continue;
+        DWORD needed = 0, returned = 0;
+        ENUM_SERVICE_STATUSA* deps = (ENUM_SERVICE_STATUSA*)buffer;
+        if (!EnumDependentServicesA(hSvc, SERVICE_ACTIVE, deps, sizeof(buffer), &needed, &returned)) continue;
+        for (DWORD d = 0; d < returned && count < MAX_PLAN_SERVICES; d++) {
+            if (findPlanService(names, count, deps[d].lpServiceName) >= 0) continue;
+            strncpy(names[count], deps[d].lpServiceName, SERVICE_NAME_LEN - 1);
+            names[count][SERVICE_NAME_LEN - 1] = '\0';
+            count++;
+        }
+    }
+    
+    for (int i = 0; i < count; i++) {
+        dependsOn[i] = 0;
+        SC_HANDLE hSvc = openCachedService(names[i]);
+        if (!hSvc) continue;
+        QUERY_SERVICE_CONFIGA* cfg = (QUERY_SERVICE_CONFIGA*)buffer;
+        DWORD needed = 0;
+        if (!QueryServiceConfigA(hSvc, cfg, sizeof(buffer), &needed) || !cfg->lpDependencies) continue;
+        /* Double-null list; entries starting with '+' are load-order groups */
+        for (const char* dep = cfg->lpDependencies; *dep; dep += strlen(dep) + 1) {
+            if (dep[0] == '+') continue;
+            int j = findPlanService(names, count, dep);
+            if (j >= 0 && j != i) dependsOn[i] |= 1u << j;
+        }
+    }
+    
+    unsigned int remaining = (count >= 32) ? ~0u : (1u << count) - 1;
+    int n = 0;
+    while (n < count) {
+        int picked = -1;
+        for (int i = 0; i < count && picked < 0; i++) {
+            if (!(remaining & (1u << i))) continue;
+            int needed = 0;
+            for (int k = 0; k < count; k++) {
+                if ((remaining & (1u << k)) && (dependsOn[k] & (1u << i))) needed = 1;
+            }
+            if (!needed) picked = i;
+        }
+        if (picked < 0) {
+            /* Dependency cycle - shouldn't happen; keep discovery order */
+            for (int i = 0; i < count; i++) if (remaining & (1u << i)) { picked = i; break; }
+        }
+        strcpy(order[n++], names[picked]);
+        remaining &= ~(1u << picked);
+    }
+    return n;
+}
+
+/* Stop the services and everything running that depends on them, in
+ * dependency order, then start them back in reverse. Each transition is
+ * waited on individually so the log shows which service is slow. Returns 1
+ * if every one is running again. */
+static int restartServices(const char* const* names, int count) {
+    char order[MAX_PLAN_SERVICES][SERVICE_NAME_LEN];
+    int ok = 1;
+    
+    LONGLONG span = traceBegin();
+    int planned = buildServicePlan(names, count, order);
+    traceEnd("service", "plan", NULL, span);
+    
+    /* Built first and logged as one line, so lines from the workers can't land inside it */
+    char line[LOG_LINE_MAX - 1];
+    size_t len = (size_t)snprintf(line, sizeof(line), "[i] Service order:");
+    for (int i = 0; i < planned && len < sizeof(line); i++) {
+        len += (size_t)snprintf(line + len, sizeof(line) - len, " %s", order[i]);
+    }
+    logMsg("%s\n", line);
+    
+    for (int i = 0; i < planned; i++) {
+        DWORD start = GetTickCount();
+        span = traceBegin();
+        int stopped = controlService(order[i], 0) && waitServiceState(order[i], SERVICE_STOPPED, NULL);
+        traceEnd("wait", "service-stopped", order[i], span);
+        if (stopped) {
+            logMsg("    [+] %s stopped (%lu ms)\n", order[i], GetTickCount() - start);
+        } else {
+            logAt(LOG_WARN, "    [!] %s did not stop (%lu ms)\n", order[i], GetTickCount() - start);
+        }
+    }
+    
+    for (int i = planned - 1; i >= 0; i--) {
+        DWORD start = GetTickCount();
+        DWORD exitCode = 0;
+        span = traceBegin();
+        int running = controlService(order[i], 1) && waitServiceState(order[i], SERVICE_RUNNING, &exitCode);
+        traceEnd("wait", "service-running", order[i], span);
+        if (running) {
+            logMsg("    [+] %s running (%lu ms)\n", order[i], GetTickCount() - start);
+        } else if (exitCode) {
+            logAt(LOG_ERROR, "    [!] %s failed to start, exit code %lu (%lu ms)\n", order[i], exitCode,
+                  GetTickCount() - start);
+            ok = 0;
+        } else {
+            logAt(LOG_WARN, "    [!] %s not running (%lu ms)\n", order[i], GetTickCount() - start);
+            ok = 0;
+        }
+    }
+    
+    if (ok) {
+        logMsg("[+] Audio services running.\n");
+    } else {
+        logAt(LOG_WARN, "[!] WARNING: Audio services may not be running!\n");
+    }
+    audioActorMarkStale();
+    return ok;
+}
+
+/* ========== Launch Applications ========== */
+/* Minimize the visible windows of every process named exeName, as of the
+ * last process table refresh */
+static void minimizeProcessWindows(const char* exeName) {
+    DWORD pids[16];
+    HWND hwnds[64];
+    int found = processTableFind(exeName, pids, 16);
+    for (int i = 0; i < found; i++) {
+        int n = processTableWindows(pids[i], hwnds, 64);
+        for (int w = 0; w < n; w++) {
+            if (IsWindowVisible(hwnds[w])) ShowWindow(hwnds[w], SW_MINIMIZE);
+        }
+    }
+}
+
+/* Re-reads the process table */
+static int isProcessRunning(const char* exeName) {
+    DWORD pid;
+    return processTableRefresh() && processTableFind(exeName, &pid, 1) > 0;
+}
+
+/* First visible, unowned top-level window of a process, optionally with an
+ * exact title. Refreshes the window map only. */
+static HWND findProcessWindow(DWORD pid, const char* title) {
+    HWND hwnds[64];
+    processTableRefreshWindows();
+    int n = processTableWindows(pid, hwnds, 64);
+    for (int i = 0; i < n; i++) {
+        if (!IsWindowVisible(hwnds[i]) || GetWindow(hwnds[i], GW_OWNER)) continue;
+        if (title) {
+            char text[256];
+            if (GetWindowTextA(hwnds[i], text, sizeof(text)) == 0 || strcmp(text, title) != 0) continue;
+        }
+        return hwnds[i];
+    }
+    return NULL;
+}
+
+#define LAUNCH_POLL_MS 100
+
+/* Waiting for a specific window uses SetWinEventHook scoped to the launched
+ * PID. Out-of-context events are delivered through the hooking thread's
+ * message queue, so the waiter pumps messages while it waits. The callback
+ * gets no context pointer; each waiting thread registers itself in a small
+ * slot table and the callback finds it by thread ID. */
+typedef struct WindowWait {
+    DWORD threadId;
+    const char* title;
+    HWND found;
+} WindowWait;
+
+#define MAX_WINDOW_WAITS 4
+static WindowWait* volatile g_windowWaits[MAX_WINDOW_WAITS];
+
+static void CALLBACK onWindowEvent(HWINEVENTHOOK hook, DWORD event, HWND hwnd, LONG idObject, LONG idChild,
+                                   DWORD eventThread, DWORD eventTime) {
+    (void)hook; (void)event; (void)eventThread; (void)eventTime;
+    if (idObject != OBJID_WINDOW || idChild != CHILDID_SELF || !hwnd) return;
+    
+    WindowWait* wait = NULL;
+    DWORD self = GetCurrentThreadId();
+    for (int i = 0; i < MAX_WINDOW_WAITS && !wait; i++) {
+        if (g_windowWaits[i] && g_windowWaits[i]->threadId == self) wait = g_windowWaits[i];
+    }
+    if (!wait || wait->found) return;
+    if (GetAncestor(hwnd, GA_ROOT) != hwnd || !IsWindowVisible(hwnd)) return;
+    
+    char text[256];
+    if (GetWindowTextA(hwnd, text, sizeof(text)) == 0 || strcmp(text, wait->title) != 0) return;
+    wait->found = hwnd;
+    ShowWindow(hwnd, SW_MINIMIZE);  /* The moment it shows, not after a settle delay */
+}
+
+/* Resume a process created suspended and wait for its top-level window with
+ * this title, minimizing it as soon as it shows. Returns 1 when seen, -1 if
+ * the process exited first, 0 on timeout. Polls the window map instead if
+ * the hooks can't be installed. */
+static int waitAppWindow(const PROCESS_INFORMATION* pi, const char* title, DWORD timeoutMs) {
+    WindowWait wait = { 0 };
+    wait.threadId = GetCurrentThreadId();
+    wait.title = title;
+    int slot = -1;
+    for (int i = 0; i < MAX_WINDOW_WAITS && slot < 0; i++) {
+        if (InterlockedCompareExchangePointer((void* volatile*)&g_windowWaits[i], &wait, NULL) == NULL) slot = i;
+    }
+    
+    /* Hooked before the process runs, so its first window can't be missed.
+     * Some windows only get their title after they are shown. */
+    HWINEVENTHOOK hookShow = NULL, hookName = NULL;
+    if (slot >= 0) {
+        hookShow = SetWinEventHook(EVENT_OBJECT_SHOW, EVENT_OBJECT_SHOW, NULL, onWindowEvent,
+                                   pi->dwProcessId, 0, WINEVENT_OUTOFCONTEXT);
+        hookName = SetWinEventHook(EVENT_OBJECT_NAMECHANGE, EVENT_OBJECT_NAMECHANGE, NULL, onWindowEvent,
+                                   pi->dwProcessId, 0, WINEVENT_OUTOFCONTEXT);
+    }
+    int hooked = hookShow && hookName;
+    ResumeThread(pi->hThread);
+    
+    int result = 0;
+    DWORD start = GetTickCount();
+    DWORD wake = QS_ALLINPUT;   /* The window events arrive through this thread's queue */
+    for (;;) {
+        if (!hooked && !wait.found) {
+            wait.found = findProcessWindow(pi->dwProcessId, title);
+            if (wait.found) ShowWindow(wait.found, SW_MINIMIZE);
+        }
+        if (wait.found) {
+            result = 1;
+            break;
+        }
+        
+        DWORD elapsed = GetTickCount() - start;
+        if (elapsed >= timeoutMs) break;
+        DWORD remaining = timeoutMs - elapsed;
+        if (!hooked && remaining > LAUNCH_POLL_MS) remaining = LAUNCH_POLL_MS;
+        if (MsgWaitForMultipleObjects(1, &pi->hProcess, FALSE, remaining, wake) == WAIT_OBJECT_0) {
+            result = -1;
+            break;
+        }
+        if (wake == QS_SENDMESSAGE) serveSentMessages();
+        else if (!pumpMessages()) wake = QS_SENDMESSAGE;
+    }
+    
+    if (hookShow) UnhookWinEvent(hookShow);
+    if (hookName) UnhookWinEvent(hookName);
+    if (slot >= 0) InterlockedExchangePointer((void* volatile*)&g_windowWaits[slot], NULL);
+    return result;
+}
+
+/* Launch minimized and wait on the process handle until the app is ready:
+ * its window titled readyWindow if given (event-driven, minimized on sight),
+ * otherwise input-idle or its first window. The handle also gives an early
+ * exit immediately; an exit code of 0 with the exe still in the process list
+ * is a launcher handing off (or a second instance deferring to the first),
+ * anything else a crash. */
+static int launchApp(const char* path, const char* exeName, const char* friendlyName,
+                     const char* readyWindow, DWORD timeoutMs) {
+    if (!path[0] || GetFileAttributesA(path) == INVALID_FILE_ATTRIBUTES) {
+        logAt(LOG_WARN, "[!] %s not found.\n", friendlyName);
+        return 0;
+    }
+    
+    logMsg("[i] Starting %s (minimized)...\n", friendlyName);
+    
+    STARTUPINFOA si = {0};
+    PROCESS_INFORMATION pi = {0};
+    si.cb = sizeof(si);
+    si.dwFlags = STARTF_USESHOWWINDOW;
+    si.wShowWindow = SW_SHOWMINIMIZED;
+    
+    char cmdLine[MAX_PATH + 32];
+    strcpy(cmdLine, path);
+    
+    LONGLONG span = traceBegin();
+    BOOL created = CreateProcessA(NULL, cmdLine, NULL, NULL, FALSE, readyWindow ? CREATE_SUSPENDED : 0,
+                                  NULL, NULL, &si, &pi);
+    traceEnd("launch", "CreateProcess", friendlyName, span);
+    
+    if (!created) {
+        logAt(LOG_ERROR, "[!] Failed to start %s (Error %lu)\n", friendlyName, GetLastError());
+        return 0;
+    }
+    
+    /* Launches run concurrently, so log whole lines rather than progress dots */
+    logMsg("[i] Waiting for %s...\n", friendlyName);
+    span = traceBegin();
+    DWORD start = GetTickCount();
+    int exited = 0;
+    const char* how = NULL;
+    
+    if (readyWindow) {
+        int r = waitAppWindow(&pi, readyWindow, timeoutMs);
+        if (r > 0) how = "window shown and minimized";
+        exited = (r < 0);
+    } else {
+        for (;;) {
+            if (WaitForSingleObject(pi.hProcess, 0) == WAIT_OBJECT_0) {
+                exited = 1;
+                break;
+            }
+            if (WaitForInputIdle(pi.hProcess, 0) == 0) {
+                how = "input idle";
+            } else if (findProcessWindow(pi.dwProcessId, NULL)) {
+                how = "window";
+            }
+            if (how || GetTickCount() - start >= timeoutMs) break;
+            WaitForSingleObject(pi.hProcess, LAUNCH_POLL_MS);  /* Wakes at once if it exits */
+        }
+    }
+    CloseHandle(pi.hThread);
+    
+    if (exited) {
+        DWORD exitCode = 0;
+        GetExitCodeProcess(pi.hProcess, &exitCode);
+        if (exitCode == 0 && isProcessRunning(exeName)) {
+            how = "handed off";
+        } else {
+            logAt(LOG_ERROR, "[!] %s exited during startup (exit code %lu, after %lu ms)\n",
+                  friendlyName, exitCode, GetTickCount() - start);
+        }
+    } else if (!how) {
+        logAt(LOG_WARN, "[!] %s may not have started properly.\n", friendlyName);
+    }
+    int ready = (how != NULL);
+    
+    traceEnd("wait", "app-ready", friendlyName, span);
+    if (ready) logMsg("[+] %s %s after %lu ms.\n", friendlyName, how, GetTickCount() - start);
+    CloseHandle(pi.hProcess);
+    return ready;
+}
+
+/* ========== Device Event Source ========== */
+/* MMDevice-backed DeviceEventSource (see reset_core.h). The endpoint
+ * notification registration and the enumeration both go through the audio
+ * actor. */
+typedef struct MMDeviceEventSource {
+    DeviceEventSource base;
+    EndpointSnapshot snapshot;
+    HANDLE hChanged;
+    int ownsEvent;
+    int registered;
+} MMDeviceEventSource;
+
+static int mmSource_subscribe(DeviceEventSource* self) {
+    MMDeviceEventSource* src = (MMDeviceEventSource*)self;
+    if (src->hChanged && !src->registered) src->registered = audioSubscribe(src->hChanged, AUDIO_EVENT_ENDPOINTS);
+    return src->registered;
+}
+
+static void mmSource_unsubscribe(DeviceEventSource* self) {
+    MMDeviceEventSource* src = (MMDeviceEventSource*)self;
+    if (src->registered) {
+        audioUnsubscribe(src->hChanged);
+        src->registered = 0;
+    }
+}
+
+static void mmSource_refresh(DeviceEventSource* self) {
+    MMDeviceEventSource* src = (MMDeviceEventSource*)self;
+    endpointSnapshotFree(&src->snapshot);
+    audioEnumerate(&src->snapshot, DEVICE_STATE_ACTIVE);
+}
+
+static int mmSource_isDeviceActive(DeviceEventSource* self, const WCHAR* id, const WCHAR* name, int dataFlow) {
+    MMDeviceEventSource* src = (MMDeviceEventSource*)self;
+    if (id && endpointSnapshotFindId(&src->snapshot, id)) return 1;
+    return endpointSnapshotFind(&src->snapshot, name, (EDataFlow)dataFlow) != NULL;
+}
+
+static DWORD mmSource_now(DeviceEventSource* self) {
+    (void)self;
+    return GetTickCount();
+}
+
+static int mmSource_waitChange(DeviceEventSource* self, DWORD timeoutMs) {
+    MMDeviceEventSource* src = (MMDeviceEventSource*)self;
+    if (!src->registered) {
+        Sleep(timeoutMs);
+        return 0;
+    }
+    return WaitForSingleObject(src->hChanged, timeoutMs) == WAIT_OBJECT_0;
+}
+
+/* hChanged is signalled on endpoint changes; NULL creates an event of its own */
+static void initMMDeviceEventSource(MMDeviceEventSource* src, HANDLE hChanged) {
+    memset(src, 0, sizeof(*src));
+    src->base.subscribe = mmSource_subscribe;
+    src->base.unsubscribe = mmSource_unsubscribe;
+    src->base.refresh = mmSource_refresh;
+    src->base.isDeviceActive = mmSource_isDeviceActive;
+    src->base.now = mmSource_now;
+    src->base.waitChange = mmSource_waitChange;
+    src->hChanged = hChanged;
+    if (!src->hChanged) {
+        src->hChanged = CreateEventA(NULL, FALSE, FALSE, NULL);
+        src->ownsEvent = 1;
+    }
+}
+
+static void freeMMDeviceEventSource(MMDeviceEventSource* src) {
+    mmSource_unsubscribe(&src->base);
+    if (src->ownsEvent && src->hChanged) CloseHandle(src->hChanged);
+    src->hChanged = NULL;
+    endpointSnapshotFree(&src->snapshot);
+}
+
+/* ========== Device Readiness ========== */
+/* The waiter itself is waitForDevicesReady() in reset_core.h. Returns 1 if
+ * every configured device became active. */
+static int waitForElgatoDevices(void) {
+    logMsg("[i] Waiting for configured audio devices...\n");
+    
+    ReadyTarget targets[] = {
+        { g_playbackDefaultId, g_playbackDefault, DEVICE_FLOW_RENDER,  "Playback default" },
+        { g_playbackCommId,    g_playbackComm,    DEVICE_FLOW_RENDER,  "Playback comms" },
+        { g_recordDefaultId,   g_recordDefault,   DEVICE_FLOW_CAPTURE, "Recording default" },
+        { g_recordCommId,      g_recordComm,      DEVICE_FLOW_CAPTURE, "Recording comms" },
+    };
+    int count = sizeof(targets) / sizeof(targets[0]);
+    
+    MMDeviceEventSource src;
+    initMMDeviceEventSource(&src, NULL);
+    
+    DWORD elapsedMs = 0;
+    WaitBudget budget = waitBudget(PHASE_DEVICES);
+    LONGLONG span = traceBegin();
+    int ready = waitForDevicesReady(&src.base, targets, count, &budget, &elapsedMs);
+    traceEnd("wait", "devices-ready", ready ? NULL : "timeout", span);
+    waitBudgetRecord(PHASE_DEVICES, &budget, elapsedMs, ready);
+    if (ready) {
+        logMsg("[+] Audio devices ready (%.1f sec).\n", elapsedMs / 1000.0);
+    } else {
+        /* The snapshot still holds the state from the last check */
+        logAt(LOG_WARN, "[!] Devices not detected after %.1f sec - proceeding anyway:\n", budget.timeoutMs / 1000.0);
+        for (int i = 0; i < count; i++) {
+            if (targets[i].name[0] && !src.base.isDeviceActive(&src.base, targets[i].id, targets[i].name, targets[i].dataFlow)) {
+                logAt(LOG_WARN, "    [!] %s: %ls\n", targets[i].label, targets[i].name);
+            }
+        }
+    }
+    
+    freeMMDeviceEventSource(&src);
+    return ready;
+}
+
+/* Give the relaunched apps a moment to finish claiming their endpoints:
+ * returns once no endpoint has changed for SETTLE_QUIET_MS, or when the
+ * settle budget runs out */
+static void waitEndpointsSettle(void) {
+    WaitBudget budget = waitBudget(PHASE_SETTLE);
+    HANDLE hChanged = CreateEventA(NULL, FALSE, FALSE, NULL);
+    LONGLONG span = traceBegin();
+    DWORD start = GetTickCount();
+    int quiet = 0;
+    
+    if (hChanged && audioSubscribe(hChanged, AUDIO_EVENT_ENDPOINTS)) {
+        for (;;) {
+            DWORD elapsed = GetTickCount() - start;
+            if (elapsed >= budget.timeoutMs) break;
+            DWORD remaining = budget.timeoutMs - elapsed;
+            if (remaining < SETTLE_QUIET_MS) {
+                Sleep(remaining);
+                break;
+            }
+            if (WaitForSingleObject(hChanged, SETTLE_QUIET_MS) == WAIT_TIMEOUT) {
+                quiet = 1;
+                break;
+            }
+        }
+        audioUnsubscribe(hChanged);
+    } else {
+        Sleep(budget.timeoutMs);
+    }
+    if (hChanged) CloseHandle(hChanged);
+    
+    DWORD took = GetTickCount() - start;
+    waitBudgetRecord(PHASE_SETTLE, &budget, took, quiet);
+    traceEnd("wait", "settle", quiet ? NULL : "timeout", span);
+    logAt(LOG_DEBUG, "[i] Endpoints %s after %lu ms.\n", quiet ? "settled" : "still changing", took);
+}
+
+/* ========== Reset Journal ========== */
+/* A reset that dies halfway (process killed, scheduled task timed out) used
+ * to leave things worse than before: volumes stuck at the safe level with the
+ * saved levels gone, WaveLink not running. So each journaled run appends to
+ * reset.journal in the install folder - which graph it is running, every
+ * endpoint's level before it gets lowered, and each step as it completes -
+ * and deletes the file when it finishes. Every record is one line written
+ * through to disk before the run moves on. If the file is still there on the
+ * next launch, that run picks up where the old one stopped; a torn last line
+ * is ignored (journalParse in reset_core.h) and cut off before the resumed
+ * run appends to the file.
+ *
+ *   run <graph>
+ *   volume <level> <endpoint id>
+ *   step <name>
+ *   resume */
+#define JOURNAL_FILE        "reset.journal"
+#define JOURNAL_MAX_BYTES   (256 * 1024)    /* Far beyond any real journal */
+
+typedef struct JournalVolume {
+    WCHAR id[MAX_ENDPOINT_ID];
+    float level;
+} JournalVolume;
+
+typedef struct ResetJournal {
+    CRITICAL_SECTION lock;      /* Steps finish on several workers, levels come from the guard thread */
+    int lockReady;
+    HANDLE hFile;               /* Open while a journaled run is in progress */
+    int resuming;               /* That run continues an interrupted one */
+    JournalRecords found;       /* What journalLoad() found: the interrupted run's graph and steps */
+    JournalVolume volumes[MAX_JOURNAL_VOLUMES];     /* and the levels it saved */
+    int volumeCount;
+} ResetJournal;
+
+static ResetJournal g_journal = {0};
+
+static void journalPath(char* out, size_t len) {
+    snprintf(out, len, "%s\\" JOURNAL_FILE, g_exeDir);
+}
+
+/* Append one record and flush it to disk. Caller holds the lock. */
+static void journalWrite(const char* fmt, ...) {
+    if (!g_journal.hFile) return;
+    char line[JOURNAL_LINE_MAX];
+    va_list args;
+    va_start(args, fmt);
+    int n = vsnprintf(line, sizeof(line), fmt, args);
+    va_end(args);
+    if (n <= 0 || n >= (int)sizeof(line)) return;
+    
+    DWORD written;
+    WriteFile(g_journal.hFile, line, (DWORD)n, &written, NULL);
+    FlushFileBuffers(g_journal.hFile);
+}
+
+/* Read what an interrupted run left behind. Returns 1 if there is one. */
+static int journalLoad(void) {
+    memset(&g_journal.found, 0, sizeof(g_journal.found));
+    g_journal.volumeCount = 0;
+    
+    char path[MAX_PATH];
+    journalPath(path, MAX_PATH);
+    FILE* f = fopen(path, "rb");
+    if (!f) return 0;
+    char* data = (char*)malloc(JOURNAL_MAX_BYTES);
+    size_t len = data ? fread(data, 1, JOURNAL_MAX_BYTES, f) : 0;
+    fclose(f);
+    
+    int found = data && journalParse(data, len, &g_journal.found);
+    free(data);
+    for (int i = 0; i < g_journal.found.volumeCount; i++) {
+        JournalVolume* v = &g_journal.volumes[g_journal.volumeCount];
+        v->level = g_journal.found.volumes[i].level;
+        if (MultiByteToWideChar(CP_UTF8, 0, g_journal.found.volumes[i].id, -1, v->id, MAX_ENDPOINT_ID)) {
+            g_journal.volumeCount++;
+        }
+    }
+    return found;
+}
+
+/* Start journaling a run of graph. With resume, the interrupted run's
+ * journal (already loaded) is kept and appended to. */
+static void journalBegin(const char* graph, int resume) {
+    if (!g_journal.lockReady) {
+        InitializeCriticalSection(&g_journal.lock);
+        g_journal.lockReady = 1;
+    }
+    
+    char path[MAX_PATH];
+    journalPath(path, MAX_PATH);
+    EnterCriticalSection(&g_journal.lock);
+    g_journal.hFile = CreateFileA(path, resume ? GENERIC_WRITE : FILE_APPEND_DATA, FILE_SHARE_READ, NULL,
+                                  resume ? OPEN_ALWAYS : CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (g_journal.hFile == INVALID_HANDLE_VALUE) {
+        g_journal.hFile = NULL;
+        logAt(LOG_WARN, "[!] Could not open the reset journal (Error %lu) - an interrupted reset can't be resumed.\n",
+              GetLastError());
+    } else if (resume) {
+        /* Drop a torn last line so "resume" starts a line of its own */
+        SetFilePointer(g_journal.hFile, (LONG)g_journal.found.validLen, NULL, FILE_BEGIN);
+        SetEndOfFile(g_journal.hFile);
+    }
+    g_journal.resuming = resume;
+    if (resume) {
+        journalWrite("resume\n");
+    } else {
+        memset(&g_journal.found, 0, sizeof(g_journal.found));
+        g_journal.volumeCount = 0;
+        journalWrite("run %s\n", graph);
+    }
+    LeaveCriticalSection(&g_journal.lock);
+}
+
+static void journalStep(const char* name) {
+    if (!g_journal.lockReady) return;
+    EnterCriticalSection(&g_journal.lock);
+    journalWrite("step %s\n", name);
+    LeaveCriticalSection(&g_journal.lock);
+}
+
+/* An endpoint's level from before the reset, recorded before it is lowered */
+static void journalVolume(const WCHAR* id, float level) {
+    if (!g_journal.lockReady) return;
+    EnterCriticalSection(&g_journal.lock);
+    journalWrite("volume %.4f %ls\n", level, id);
+    LeaveCriticalSection(&g_journal.lock);
+}
+
+/* The run finished - nothing left to resume */
+static void journalEnd(void) {
+    if (!g_journal.lockReady) return;
+    char path[MAX_PATH];
+    journalPath(path, MAX_PATH);
+    EnterCriticalSection(&g_journal.lock);
+    if (g_journal.hFile) CloseHandle(g_journal.hFile);
+    g_journal.hFile = NULL;
+    g_journal.resuming = 0;
+    DeleteFileA(path);
+    LeaveCriticalSection(&g_journal.lock);
+}
+
+static int journalResuming(void) {
+    return g_journal.hFile && g_journal.resuming;
+}
+
+/* 1 if the interrupted run completed this step */
+static int journalStepDone(const char* name) {
+    for (int i = 0; i < g_journal.found.stepCount; i++) {
+        if (strcmp(g_journal.found.steps[i], name) == 0) return 1;
+    }
+    return 0;
+}
+
+/* Level the interrupted run saved for an endpoint, -1 if none (or not resuming) */
+static float journalSavedVolume(const WCHAR* id) {
+    if (!journalResuming()) return -1.0f;
+    for (int i = 0; i < g_journal.volumeCount; i++) {
+        if (wcscmp(g_journal.volumes[i].id, id) == 0) return g_journal.volumes[i].level;
+    }
+    return -1.0f;
+}
+
+/* ========== Volume Guard ========== */
+/* Keeps every render endpoint at or below SAFE_VOLUME for the length of a
+ * reset. Endpoints come back at 100% when audiosrv restarts, so instead of
+ * lowering the default device once, a guard thread watches them all: each
+ * endpoint's level is saved and lowered when first seen, a volume-change
+ * callback wakes the thread to clamp any jump, and endpoint arrivals trigger
+ * a rescan so re-created endpoints are caught as they come back. When the
+ * reset ends every endpoint gets its own saved level back. Changes made by
+ * the guard (and by unmuteDevice) carry its event context and are ignored.
+ * Saved levels go into the reset journal before anything is lowered; a
+ * resumed run takes them from there, since by then the endpoints are
+ * already at the safe level. */
+#define SAFE_VOLUME 0.20f
+#define MAX_GUARDED_ENDPOINTS 32
+#define GUARD_RESCAN_MS 500     /* Safety net while endpoint notifications are down */
+
+DEFINE_GUID(MY_IID_IAudioEndpointVolumeCallback, 0x657804FA, 0xD6AD, 0x4496, 0x8A, 0x60, 0x35, 0x27, 0x52, 0xAF, 0x4F, 0x89);
+DEFINE_GUID(MY_GUID_VolumeGuardContext, 0x3D1B7E62, 0x5C4A, 0x4F0E, 0x9B, 0x21, 0x6E, 0x84, 0xA7, 0x0C, 0x52, 0xD9);
+
+typedef struct GuardedEndpoint {
+    IAudioEndpointVolumeCallback callback;  /* Embedded so OnNotify can find the endpoint */
+    WCHAR id[MAX_ENDPOINT_ID];
+    WCHAR name[128];
+    int watched;                    /* callback is attached through the audio actor */
+    float saved;                    /* Level before the reset, -1 if first seen mid-reset */
+    int clamped;
+    volatile LONG exempt;           /* Level set on purpose (unmuteDevice) - leave alone */
+    volatile LONG spike;
+    LARGE_INTEGER spikeAt;
+} GuardedEndpoint;
+
+typedef struct VolumeGuard {
+    CRITICAL_SECTION lock;          /* endpoints[] is appended to while exemptions look it up */
+    int lockReady;
+    HANDLE hThread;
+    HANDLE hStop;
+    HANDLE hClamp;                  /* A callback saw a spike */
+    HANDLE hRescan;                 /* An endpoint was added or changed state */
+    HANDLE hReady;                  /* Initial scan done */
+    LARGE_INTEGER freq;
+    GuardedEndpoint endpoints[MAX_GUARDED_ENDPOINTS];
+    int count;
+} VolumeGuard;
+
+static VolumeGuard g_volGuard;
+
+#define ENDPOINT_FROM_CALLBACK(p) ((GuardedEndpoint*)((char*)(p) - offsetof(GuardedEndpoint, callback)))
+
+static HRESULT STDMETHODCALLTYPE VolumeCallback_QueryInterface(IAudioEndpointVolumeCallback* This, REFIID riid, void** ppv) {
+    if (IsEqualIID(riid, &MY_IID_IUnknown) || IsEqualIID(riid, &MY_IID_IAudioEndpointVolumeCallback)) {
+        *ppv = This;
+        return S_OK;
+    }
+    *ppv = NULL;
+    return E_NOINTERFACE;
+}
+
+/* Entries are static and unregistered before reuse, so counts are nominal */
+static ULONG STDMETHODCALLTYPE VolumeCallback_AddRef(IAudioEndpointVolumeCallback* This) { (void)This; return 1; }
+static ULONG STDMETHODCALLTYPE VolumeCallback_Release(IAudioEndpointVolumeCallback* This) { (void)This; return 1; }
+
+/* Runs on an audio service thread: only record the spike and wake the guard */
+static HRESULT STDMETHODCALLTYPE VolumeCallback_OnNotify(IAudioEndpointVolumeCallback* This, PAUDIO_VOLUME_NOTIFICATION_DATA data) {
+    GuardedEndpoint* ep = ENDPOINT_FROM_CALLBACK(This);
+    if (!data || IsEqualGUID(&data->guidEventContext, &MY_GUID_VolumeGuardContext)) return S_OK;
+    if (data->fMasterVolume > SAFE_VOLUME + 0.005f && !ep->exempt) {
+        QueryPerformanceCounter(&ep->spikeAt);
+        InterlockedExchange(&ep->spike, 1);
+        SetEvent(g_volGuard.hClamp);
+    }
+    return S_OK;
+}
+
+static IAudioEndpointVolumeCallbackVtbl g_volumeCallbackVtbl = {
+    VolumeCallback_QueryInterface,
+    VolumeCallback_AddRef,
+    VolumeCallback_Release,
+    VolumeCallback_OnNotify
+};
+
+static double guardMsSince(const LARGE_INTEGER* since) {
+    LARGE_INTEGER now;
+    QueryPerformanceCounter(&now);
+    return (double)(now.QuadPart - since->QuadPart) * 1000.0 / (double)g_volGuard.freq.QuadPart;
+}
+
+static void guardSetLevel(GuardedEndpoint* ep, float level) {
+    audioSetVolume(ep->id, level, &MY_GUID_VolumeGuardContext);
+}
+
+static void guardDropEndpoint(GuardedEndpoint* ep) {
+    if (!ep->watched) return;
+    audioUnwatchVolume(&ep->callback);
+    ep->watched = 0;
+}
+
+static GuardedEndpoint* guardFindEndpoint(const WCHAR* id) {
+    for (int i = 0; i < g_volGuard.count; i++) {
+        if (wcscmp(g_volGuard.endpoints[i].id, id) == 0) return &g_volGuard.endpoints[i];
+    }
+    return NULL;
+}
+
+/* Clamp every endpoint whose callback reported a jump */
+static void volumeGuardClampSpikes(void) {
+    for (int i = 0; i < g_volGuard.count; i++) {
+        GuardedEndpoint* ep = &g_volGuard.endpoints[i];
+        if (!InterlockedExchange(&ep->spike, 0) || !ep->watched || ep->exempt) continue;
+        guardSetLevel(ep, SAFE_VOLUME);
+        ep->clamped = 1;
+        logMsg("    [+] Volume spike on %ls clamped to %.0f%% in %.1f ms\n", ep->name, SAFE_VOLUME * 100,
+               guardMsSince(&ep->spikeAt));
+    }
+}
+
+/* Bring the guarded set in line with the active render endpoints: watch new
+ * ones, re-check the level of known ones (the actor re-activates those that
+ * were re-created). wokeAt is when the rescan was triggered, for the reaction
+ * latency. */
+static void volumeGuardScan(const EndpointSnapshot* snap, int initial, const LARGE_INTEGER* wokeAt) {
+    for (int i = 0; i < snap->count; i++) {
+        const EndpointEntry* e = &snap->entries[i];
+        if (e->dataFlow != eRender || wcslen(e->id) >= MAX_ENDPOINT_ID) continue;
+        
+        EnterCriticalSection(&g_volGuard.lock);
+        GuardedEndpoint* ep = guardFindEndpoint(e->id);
+        if (!ep && g_volGuard.count < MAX_GUARDED_ENDPOINTS) {
+            ep = &g_volGuard.endpoints[g_volGuard.count++];
+            memset(ep, 0, sizeof(*ep));
+            ep->callback.lpVtbl = &g_volumeCallbackVtbl;
+            wcscpy(ep->id, e->id);
+            wcsncpy(ep->name, e->name, 127);
+            ep->saved = journalSavedVolume(e->id);
+            ep->clamped = ep->saved >= 0;   /* Lowered by the interrupted run */
+        }
+        LeaveCriticalSection(&g_volGuard.lock);
+        if (!ep || ep->exempt) continue;
+        
+        float level = -1.0f;
+        int fresh = 0;
+        if (ep->watched) {
+            if (!audioGetVolume(ep->id, &level, &fresh)) continue;  /* Gone for now; a later rescan retries */
+        } else {
+            if (!audioWatchVolume(ep->id, &ep->callback, &level)) continue;
+            ep->watched = 1;
+            fresh = 1;
+        }
+        
+        if (initial && ep->saved < 0) {
+            ep->saved = level;
+            journalVolume(ep->id, level);
+        }
+        if (level <= SAFE_VOLUME + 0.005f) continue;
+        
+        guardSetLevel(ep, SAFE_VOLUME);
+        ep->clamped = 1;
+        if (initial) {
+            logMsg("[i] Saved volume of %ls: %.0f%%, lowering to %.0f%% for safety\n", ep->name, level * 100,
+                   SAFE_VOLUME * 100);
+        } else {
+            logMsg("    [+] %ls %s at %.0f%%, clamped to %.0f%% in %.1f ms\n", ep->name,
+                   fresh ? "came back" : "was", level * 100, SAFE_VOLUME * 100, guardMsSince(wokeAt));
+        }
+    }
+}
+
+static void volumeGuardRestore(void) {
+    for (int i = 0; i < g_volGuard.count; i++) {
+        GuardedEndpoint* ep = &g_volGuard.endpoints[i];
+        if (!ep->watched || ep->exempt || !ep->clamped) continue;
+        if (ep->saved >= 0) {
+            logMsg("[i] Restoring volume of %ls to %.0f%%\n", ep->name, ep->saved * 100);
+            guardSetLevel(ep, ep->saved);
+        } else {
+            logMsg("[i] %ls appeared during the reset; leaving it at %.0f%%\n", ep->name, SAFE_VOLUME * 100);
+        }
+    }
+    for (int i = 0; i < g_volGuard.count; i++) guardDropEndpoint(&g_volGuard.endpoints[i]);
+}
+
+static DWORD WINAPI volumeGuardThread(LPVOID param) {
+    MMDeviceEventSource src;
+    (void)param;
+    initMMDeviceEventSource(&src, g_volGuard.hRescan);
+    src.base.subscribe(&src.base);
+    LARGE_INTEGER now;
+    QueryPerformanceCounter(&now);
+    src.base.refresh(&src.base);
+    volumeGuardScan(&src.snapshot, 1, &now);
+    SetEvent(g_volGuard.hReady);
+    
+    HANDLE waits[3];
+    waits[0] = g_volGuard.hStop;
+    waits[1] = g_volGuard.hClamp;
+    waits[2] = g_volGuard.hRescan;
+    for (;;) {
+        DWORD r = WaitForMultipleObjects(3, waits, FALSE, GUARD_RESCAN_MS);
+        if (r == WAIT_OBJECT_0) break;
+        LARGE_INTEGER wokeAt;
+        QueryPerformanceCounter(&wokeAt);
+        if (r == WAIT_OBJECT_0 + 1) {
+            volumeGuardClampSpikes();
+            continue;
+        }
+        
+        /* A failed enumeration makes the actor reconnect on the next command,
+         * which re-registers the subscription and signals hRescan again */
+        if (!src.registered) src.base.subscribe(&src.base);
+        src.base.refresh(&src.base);
+        volumeGuardScan(&src.snapshot, 0, &wokeAt);
+    }
+    
+    volumeGuardClampSpikes();
+    volumeGuardRestore();
+    freeMMDeviceEventSource(&src);
+    return 0;
+}
+
+/* Save every render endpoint's level, lower it to the safe level and keep it
+ * there until restoreVolume. Returns once the initial lowering is done. */
+static void saveAndLowerVolume(void) {
+    /* Runs as the first step of a graph, before anything can call volumeGuardExempt */
+    if (!g_volGuard.lockReady) {
+        InitializeCriticalSection(&g_volGuard.lock);
+        QueryPerformanceFrequency(&g_volGuard.freq);
+        g_volGuard.lockReady = 1;
+    }
+    if (g_volGuard.hThread) return;  /* Already guarding */
+    
+    g_volGuard.count = 0;
+    g_volGuard.hStop = CreateEventA(NULL, TRUE, FALSE, NULL);
+    g_volGuard.hClamp = CreateEventA(NULL, FALSE, FALSE, NULL);
+    g_volGuard.hRescan = CreateEventA(NULL, FALSE, FALSE, NULL);
+    g_volGuard.hReady = CreateEventA(NULL, TRUE, FALSE, NULL);
+    if (g_volGuard.hStop && g_volGuard.hClamp && g_volGuard.hRescan && g_volGuard.hReady) {
+        g_volGuard.hThread = CreateThread(NULL, 0, volumeGuardThread, NULL, 0, NULL);
+    }
+    if (!g_volGuard.hThread) {
+        logAt(LOG_WARN, "[!] Could not start the volume guard.\n");
+        return;
+    }
+    
+    LONGLONG span = traceBegin();
+    WaitForSingleObject(g_volGuard.hReady, 5000);
+    traceEnd("wait", "volume-guard-ready", NULL, span);
+}
+
+/* Stop guarding and put each endpoint back to its saved level */
+static void restoreVolume(void) {
+    if (!g_volGuard.hThread) return;
+    SetEvent(g_volGuard.hStop);
+    WaitForSingleObject(g_volGuard.hThread, 5000);
+    CloseHandle(g_volGuard.hThread);
+    g_volGuard.hThread = NULL;
+    CloseHandle(g_volGuard.hStop);
+    CloseHandle(g_volGuard.hClamp);
+    CloseHandle(g_volGuard.hRescan);
+    CloseHandle(g_volGuard.hReady);
+}
+
+/* The level of this endpoint is being set on purpose; stop guarding it */
+static void volumeGuardExempt(const WCHAR* id) {
+    if (!g_volGuard.lockReady || !id) return;
+    EnterCriticalSection(&g_volGuard.lock);
+    GuardedEndpoint* ep = guardFindEndpoint(id);
+    if (ep) InterlockedExchange(&ep->exempt, 1);
+    LeaveCriticalSection(&g_volGuard.lock);
+}
+
+/* ========== Audio Default Setting ========== */
+/* Resolves configured devices for one run. The stored endpoint ID is tried
+ * first with a direct GetDevice() lookup; the snapshot is only built when a
+ * name has to be matched. */
+typedef struct DeviceResolver {
+    EndpointSnapshot snap;
+    int snapBuilt;
+    int idsChanged;     /* A stored ID was refreshed from a name match */
+} DeviceResolver;
+
+static const EndpointSnapshot* resolverSnapshot(DeviceResolver* r) {
+    if (!r->snapBuilt) {
+        r->snapBuilt = 1;
+        if (!audioEnumerate(&r->snap, DEVICE_STATE_ACTIVE)) {
+            logAt(LOG_ERROR, "[!] Failed to enumerate audio endpoints.\n");
+        }
+    }
+    return &r->snap;
+}
+
+/* Returns the endpoint ID to use for a device, or NULL if it isn't active.
+ * When storedId is given and stale, it is rewritten from the name match. */
+static const WCHAR* resolveDevice(DeviceResolver* r, WCHAR* storedId, const WCHAR* name, EDataFlow dataFlow) {
+    if (storedId && storedId[0] && audioGetState(storedId) == DEVICE_STATE_ACTIVE) return storedId;
+    
+    const EndpointEntry* e = endpointSnapshotFind(resolverSnapshot(r), name, dataFlow);
+    if (!e) return NULL;
+    
+    if (storedId && wcscmp(storedId, e->id) != 0 && wcslen(e->id) < MAX_ENDPOINT_ID) {
+        wcscpy(storedId, e->id);
+        r->idsChanged = 1;
+    }
+    return e->id;
+}
+
+static int setDefaultDevice(const WCHAR* id, ERole role) {
+    return id && audioSetDefault(id, role);
+}
+
+static int unmuteDevice(const WCHAR* id) {
+    if (!id) return 0;
+    volumeGuardExempt(id);  /* Full volume here is intended */
+    return audioSetMute(id, FALSE, NULL) && audioSetVolume(id, 1.0f, &MY_GUID_VolumeGuardContext);
+}
+
+/* Returns 1 if every role was set */
+static int setAudioDefaults(void) {
+    logMsg("[i] Setting audio defaults and volumes...\n");
+    
+    /* Every device for this run resolves through one resolver */
+    DeviceResolver resolver = {0};
+    
+    struct {
+        WCHAR* name;
+        WCHAR* id;
+        EDataFlow dataFlow;
+        ERole role;
+        const char* label;
+    } roles[] = {
+        { g_playbackDefault, g_playbackDefaultId, eRender,  eConsole,        "Playback default" },
+        { g_playbackComm,    g_playbackCommId,    eRender,  eCommunications, "Playback comms" },
+        { g_recordDefault,   g_recordDefaultId,   eCapture, eConsole,        "Recording default" },
+        { g_recordComm,      g_recordCommId,      eCapture, eCommunications, "Recording comms" },
+    };
+    
+    /* Set defaults: eRender = 0, eCapture = 1; eConsole = 0, eCommunications = 2 */
+    const WCHAR* resolved[4];
+    int set = 0;
+    for (int i = 0; i < 4; i++) {
+        resolved[i] = resolveDevice(&resolver, roles[i].id, roles[i].name, roles[i].dataFlow);
+        if (setDefaultDevice(resolved[i], roles[i].role)) {
+            set++;
+            logMsg("    [+] %s: %ls\n", roles[i].label, roles[i].name);
+        } else {
+            logAt(LOG_WARN, "    [!] %s not found: %ls\n", roles[i].label, roles[i].name);
+        }
+    }
+    
+    /* Unmute and set volume */
+    unmuteDevice(resolveDevice(&resolver, NULL, OUTPUT_RAZER_CHAT, eRender));
+    unmuteDevice(resolveDevice(&resolver, NULL, OUTPUT_RAZER_GAME, eRender));
+    unmuteDevice(resolved[2]);  /* Recording default */
+    
+    /* Keep config.txt pointing at the endpoints that actually matched */
+    if (resolver.idsChanged && g_configExists) {
+        writeConfigFile();
+        logMsg("    [i] Updated stored endpoint IDs in config.\n");
+    }
+    
+    endpointSnapshotFree(&resolver.snap);
+    
+    logMsg("[+] Audio defaults configured.\n");
+    return set == 4;
+}
+
+/* ========== Check Admin ========== */
+static int isAdmin(void) {
+    BOOL isAdmin = FALSE;
+    PSID adminGroup = NULL;
+    SID_IDENTIFIER_AUTHORITY ntAuth = SECURITY_NT_AUTHORITY;
+    
+    if (AllocateAndInitializeSid(&ntAuth, 2, SECURITY_BUILTIN_DOMAIN_RID,
+                                  DOMAIN_ALIAS_RID_ADMINS, 0, 0, 0, 0, 0, 0, &adminGroup)) {
+        CheckTokenMembership(NULL, adminGroup, &isAdmin);
+        FreeSid(adminGroup);
+    }
+    return isAdmin;
+}
+
+static void elevateAndRestart(const char* exePath) {
+    SHELLEXECUTEINFOA sei = {0};
+    sei.cbSize = sizeof(sei);
+    sei.lpVerb = "runas";
+    sei.lpFile = exePath;
+    sei.nShow = SW_SHOWNORMAL;
+    sei.fMask = SEE_MASK_NOCLOSEPROCESS;
+    
+    if (ShellExecuteExA(&sei)) {
+        WaitForSingleObject(sei.hProcess, INFINITE);
+        CloseHandle(sei.hProcess);
+    }
+}
+
+/* ========== System Tray Functions ========== */
+static LRESULT CALLBACK TrayWndProc(HWND hwnd, UINT msg, WPARAM wParam, LPARAM lParam) {
+    if (msg == WM_TRAYICON) {
+        if (lParam == WM_LBUTTONUP) {
+            /* Left click - open config GUI */
+            g_trayAction = 1;
+        } else if (lParam == WM_RBUTTONUP) {
+            /* Right click - show context menu */
+            POINT pt;
+            GetCursorPos(&pt);
+            
+            HMENU hMenu = CreatePopupMenu();
+            AppendMenuW(hMenu, MF_STRING, ID_TRAY_OPEN, L"Open Settings");
+            AppendMenuW(hMenu, MF_STRING, ID_TRAY_RUN, L"Run Reset");
+            AppendMenuW(hMenu, MF_SEPARATOR, 0, NULL);
+            AppendMenuW(hMenu, MF_STRING, ID_TRAY_EXIT, L"Exit");
+            
+            /* Required for menu to work properly */
+            SetForegroundWindow(hwnd);
+            
+            UINT cmd = TrackPopupMenu(hMenu, TPM_RETURNCMD | TPM_RIGHTBUTTON, 
+                                       pt.x, pt.y, 0, hwnd, NULL);
+            DestroyMenu(hMenu);
+            
+            if (cmd == ID_TRAY_OPEN) {
+                g_trayAction = 1;  /* Open config */
+            } else if (cmd == ID_TRAY_RUN) {
+                g_trayAction = 2;  /* Run reset */
+            } else if (cmd == ID_TRAY_EXIT) {
+                g_trayAction = 3;  /* Exit */
+            }
+        }
+        return 0;
+    }
+    return DefWindowProcW(hwnd, msg, wParam, lParam);
+}
+
+static void initTrayIcon(void) {
+    /* Create hidden window for tray messages */
+    WNDCLASSW wc = {0};
+    wc.lpfnWndProc = TrayWndProc;
+    wc.hInstance = GetModuleHandle(NULL);
+    wc.lpszClassName = L"ElgatoResetTray";
+    RegisterClassW(&wc);
+    
+    g_trayHwnd = CreateWindowW(L"ElgatoResetTray", L"", 0, 0, 0, 0, 0, 
+                                HWND_MESSAGE, NULL, wc.hInstance, NULL);
+    
+    /* Set up notification icon */
+    g_nid.cbSize = sizeof(NOTIFYICONDATAW);
+    g_nid.hWnd = g_trayHwnd;
+    g_nid.uID = ID_TRAY_ICON;
+    g_nid.uFlags = NIF_ICON | NIF_TIP | NIF_MESSAGE;
+    g_nid.uCallbackMessage = WM_TRAYICON;
+    g_nid.hIcon = LoadIcon(NULL, IDI_APPLICATION);
+    wcscpy(g_nid.szTip, L"Elgato Audio Reset - Starting...");
+    
+    Shell_NotifyIconW(NIM_ADD, &g_nid);
+}
+
+static void updateTrayStatus(const wchar_t* status) {
+    g_trayStatus = status;
+    swprintf(g_nid.szTip, 64, L"Elgato Reset - %s", status);
+    Shell_NotifyIconW(NIM_MODIFY, &g_nid);
+}
+
+static void removeTrayIcon(void) {
+    Shell_NotifyIconW(NIM_DELETE, &g_nid);
+    if (g_trayHwnd) {
+        DestroyWindow(g_trayHwnd);
+        g_trayHwnd = NULL;
+    }
+}
+
+/* Non-blocking completion message - the resident loop can't sit in a MessageBox */
+static void showTrayBalloon(const wchar_t* title, const wchar_t* text) {
+    NOTIFYICONDATAW nid = g_nid;
+    nid.uFlags = NIF_INFO;
+    wcsncpy(nid.szInfoTitle, title, 63);
+    nid.szInfoTitle[63] = L'\0';
+    wcsncpy(nid.szInfo, text, 255);
+    nid.szInfo[255] = L'\0';
+    nid.dwInfoFlags = NIIF_INFO;
+    Shell_NotifyIconW(NIM_MODIFY, &nid);
+}
+
+/* Sleep while pumping messages (for tray icon responsiveness) */
+static void sleepWithMessages(DWORD ms) {
+    DWORD start = GetTickCount();
+    while (GetTickCount() - start < ms) {
+        if (!pumpMessages()) {
+            Sleep(ms - (GetTickCount() - start));
+            return;
+        }
+        Sleep(50);  /* Small sleep between message checks */
+    }
+}
+
+/* ========== Reset Scheduler ========== */
+/* Runs a step graph (StepGraph in reset_core.h) on a small pool of workers,
+ * so independent work (registry discovery, killing processes, StreamDeck
+ * startup vs. device waiting) overlaps. The steps act through the platform
+ * they are given (see Win32 Platform). */
+typedef struct ResetScheduler {
+    Platform* platform;
+    StepGraph graph;                /* Guarded by lock */
+    DWORD stepMs[MAX_RESET_STEPS];  /* Wall time of each step, for the timing summary */
+    CRITICAL_SECTION lock;
+    CONDITION_VARIABLE changed;
+    HANDLE hFinished;
+} ResetScheduler;
+
+static DWORD WINAPI resetWorker(LPVOID param) {
+    ResetScheduler* s = (ResetScheduler*)param;
+    
+    EnterCriticalSection(&s->lock);
+    for (;;) {
+        int idx = stepGraphPick(&s->graph);
+        if (idx == -2) break;
+        if (idx == -1) {
+            SleepConditionVariableCS(&s->changed, &s->lock, INFINITE);
+            continue;
         }
+        LeaveCriticalSection(&s->lock);
+        
+        const ResetStep* step = &s->graph.steps[idx];
+        if (step->status && g_trayHwnd) updateTrayStatus(step->status);
+        statusStepStart(idx, step->status);
+        LONGLONG span = traceBegin();
+        DWORD start = s->platform->now(s->platform);
+        step->run(s->platform);
+        DWORD took = s->platform->now(s->platform) - start;
+        traceEnd("step", step->name, NULL, span);
+        statusStepEnd(idx);
+        journalStep(step->name);
+        
+        EnterCriticalSection(&s->lock);
+        s->stepMs[idx] = took;
+        if (stepGraphFinish(&s->graph, idx)) SetEvent(s->hFinished);
+        WakeAllConditionVariable(&s->changed);
     }
+    LeaveCriticalSection(&s->lock);
     return 0;
 }
 
-static void discoverPaths(void) {
-    char installPath[MAX_PATH];
+/* Run all steps except those in the skip mask (already done by an interrupted
+ * run) to completion. When the tray icon is up the calling thread keeps
+ * pumping messages so the icon stays responsive. Returns 0 if the graph is invalid. */
+static int runResetSteps(Platform* p, const ResetStep* steps, int count, int workers, unsigned int skip) {
+    if (!schedulerValidate(steps, count)) {
+        logAt(LOG_ERROR, "[!] Reset step graph is invalid - aborting.\n");
+        return 0;
+    }
     
-    /* WaveLink */
-    if (findInstallPath("Wave Link", installPath, MAX_PATH)) {
-        snprintf(g_waveLinkPath, MAX_PATH, "%s\\WaveLink.exe", installPath);
-        snprintf(g_waveLinkSEPath, MAX_PATH, "%s\\WaveLinkSE.exe", installPath);
+    processTableInit();
+    
+    const char* names[MAX_RESET_STEPS];
+    for (int i = 0; i < count; i++) names[i] = steps[i].name;
+    statusGraphBegin(names, count, skip);
+    
+    ResetScheduler s = {0};
+    s.platform = p;
+    stepGraphInit(&s.graph, steps, count, skip);
+    InitializeCriticalSection(&s.lock);
+    InitializeConditionVariable(&s.changed);
+    s.hFinished = CreateEventA(NULL, TRUE, FALSE, NULL);
+    if (stepGraphFinished(&s.graph)) SetEvent(s.hFinished);
+    
+    HANDLE threads[RESET_WORKERS];
+    int threadCount = 0;
+    if (workers > RESET_WORKERS) workers = RESET_WORKERS;
+    for (int i = 0; i < workers; i++) {
+        threads[threadCount] = CreateThread(NULL, 0, resetWorker, &s, 0, NULL);
+        if (threads[threadCount]) threadCount++;
     }
-    if (!g_waveLinkPath[0] && GetFileAttributesA("C:\\Program Files\\Elgato\\WaveLink\\WaveLink.exe") != INVALID_FILE_ATTRIBUTES) {
-        strcpy(g_waveLinkPath, "C:\\Program Files\\Elgato\\WaveLink\\WaveLink.exe");
-        strcpy(g_waveLinkSEPath, "C:\\Program Files\\Elgato\\WaveLink\\WaveLinkSE.exe");
+    if (threadCount == 0) {
+        /* No threads available - run everything on this thread instead */
+        resetWorker(&s);
+    } else if (g_trayHwnd) {
+        waitWithMessages(s.hFinished, 1);
     }
     
-    /* StreamDeck */
-    if (findInstallPath("Stream Deck", installPath, MAX_PATH)) {
-        snprintf(g_streamDeckPath, MAX_PATH, "%s\\StreamDeck.exe", installPath);
-    }
-    if (!g_streamDeckPath[0] && GetFileAttributesA("C:\\Program Files\\Elgato\\StreamDeck\\StreamDeck.exe") != INVALID_FILE_ATTRIBUTES) {
-        strcpy(g_streamDeckPath, "C:\\Program Files\\Elgato\\StreamDeck\\StreamDeck.exe");
+    if (threadCount > 0) {
+        WaitForMultipleObjects(threadCount, threads, TRUE, INFINITE);
+        for (int i = 0; i < threadCount; i++) CloseHandle(threads[i]);
     }
     
-    logMsg("[i] Discovered paths:\n");
-    logMsg("    WaveLink: %s\n", g_waveLinkPath[0] ? g_waveLinkPath : "NOT FOUND");
-    logMsg("    WaveLinkSE: %s\n", g_waveLinkSEPath[0] ? g_waveLinkSEPath : "NOT FOUND");
-    logMsg("    StreamDeck: %s\n", g_streamDeckPath[0] ? g_streamDeckPath : "NOT FOUND");
+    logMsg("[i] Step times:\n");
+    for (int i = 0; i < count; i++) {
+        if (skip & STEP_BIT(i)) {
+            logMsg("    %-18s   done before\n", steps[i].name);
+        } else {
+            logMsg("    %-18s %6lu ms\n", steps[i].name, s.stepMs[i]);
+        }
+    }
+    CloseHandle(s.hFinished);
+    DeleteCriticalSection(&s.lock);
+    return 1;
 }
 
-/* ========== Process Functions ========== */
-static void killElgatoProcesses(void) {
-    logMsg("[i] Discovering and killing Elgato processes...\n");
-    
-    HANDLE hSnap = CreateToolhelp32Snapshot(TH32CS_SNAPPROCESS, 0);
-    if (hSnap == INVALID_HANDLE_VALUE) return;
-    
-    PROCESSENTRY32 pe;
-    pe.dwSize = sizeof(pe);
-    int killed = 0;
+/* ========== Health Probe ========== */
+/* Read-only check for status indicators (--probe, pipe "probe"): are the
+ * configured endpoints there and unmuted, are they the Windows defaults (the
+ * mismatch check, by endpoint ID where it resolves), and are WaveLink and
+ * StreamDeck running. One enumeration, one defaults query, one mute query
+ * per configured endpoint and one process snapshot - nothing is changed.
+ * The result is a code with a bit per failed check (0 = healthy) and a
+ * one-line JSON summary. */
+#define PROBE_ENDPOINTS_MISSING 1
+#define PROBE_DEFAULTS_MISMATCH 2
+#define PROBE_WAVELINK_DOWN     4
+#define PROBE_STREAMDECK_DOWN   8
+#define PROBE_MUTED             16
+#define PROBE_AUDIO_UNAVAILABLE 32  /* Couldn't query the endpoints at all */
+#define PROBE_NOT_CONFIGURED    64
+
+typedef struct HealthReport {
+    int code;               /* PROBE_* bits */
+    int missing;            /* Configured roles whose endpoint isn't active */
+    int mismatched;         /* Roles whose Windows default isn't the configured device */
+    int muted;              /* Configured endpoints that are muted */
+    int waveLink;           /* Running */
+    int streamDeck;
+    double ms;
+} HealthReport;
+
+static void healthProbe(HealthReport* r) {
+    LARGE_INTEGER freq, start, end;
+    QueryPerformanceFrequency(&freq);
+    QueryPerformanceCounter(&start);
+    memset(r, 0, sizeof(*r));
+    
+    struct { const WCHAR* name; const WCHAR* id; EDataFlow dataFlow; } roles[] = {
+        { g_playbackDefault, g_playbackDefaultId, eRender  },
+        { g_playbackComm,    g_playbackCommId,    eRender  },
+        { g_recordDefault,   g_recordDefaultId,   eCapture },
+        { g_recordComm,      g_recordCommId,      eCapture },
+    };
     
-    if (Process32First(hSnap, &pe)) {
-        do {
-            if (!isProtected(pe.szExeFile) && isElgatoProcess(pe.szExeFile)) {
-                HANDLE hProc = OpenProcess(PROCESS_TERMINATE, FALSE, pe.th32ProcessID);
-                if (hProc) {
-                    if (TerminateProcess(hProc, 1)) {
-                        logMsg("    [+] Killed: %s (PID %lu)\n", pe.szExeFile, pe.th32ProcessID);
-                        killed++;
-                    }
-                    CloseHandle(hProc);
-                }
+    EndpointSnapshot snap;
+    WCHAR current[4][256];
+    WCHAR currentIds[4][MAX_ENDPOINT_ID];
+    int enumerated = g_configExists && audioEnumerate(&snap, DEVICE_STATE_ACTIVE);
+    if (!g_configExists) {
+        r->code |= PROBE_NOT_CONFIGURED;
+    } else if (!enumerated || !audioGetDefaults(current, currentIds)) {
+        r->code |= PROBE_AUDIO_UNAVAILABLE;
+    } else {
+        const WCHAR* checked[4];
+        int checkedCount = 0;
+        for (int i = 0; i < 4; i++) {
+            if (!roles[i].name[0]) continue;
+            const EndpointEntry* e = endpointSnapshotFindId(&snap, roles[i].id);
+            if (!e) e = endpointSnapshotFind(&snap, roles[i].name, roles[i].dataFlow);
+            if (!e) {
+                r->missing++;
+                r->mismatched++;
+                continue;
             }
-        } while (Process32Next(hSnap, &pe));
+            if (wcscmp(currentIds[i], e->id) != 0) r->mismatched++;
+            
+            /* One device often holds two roles - ask about it once */
+            int seen = 0;
+            for (int k = 0; k < checkedCount; k++) {
+                if (wcscmp(checked[k], e->id) == 0) seen = 1;
+            }
+            if (seen) continue;
+            checked[checkedCount++] = e->id;
+            BOOL mute = FALSE;
+            if (audioGetMute(e->id, &mute) && mute) r->muted++;
+        }
     }
-    CloseHandle(hSnap);
+    if (enumerated) endpointSnapshotFree(&snap);
     
-    if (killed == 0) {
-        logMsg("    [i] No Elgato processes found to kill.\n");
+    DWORD pid;
+    if (processTableRefresh()) {
+        r->waveLink = processTableFind("WaveLink.exe", &pid, 1) > 0;
+        r->streamDeck = processTableFind("StreamDeck.exe", &pid, 1) > 0;
     }
     
-    /* Wait for processes to fully exit */
-    Sleep(1000);
+    if (r->missing) r->code |= PROBE_ENDPOINTS_MISSING;
+    if (r->mismatched) r->code |= PROBE_DEFAULTS_MISMATCH;
+    if (r->muted) r->code |= PROBE_MUTED;
+    if (!r->waveLink) r->code |= PROBE_WAVELINK_DOWN;
+    if (!r->streamDeck) r->code |= PROBE_STREAMDECK_DOWN;
+    
+    QueryPerformanceCounter(&end);
+    r->ms = (end.QuadPart - start.QuadPart) * 1000.0 / freq.QuadPart;
 }
 
-/* ========== Service Control ========== */
-static int controlService(const char* svcName, int start) {
-    SC_HANDLE hSCM = OpenSCManagerA(NULL, NULL, SC_MANAGER_CONNECT);
-    if (!hSCM) return 0;
-    
-    SC_HANDLE hSvc = OpenServiceA(hSCM, svcName, SERVICE_START | SERVICE_STOP | SERVICE_QUERY_STATUS);
-    if (!hSvc) {
-        CloseServiceHandle(hSCM);
-        return 0;
+/* {"ok":true,"code":0,"missing":0,"mismatched":0,"muted":0,"wavelink":true,"streamdeck":true,"ms":8.4} */
+static void healthReportJson(const HealthReport* r, char* out, size_t len) {
+    snprintf(out, len,
+             "{\"ok\":%s,\"code\":%d,\"missing\":%d,\"mismatched\":%d,\"muted\":%d,"
+             "\"wavelink\":%s,\"streamdeck\":%s,\"ms\":%.1f}",
+             r->code ? "false" : "true", r->code, r->missing, r->mismatched, r->muted,
+             r->waveLink ? "true" : "false", r->streamDeck ? "true" : "false", r->ms);
+}
+
+/* ========== Verification Probe ========== */
+/* 1 if every configured device is active and is the Windows default for its
+ * role - the health probe's endpoint checks, matched by ID first. Mute and
+ * the app checks don't decide whether to escalate. */
+#define PROBE_VERIFY_MASK (PROBE_ENDPOINTS_MISSING | PROBE_DEFAULTS_MISMATCH | PROBE_AUDIO_UNAVAILABLE)
+
+static int verifyAudioState(void) {
+    LONGLONG span = traceBegin();
+    HealthReport r;
+    healthProbe(&r);
+    if (r.code & PROBE_AUDIO_UNAVAILABLE) {
+        logAt(LOG_WARN, "    [!] Probe: couldn't query the audio endpoints.\n");
     }
-    
-    SERVICE_STATUS status;
-    int result = 0;
-    
-    if (start) {
-        result = StartServiceA(hSvc, 0, NULL);
-    } else {
-        result = ControlService(hSvc, SERVICE_CONTROL_STOP, &status);
+    if (r.missing) {
+        logAt(LOG_WARN, "    [!] Probe: %d configured device(s) missing.\n", r.missing);
     }
-    
-    CloseServiceHandle(hSvc);
-    CloseServiceHandle(hSCM);
-    return result || GetLastError() == ERROR_SERVICE_ALREADY_RUNNING;
+    if (r.mismatched) {
+        logAt(LOG_WARN, "    [!] Probe: %d Windows default(s) don't match the config.\n", r.mismatched);
+    }
+    traceEnd("probe", "verifyAudioState", NULL, span);
+    return (r.code & PROBE_VERIFY_MASK) == 0;
 }
 
-static int isServiceRunning(const char* svcName) {
-    SC_HANDLE hSCM = OpenSCManagerA(NULL, NULL, SC_MANAGER_CONNECT);
-    if (!hSCM) return 0;
-    
-    SC_HANDLE hSvc = OpenServiceA(hSCM, svcName, SERVICE_QUERY_STATUS);
-    if (!hSvc) {
-        CloseServiceHandle(hSCM);
-        return 0;
+/* ========== Win32 Platform ========== */
+/* The Platform (reset_core.h) the reset graphs run on: each operation is the
+ * Win32 code above for that part of the system */
+static const char* const g_appExes[APP_COUNT] = { "WaveLinkSE.exe", "WaveLink.exe", "StreamDeck.exe" };
+
+static const char* appPath(int app) {
+    if (app == APP_WAVELINK_SE) return g_waveLinkSEPath;
+    return app == APP_WAVELINK ? g_waveLinkPath : g_streamDeckPath;
+}
+
+static DWORD win_now(Platform* self) {
+    (void)self;
+    return GetTickCount();
+}
+
+static void win_log(Platform* self, const char* line) {
+    (void)self;
+    logMsg("%s", line);
+}
+
+static void win_discoverPaths(Platform* self) {
+    (void)self;
+    discoverPaths();
+}
+
+/* WaveLinkSE's path is derived from WaveLink's rather than discovered, so
+ * it only counts if the file is there */
+static int win_appInstalled(Platform* self, int app) {
+    const char* path = appPath(app);
+    (void)self;
+    if (app == APP_WAVELINK_SE) return path[0] && GetFileAttributesA(path) != INVALID_FILE_ATTRIBUTES;
+    return path[0] != '\0';
+}
+
+static int win_stopProcesses(Platform* self, int set) {
+    (void)self;
+    return stopProcesses(set == STOP_WAVELINK ? isWaveLinkExe : isKillableElgato);
+}
+
+static int win_isAppRunning(Platform* self, int app) {
+    (void)self;
+    return isProcessRunning(g_appExes[app]);
+}
+
+static int win_launchApp(Platform* self, int app, DWORD timeoutMs) {
+    (void)self;
+    return launchApp(appPath(app), g_appExes[app], g_appNames[app],
+                     app == APP_STREAMDECK ? "Stream Deck" : NULL, timeoutMs);
+}
+
+static void win_minimizeApp(Platform* self, int app) {
+    (void)self;
+    processTableRefresh();
+    minimizeProcessWindows(g_appExes[app]);
+}
+
+static int win_restartServices(Platform* self, int set) {
+    static const char* const services[] = { "audiosrv", "AudioEndpointBuilder" };
+    (void)self;
+    return restartServices(services, set == SERVICES_AUDIOSRV ? 1 : 2);
+}
+
+static void win_lowerVolume(Platform* self) {
+    (void)self;
+    saveAndLowerVolume();
+}
+
+static void win_restoreVolume(Platform* self) {
+    (void)self;
+    restoreVolume();
+}
+
+static int win_waitDevices(Platform* self) {
+    (void)self;
+    return waitForElgatoDevices();
+}
+
+static void win_waitSettle(Platform* self) {
+    (void)self;
+    waitEndpointsSettle();
+}
+
+static int win_setDefaults(Platform* self) {
+    (void)self;
+    return setAudioDefaults();
+}
+
+static int win_verify(Platform* self) {
+    (void)self;
+    return verifyAudioState();
+}
+
+static int win_resuming(Platform* self) {
+    (void)self;
+    return journalResuming();
+}
+
+static Platform g_platform = {
+    win_now, win_log, win_discoverPaths, win_appInstalled, win_stopProcesses, win_isAppRunning,
+    win_launchApp, win_minimizeApp, win_restartServices, win_lowerVolume, win_restoreVolume,
+    win_waitDevices, win_waitSettle, win_setDefaults, win_verify, win_resuming,
+};
+
+/* ========== Escalation ========== */
+/* TIERED_RESET=1: the tiers and the loop over them are in reset_core.h
+ * (Reset Graphs); this runs each one under the journal. */
+/* Run a tier's graph under the reset journal. With resume, the steps the
+ * interrupted run completed are skipped; replay steps run again unless
+ * nothing else is left. */
+static void runJournaledSteps(const ResetTier* tier, int resume) {
+    unsigned int skip = 0;
+    unsigned int replay = 0;
+    for (int i = 0; i < tier->count; i++) {
+        if (tier->steps[i].replay) {
+            replay |= STEP_BIT(i);
+        } else if (resume && journalStepDone(tier->steps[i].name)) {
+            skip |= STEP_BIT(i);
+        }
     }
+    unsigned int all = stepGraphAll(tier->count);
+    if ((skip | replay) == all) skip = all;
     
-    SERVICE_STATUS status;
-    int running = 0;
-    if (QueryServiceStatus(hSvc, &status)) {
-        running = (status.dwCurrentState == SERVICE_RUNNING);
+    journalBegin(tier->name, resume);
+    runResetSteps(&g_platform, tier->steps, tier->count, RESET_WORKERS, skip);
+    journalEnd();
+}
+
+/* Finish a run that was interrupted (process killed, machine slept for good)
+ * before doing anything else. Returns the tier that was resumed, or NULL if
+ * there was nothing to resume. */
+static const ResetTier* resumeInterruptedRun(void) {
+    if (!journalLoad()) return NULL;
+    const ResetTier* tier = findTier(g_journal.found.graph);
+    if (!tier) {
+        logAt(LOG_WARN, "[!] Ignoring a reset journal for unknown step graph '%s'.\n", g_journal.found.graph);
+        journalEnd();
+        return NULL;
     }
     
-    CloseServiceHandle(hSvc);
-    CloseServiceHandle(hSCM);
-    return running;
+    logAt(LOG_WARN, "[!] The last reset (%s) was interrupted after %d step(s) - resuming it.\n", tier->name,
+          g_journal.found.stepCount);
+    if (g_trayHwnd) updateTrayStatus(L"Resuming interrupted reset...");
+    LONGLONG span = traceBegin();
+    runJournaledSteps(tier, 1);
+    traceEnd("tier", "resume", tier->name, span);
+    return tier;
 }
 
-static void restartAudioServices(void) {
-    logMsg("[i] Restarting audio services...\n");
-    
-    controlService("audiosrv", 0);
-    controlService("AudioEndpointBuilder", 0);
-    Sleep(1000);
-    
-    controlService("AudioEndpointBuilder", 1);
-    controlService("audiosrv", 1);
-    
-    /* Wait for services to start */
-    logMsg("[i] Waiting for audio services");
-    for (int i = 0; i < MAX_SERVICE_WAIT; i++) {
-        if (isServiceRunning("audiosrv") && isServiceRunning("AudioEndpointBuilder")) {
-            logMsg("\n[+] Audio services running after %d sec.\n", i + 1);
-            return;
-        }
-        logMsg(".");
-        fflush(stdout);
-        Sleep(1000);
-    }
-    logMsg("\n[!] WARNING: Audio services may not be running!\n");
+static void runEscalationTier(Platform* p, int t) {
+    const ResetTier* tier = &g_resetTiers[t];
+    (void)p;
+    if (t > 0) logAt(LOG_WARN, "[!] Still not right after %s - escalating.\n", g_resetTiers[t - 1].name);
+    logMsg("[i] Tier %d/%d: %s\n", t + 1, TIER_COUNT, tier->name);
+    
+    LONGLONG span = traceBegin();
+    runJournaledSteps(tier, 0);
+    traceEnd("tier", tier->name, NULL, span);
+    if (g_trayHwnd) updateTrayStatus(L"Verifying...");
 }
 
-/* ========== Launch Applications ========== */
-/* Callback to find and minimize windows by process ID */
-static DWORD g_targetPid = 0;
-static BOOL CALLBACK minimizeWindowCallback(HWND hwnd, LPARAM lParam) {
-    DWORD windowPid = 0;
-    GetWindowThreadProcessId(hwnd, &windowPid);
-    if (windowPid == g_targetPid && IsWindowVisible(hwnd)) {
-        ShowWindow(hwnd, SW_MINIMIZE);
+static void runEscalation(void) {
+    int fixed = resetEscalate(&g_platform, runEscalationTier);
+    if (fixed >= 0) {
+        logMsg("[+] Fixed by tier %d (%s).\n", fixed + 1, g_resetTiers[fixed].name);
+    } else {
+        logAt(LOG_WARN, "[!] Probe still fails after a full reset - check the device names in config.txt.\n");
     }
-    return TRUE; /* Continue enumeration */
 }
 
-static void minimizeProcessWindows(const char* exeName) {
-    HANDLE hSnap = CreateToolhelp32Snapshot(TH32CS_SNAPPROCESS, 0);
-    if (hSnap == INVALID_HANDLE_VALUE) return;
-    
-    PROCESSENTRY32 pe;
-    pe.dwSize = sizeof(pe);
-    
-    if (Process32First(hSnap, &pe)) {
-        do {
-            if (_stricmp(pe.szExeFile, exeName) == 0) {
-                g_targetPid = pe.th32ProcessID;
-                EnumWindows(minimizeWindowCallback, 0);
-            }
-        } while (Process32Next(hSnap, &pe));
+/* ========== Benchmark ========== */
+static int compareDoubles(const void* a, const void* b) {
+    double x = *(const double*)a, y = *(const double*)b;
+    return (x > y) - (x < y);
+}
+
+/* Per-call cost of logging at the call site, written through (the old
+ * behaviour) vs. queued to a writer thread. Both run on a private ring and
+ * writer of their own that write to a scratch file, so the live logger is
+ * never touched. Bursts stay under the ring size so the queued path never
+ * waits for the writer. */
+#define LOG_BENCH_BURSTS 200
+#define LOG_BENCH_BURST  256
+
+typedef struct LogBench {
+    LogRing ring;
+    FILE* file;
+    HANDLE hWake;
+    volatile LONG stop;
+} LogBench;
+
+static DWORD WINAPI logBenchWriter(LPVOID param) {
+    LogBench* b = (LogBench*)param;
+    for (;;) {
+        int stopping = b->stop;
+        WaitForSingleObject(b->hWake, LOG_FLUSH_MS);
+        const char* text;
+        while ((text = logRingPeek(&b->ring)) != NULL) {
+            fputs(text, b->file);
+            logRingPop(&b->ring);
+        }
+        fflush(b->file);
+        if (stopping) return 0;
     }
-    CloseHandle(hSnap);
 }
 
-static int isProcessRunning(const char* exeName) {
-    HANDLE hSnap = CreateToolhelp32Snapshot(TH32CS_SNAPPROCESS, 0);
-    if (hSnap == INVALID_HANDLE_VALUE) return 0;
-    
-    PROCESSENTRY32 pe;
-    pe.dwSize = sizeof(pe);
-    int found = 0;
+static void logBenchLine(LogBench* b, int queued, const char* fmt, ...) {
+    char buf[LOG_LINE_MAX];
+    va_list args;
+    va_start(args, fmt);
+    vsnprintf(buf, sizeof(buf), fmt, args);
+    va_end(args);
+    buf[sizeof(buf) - 1] = '\0';
     
-    if (Process32First(hSnap, &pe)) {
-        do {
-            if (_stricmp(pe.szExeFile, exeName) == 0) {
-                found = 1;
-                break;
-            }
-        } while (Process32Next(hSnap, &pe));
+    if (queued) {
+        logEnqueue(&b->ring, b->hWake, buf);
+    } else {
+        fputs(buf, b->file);
+        fflush(b->file);
     }
-    CloseHandle(hSnap);
-    return found;
 }
 
-static void launchApp(const char* path, const char* exeName, const char* friendlyName) {
-    if (!path[0] || GetFileAttributesA(path) == INVALID_FILE_ATTRIBUTES) {
-        logMsg("[!] %s not found.\n", friendlyName);
+static void benchmarkLogger(void) {
+    char scratchPath[MAX_PATH];
+    snprintf(scratchPath, MAX_PATH, "%s.logbench", g_logPath);
+    LogBench b = {0};
+    LogSlot* slots = (LogSlot*)malloc(LOG_RING_SLOTS * sizeof(LogSlot));
+    b.file = fopen(scratchPath, "w");
+    b.hWake = CreateEventA(NULL, FALSE, FALSE, NULL);
+    HANDLE hWriter = (slots && b.file && b.hWake) ? CreateThread(NULL, 0, logBenchWriter, &b, 0, NULL) : NULL;
+    if (!hWriter) {
+        logAt(LOG_WARN, "[!] Logger benchmark: couldn't set up its scratch writer.\n");
+        if (b.hWake) CloseHandle(b.hWake);
+        if (b.file) fclose(b.file);
+        free(slots);
+        DeleteFileA(scratchPath);
         return;
     }
+    logRingInit(&b.ring, slots, LOG_RING_SLOTS);
+    
+    LARGE_INTEGER freq;
+    QueryPerformanceFrequency(&freq);
+    double nsPerCall[2];
+    
+    for (int mode = 0; mode < 2; mode++) {
+        LONGLONG ticks = 0;
+        for (int burst = 0; burst < LOG_BENCH_BURSTS; burst++) {
+            LARGE_INTEGER t0, t1;
+            QueryPerformanceCounter(&t0);
+            for (int i = 0; i < LOG_BENCH_BURST; i++) {
+                logBenchLine(&b, mode, "    [i] Benchmark line %d of burst %d\n", i, burst);
+            }
+            QueryPerformanceCounter(&t1);
+            ticks += t1.QuadPart - t0.QuadPart;
+            
+            /* Let the writer catch up so the next burst starts with an empty ring */
+            while (b.ring.tail != b.ring.head) {
+                SetEvent(b.hWake);
+                Sleep(1);
+            }
+        }
+        nsPerCall[mode] = ticks * 1e9 / (double)freq.QuadPart / (LOG_BENCH_BURSTS * LOG_BENCH_BURST);
+    }
     
-    logMsg("[i] Starting %s (minimized)...\n", friendlyName);
+    InterlockedExchange(&b.stop, 1);
+    SetEvent(b.hWake);
+    WaitForSingleObject(hWriter, INFINITE);
+    CloseHandle(hWriter);
+    CloseHandle(b.hWake);
+    fclose(b.file);
+    free(slots);
+    DeleteFileA(scratchPath);
+    
+    logMsg("\n%-33s %9s\n", "logMsg() call-site cost", "ns/call");
+    logMsg("%-33s %9.0f\n", "write-through (fputs + fflush)", nsPerCall[0]);
+    logMsg("%-33s %9.0f\n", "ring buffer + writer thread", nsPerCall[1]);
+}
+
+/* Route stdout to the console we were started from, if any (we're a GUI app) */
+static void attachParentConsole(void) {
+    if (AttachConsole(ATTACH_PARENT_PROCESS)) {
+        freopen("CONOUT$", "w", stdout);
+    }
+}
+
+/* --benchmark: per-call cost of logging. Nothing is killed, restarted or
+ * launched. */
+static int runBenchmark(const char* exePath) {
+    attachParentConsole();
+    initLog(exePath);
+    logMsg("===== Elgato Reset benchmark =====\n");
+    benchmarkLogger();
+    logClose();
+    return 0;
+}
+
+/* ========== Reset Coordinator ========== */
+/* Serializes reset work. Requests from the tray, the control pipe and the
+ * command line all become jobs that run one at a time on the main thread,
+ * folded by the rules of JobQueue (reset_core.h). The named run mutex
+ * extends the one-at-a-time rule to other processes; a job only counts as
+ * served by another process's run if the status block shows that run was at
+ * least as big. */
+typedef struct ResetCoordinator {
+    CRITICAL_SECTION lock;
+    CONDITION_VARIABLE finished;
+    HANDLE hWork;           /* Auto-reset, set when a job is queued */
+    HANDLE hRunMutex;       /* Held by whichever process is running a job */
+    JobQueue queue;
+    int healing;            /* The watchdog is re-applying defaults; jobs wait for it */
+    int lastJob;
+    DWORD lastMs;
+} ResetCoordinator;
+
+static ResetCoordinator g_coord = {0};
+static const char* g_jobNames[] = { "none", "apply-defaults", "escalate", "reset" };
+
+/* What a plain trigger (hotkey launch, tray Run) asks for */
+static int defaultResetJob(void) {
+    return g_tieredReset ? JOB_ESCALATE : JOB_RESET;
+}
+
+static void coordinatorInit(void) {
+    InitializeCriticalSection(&g_coord.lock);
+    InitializeConditionVariable(&g_coord.finished);
+    g_coord.hWork = CreateEventA(NULL, FALSE, FALSE, NULL);
+    g_coord.hRunMutex = CreateMutexA(NULL, FALSE, "Local\\ElgatoAudioReset.Run");
+}
+
+/* Queue a job or fold it into one already running or queued. Returns the
+ * completed-job count at which the request has been served. */
+static LONG coordinatorSubmit(int job) {
+    EnterCriticalSection(&g_coord.lock);
+    LONG target = jobQueueSubmit(&g_coord.queue, job);
+    if (g_coord.queue.pending) SetEvent(g_coord.hWork);
+    LeaveCriticalSection(&g_coord.lock);
+    return target;
+}
+
+/* Block until the request from coordinatorSubmit() has been served */
+static void coordinatorWait(LONG target, int* job, DWORD* ms) {
+    EnterCriticalSection(&g_coord.lock);
+    while (g_coord.queue.completed < target) {
+        SleepConditionVariableCS(&g_coord.finished, &g_coord.lock, INFINITE);
+    }
+    *job = g_coord.lastJob;
+    *ms = g_coord.lastMs;
+    LeaveCriticalSection(&g_coord.lock);
+}
+
+/* Main thread: take the queued job (JOB_NONE if there isn't one, or while
+ * the watchdog heals - hWork is set again when it is done) */
+static int coordinatorTake(void) {
+    EnterCriticalSection(&g_coord.lock);
+    int job = g_coord.healing ? JOB_NONE : jobQueueTake(&g_coord.queue);
+    LeaveCriticalSection(&g_coord.lock);
+    return job;
+}
+
+static void coordinatorFinish(DWORD ms) {
+    EnterCriticalSection(&g_coord.lock);
+    g_coord.lastJob = jobQueueFinish(&g_coord.queue);
+    g_coord.lastMs = ms;
+    WakeAllConditionVariable(&g_coord.finished);
+    LeaveCriticalSection(&g_coord.lock);
+}
+
+/* ========== Routing Watchdog ========== */
+/* WATCHDOG=1 keeps the configured routing in place between resets in the
+ * resident instance. The thread is blocked on endpoint and default-device
+ * notifications while idle; once they have been quiet for
+ * WATCHDOG_DEBOUNCE_MS it compares each role's Windows default with the
+ * config and re-applies only the drifted ones. A full reset is queued only
+ * when a configured endpoint is gone, and not again until it has been seen
+ * back. It never runs while a reset (in any process) holds the run mutex.
+ * Actions go to logs\Watchdog.log; the `watchdog` pipe command reports how
+ * often it woke and how much CPU its thread has used. */
+typedef struct RoutingWatchdog {
+    HANDLE hThread;
+    HANDLE hStop;
+    HANDLE hChanged;
+    DWORD startTick;
+    volatile LONG wakeups;      /* Notification bursts handled */
+    volatile LONG heals;        /* Roles re-applied */
+    volatile LONG resets;       /* Full resets queued */
+    int escalated;              /* Reset queued for missing endpoints that haven't come back yet */
+} RoutingWatchdog;
+
+static RoutingWatchdog g_watchdog = {0};
+
+static void watchdogLog(const char* fmt, ...) {
+    char path[MAX_PATH];
+    snprintf(path, MAX_PATH, "%s\\logs", g_exeDir);
+    CreateDirectoryA(path, NULL);
+    strncat(path, "\\Watchdog.log", MAX_PATH - strlen(path) - 1);
+    FILE* f = fopen(path, "a");
+    if (!f) return;
     
-    STARTUPINFOA si = {0};
-    PROCESS_INFORMATION pi = {0};
-    si.cb = sizeof(si);
-    si.dwFlags = STARTF_USESHOWWINDOW;
-    si.wShowWindow = SW_SHOWMINIMIZED;
+    SYSTEMTIME st;
+    GetLocalTime(&st);
+    fprintf(f, "%04d-%02d-%02d %02d:%02d:%02d ", st.wYear, st.wMonth, st.wDay, st.wHour, st.wMinute, st.wSecond);
+    va_list args;
+    va_start(args, fmt);
+    vfprintf(f, fmt, args);
+    va_end(args);
+    fclose(f);
+}
+
+/* The heal is over: let the main thread take what was queued meanwhile */
+static void watchdogEndHeal(void) {
+    EnterCriticalSection(&g_coord.lock);
+    g_coord.healing = 0;
+    if (g_coord.queue.pending) SetEvent(g_coord.hWork);
+    LeaveCriticalSection(&g_coord.lock);
+}
+
+/* One look after a quiet period. Returns 1 if a reset was running and the
+ * look should be repeated after another quiet period. Within this process
+ * the healing flag keeps jobs from starting meanwhile; the run mutex is only
+ * taken to stay out of other processes' resets, and is released before a
+ * reset is queued so the main thread can take it for that job. */
+static int watchdogCheck(void) {
+    EnterCriticalSection(&g_coord.lock);
+    int busy = g_coord.queue.running || g_coord.queue.pending;
+    if (!busy) g_coord.healing = 1;
+    LeaveCriticalSection(&g_coord.lock);
+    if (busy) return 1;
+    if (g_coord.hRunMutex && WaitForSingleObject(g_coord.hRunMutex, 0) == WAIT_TIMEOUT) {
+        watchdogEndHeal();
+        return 1;
+    }
     
-    char cmdLine[MAX_PATH + 32];
-    strcpy(cmdLine, path);
+    struct {
+        const WCHAR* name;
+        const WCHAR* id;
+        EDataFlow dataFlow;
+        ERole role;
+        const char* label;
+    } roles[] = {
+        { g_playbackDefault, g_playbackDefaultId, eRender,  eConsole,        "Playback default" },
+        { g_playbackComm,    g_playbackCommId,    eRender,  eCommunications, "Playback comms" },
+        { g_recordDefault,   g_recordDefaultId,   eCapture, eConsole,        "Recording default" },
+        { g_recordComm,      g_recordCommId,      eCapture, eCommunications, "Recording comms" },
+    };
     
-    if (CreateProcessA(NULL, cmdLine, NULL, NULL, FALSE, 0, NULL, NULL, &si, &pi)) {
-        CloseHandle(pi.hThread);
-        CloseHandle(pi.hProcess);
+    EndpointSnapshot snap;
+    WCHAR current[4][256];
+    WCHAR currentIds[4][MAX_ENDPOINT_ID];
+    int queueReset = 0;
+    if (audioEnumerate(&snap, DEVICE_STATE_ACTIVE)) {
+        const EndpointEntry* wanted[4] = {0};
+        int missing = 0;
+        for (int i = 0; i < 4; i++) {
+            if (!roles[i].name[0]) continue;
+            wanted[i] = endpointSnapshotFindId(&snap, roles[i].id);
+            if (!wanted[i]) wanted[i] = endpointSnapshotFind(&snap, roles[i].name, roles[i].dataFlow);
+            if (!wanted[i]) missing++;
+        }
         
-        /* Wait for process to appear */
-        logMsg("[i] Waiting for %s", friendlyName);
-        for (int i = 0; i < 10; i++) {
-            Sleep(2000);
-            if (isProcessRunning(exeName)) {
-                logMsg("\n[+] %s detected.\n", friendlyName);
-                return;
+        if (missing) {
+            if (!g_watchdog.escalated) {
+                g_watchdog.escalated = 1;
+                InterlockedIncrement(&g_watchdog.resets);
+                watchdogLog("%d configured device(s) gone - queuing a full reset\n", missing);
+                queueReset = 1;
+            }
+        } else if (audioGetDefaults(current, currentIds)) {
+            g_watchdog.escalated = 0;
+            for (int i = 0; i < 4; i++) {
+                if (!wanted[i] || wcscmp(currentIds[i], wanted[i]->id) == 0) continue;
+                int healed = audioSetDefault(wanted[i]->id, roles[i].role);
+                InterlockedIncrement(&g_watchdog.heals);
+                watchdogLog("%s had drifted to %ls - %s %ls\n", roles[i].label,
+                            current[i][0] ? current[i] : L"(none)", healed ? "restored" : "FAILED to restore",
+                            roles[i].name);
             }
-            logMsg(".");
-            fflush(stdout);
         }
-        logMsg("\n[!] %s may not have started properly.\n", friendlyName);
-    } else {
-        logMsg("[!] Failed to start %s (Error %lu)\n", friendlyName, GetLastError());
+        endpointSnapshotFree(&snap);
     }
+    
+    if (g_coord.hRunMutex) ReleaseMutex(g_coord.hRunMutex);
+    watchdogEndHeal();
+    if (queueReset) coordinatorSubmit(JOB_RESET);
+    return 0;
 }
 
-static void waitForElgatoDevices(void) {
-    logMsg("[i] Waiting for Elgato virtual devices");
-    
-    HRESULT hr = CoInitializeEx(NULL, COINIT_MULTITHREADED);
-    if (FAILED(hr) && hr != RPC_E_CHANGED_MODE) {
-        logMsg("\n[!] COM initialization failed.\n");
+static DWORD WINAPI watchdogThread(LPVOID param) {
+    HANDLE waits[2];
+    (void)param;
+    waits[0] = g_watchdog.hStop;
+    waits[1] = g_watchdog.hChanged;
+    
+    /* Idle here until something changes */
+    while (WaitForMultipleObjects(2, waits, FALSE, INFINITE) == WAIT_OBJECT_0 + 1) {
+        InterlockedIncrement(&g_watchdog.wakeups);
+        int again;
+        do {
+            /* Every further notification restarts the quiet window */
+            DWORD r;
+            while ((r = WaitForMultipleObjects(2, waits, FALSE, (DWORD)g_watchdogDebounceMs)) == WAIT_OBJECT_0 + 1) {}
+            if (r == WAIT_OBJECT_0) return 0;
+            again = watchdogCheck();
+        } while (again);
+    }
+    return 0;
+}
+
+static void watchdogStart(void) {
+    g_watchdog.hStop = CreateEventA(NULL, TRUE, FALSE, NULL);
+    g_watchdog.hChanged = CreateEventA(NULL, FALSE, FALSE, NULL);
+    if (!g_watchdog.hStop || !g_watchdog.hChanged ||
+        !audioSubscribe(g_watchdog.hChanged, AUDIO_EVENT_ENDPOINTS | AUDIO_EVENT_DEFAULTS)) {
+        watchdogLog("Could not subscribe to audio notifications - watchdog off\n");
         return;
     }
-    
-    for (int elapsed = 0; elapsed < MAX_DEVICE_WAIT; elapsed += POLL_INTERVAL) {
-        IMMDeviceEnumerator* pEnum = NULL;
-        hr = CoCreateInstance(&MY_CLSID_MMDeviceEnumerator, NULL, CLSCTX_ALL,
-                              &MY_IID_IMMDeviceEnumerator, (void**)&pEnum);
-        if (SUCCEEDED(hr)) {
-            IMMDeviceCollection* pCol = NULL;
-            hr = IMMDeviceEnumerator_EnumAudioEndpoints(pEnum, eRender, DEVICE_STATE_ACTIVE, &pCol);
-            if (SUCCEEDED(hr)) {
-                UINT count = 0;
-                IMMDeviceCollection_GetCount(pCol, &count);
-                
-                int elgatoCount = 0;
-                for (UINT i = 0; i < count; i++) {
-                    IMMDevice* pDev = NULL;
-                    if (SUCCEEDED(IMMDeviceCollection_Item(pCol, i, &pDev))) {
-                        IPropertyStore* pStore = NULL;
-                        if (SUCCEEDED(IMMDevice_OpenPropertyStore(pDev, STGM_READ, &pStore))) {
-                            PROPVARIANT pv;
-                            PropVariantInit(&pv);
-                            if (SUCCEEDED(IPropertyStore_GetValue(pStore, &PKEY_Device_FriendlyName, &pv)) && pv.pwszVal) {
-                                if (wcsstr(pv.pwszVal, L"Elgato")) {
-                                    elgatoCount++;
-                                }
-                                PropVariantClear(&pv);
-                            }
-                            IPropertyStore_Release(pStore);
-                        }
-                        IMMDevice_Release(pDev);
-                    }
-                }
-                IMMDeviceCollection_Release(pCol);
-                
-                if (elgatoCount >= 2) {
-                    logMsg("\n[+] Elgato virtual devices ready (%d sec).\n", elapsed);
-                    IMMDeviceEnumerator_Release(pEnum);
-                    CoUninitialize();
-                    return;
-                }
-            }
-            IMMDeviceEnumerator_Release(pEnum);
-        }
-        
-        logMsg(".");
-        fflush(stdout);
-        Sleep(POLL_INTERVAL * 1000);
+    g_watchdog.startTick = GetTickCount();
+    g_watchdog.hThread = CreateThread(NULL, 0, watchdogThread, NULL, 0, NULL);
+    if (!g_watchdog.hThread) {
+        audioUnsubscribe(g_watchdog.hChanged);
+        return;
     }
-    
-    logMsg("\n[!] Elgato devices not detected - proceeding anyway.\n");
-    CoUninitialize();
+    SetEvent(g_watchdog.hChanged);  /* First look at startup */
+    watchdogLog("Started (debounce %d ms)\n", g_watchdogDebounceMs);
 }
 
-/* ========== Audio Default Setting ========== */
-static IMMDevice* findDeviceByName(IMMDeviceEnumerator* pEnum, const WCHAR* name, EDataFlow dataFlow) {
-    IMMDeviceCollection* pCol = NULL;
-    if (FAILED(IMMDeviceEnumerator_EnumAudioEndpoints(pEnum, dataFlow, DEVICE_STATE_ACTIVE, &pCol))) return NULL;
-    
-    UINT count = 0;
-    IMMDeviceCollection_GetCount(pCol, &count);
-    
-    IMMDevice* result = NULL;
-    for (UINT i = 0; i < count && !result; i++) {
-        IMMDevice* pDev = NULL;
-        if (SUCCEEDED(IMMDeviceCollection_Item(pCol, i, &pDev))) {
-            IPropertyStore* pStore = NULL;
-            if (SUCCEEDED(IMMDevice_OpenPropertyStore(pDev, STGM_READ, &pStore))) {
-                PROPVARIANT pv;
-                PropVariantInit(&pv);
-                if (SUCCEEDED(IPropertyStore_GetValue(pStore, &PKEY_Device_FriendlyName, &pv)) && pv.pwszVal) {
-                    if (_wcsicmp(pv.pwszVal, name) == 0) {
-                        result = pDev;
-                        pDev = NULL; /* Don't release, we're returning it */
-                    }
-                    PropVariantClear(&pv);
-                }
-                IPropertyStore_Release(pStore);
-            }
-            if (pDev) IMMDevice_Release(pDev);
-        }
+/* "wakeups=<n> heals=<n> resets=<n> cpu=<ms>ms uptime=<sec>s" */
+static void watchdogStats(char* out, size_t len) {
+    FILETIME created, exited, kernel, user;
+    double cpuMs = 0;
+    if (GetThreadTimes(g_watchdog.hThread, &created, &exited, &kernel, &user)) {
+        ULARGE_INTEGER k, u;
+        k.LowPart = kernel.dwLowDateTime;
+        k.HighPart = kernel.dwHighDateTime;
+        u.LowPart = user.dwLowDateTime;
+        u.HighPart = user.dwHighDateTime;
+        cpuMs = (double)(k.QuadPart + u.QuadPart) / 10000.0;
     }
-    IMMDeviceCollection_Release(pCol);
-    return result;
+    snprintf(out, len, "wakeups=%ld heals=%ld resets=%ld cpu=%.1fms uptime=%lus", g_watchdog.wakeups,
+             g_watchdog.heals, g_watchdog.resets, cpuMs, (GetTickCount() - g_watchdog.startTick) / 1000);
 }
 
-static int setDefaultDevice(IMMDeviceEnumerator* pEnum, IPolicyConfig* pPolicy, 
-                            const WCHAR* name, EDataFlow dataFlow, ERole role) {
-    IMMDevice* pDev = findDeviceByName(pEnum, name, dataFlow);
-    if (!pDev) return 0;
-    
-    LPWSTR devId = NULL;
-    IMMDevice_GetId(pDev, &devId);
-    
-    int ok = 0;
-    if (devId) {
-        ok = SUCCEEDED(pPolicy->lpVtbl->SetDefaultEndpoint(pPolicy, devId, role));
-        CoTaskMemFree(devId);
+static void watchdogStop(void) {
+    if (!g_watchdog.hThread) return;
+    SetEvent(g_watchdog.hStop);
+    WaitForSingleObject(g_watchdog.hThread, 5000);
+    audioUnsubscribe(g_watchdog.hChanged);
+    
+    char stats[128];
+    watchdogStats(stats, sizeof(stats));
+    watchdogLog("Stopped: %s\n", stats);
+    CloseHandle(g_watchdog.hThread);
+    g_watchdog.hThread = NULL;
+}
+
+/* ========== Control Pipe ========== */
+/* \\.\pipe\ElgatoAudioReset takes one-line commands and answers with one line
+ * once the work is done:
+ *   reset           -> OK reset <sec>
+ *   apply-defaults  -> OK apply-defaults <sec>  (or OK reset <sec> if a reset covered it)
+ *   escalate        -> OK escalate <sec>        (tiered reset, see Escalation)
+ *   status          -> OK idle [last=<job>:<sec>] | OK queued <job> | OK running <job>: <tray status>
+ *   watchdog        -> OK watchdog wakeups=<n> heals=<n> resets=<n> cpu=<ms>ms uptime=<sec>s | OK watchdog off
+ *   probe           -> OK probe <code> <json> (read-only health check, answered right away)
+ * Whoever creates the pipe first owns it; other launches hand their reset to
+ * the owner instead of starting a second pipeline. */
+#define CONTROL_PIPE_NAME "\\\\.\\pipe\\ElgatoAudioReset"
+#define CONTROL_MSG_MAX   256
+
+static void handleControlCommand(const char* cmd, char* reply, size_t len) {
+    int job = JOB_NONE;
+    if (strcmp(cmd, "reset") == 0) {
+        job = JOB_RESET;
+    } else if (strcmp(cmd, "apply-defaults") == 0) {
+        job = JOB_DEFAULTS;
+    } else if (strcmp(cmd, "escalate") == 0) {
+        job = JOB_ESCALATE;
+    } else if (strcmp(cmd, "status") == 0) {
+        EnterCriticalSection(&g_coord.lock);
+        if (g_coord.queue.running) {
+            snprintf(reply, len, "OK running %s: %ls", g_jobNames[g_coord.queue.running], g_trayStatus);
+        } else if (g_coord.queue.pending) {
+            snprintf(reply, len, "OK queued %s", g_jobNames[g_coord.queue.pending]);
+        } else if (g_coord.queue.completed) {
+            snprintf(reply, len, "OK idle last=%s:%.1f", g_jobNames[g_coord.lastJob], g_coord.lastMs / 1000.0);
+        } else {
+            snprintf(reply, len, "OK idle");
+        }
+        LeaveCriticalSection(&g_coord.lock);
+        return;
+    } else if (strcmp(cmd, "probe") == 0) {
+        HealthReport report;
+        char json[256];
+        healthProbe(&report);
+        healthReportJson(&report, json, sizeof(json));
+        snprintf(reply, len, "OK probe %d %s", report.code, json);
+        return;
+    } else if (strcmp(cmd, "watchdog") == 0) {
+        char stats[128];
+        if (!g_watchdog.hThread) {
+            snprintf(reply, len, "OK watchdog off");
+            return;
+        }
+        watchdogStats(stats, sizeof(stats));
+        snprintf(reply, len, "OK watchdog %s", stats);
+        return;
+    } else {
+        snprintf(reply, len, "ERR unknown command: %s", cmd);
+        return;
     }
     
-    IMMDevice_Release(pDev);
-    return ok;
+    DWORD ms = 0;
+    coordinatorWait(coordinatorSubmit(job), &job, &ms);
+    snprintf(reply, len, "OK %s %.1f", g_jobNames[job], ms / 1000.0);
 }
 
-static int unmuteDevice(IMMDeviceEnumerator* pEnum, const WCHAR* name, EDataFlow dataFlow) {
-    IMMDevice* pDev = findDeviceByName(pEnum, name, dataFlow);
-    if (!pDev) return 0;
-    
-    IAudioEndpointVolume* pVol = NULL;
-    HRESULT hr = IMMDevice_Activate(pDev, &MY_IID_IAudioEndpointVolume, CLSCTX_ALL, NULL, (void**)&pVol);
-    
-    int ok = 0;
-    if (SUCCEEDED(hr) && pVol) {
-        IAudioEndpointVolume_SetMute(pVol, FALSE, NULL);
-        IAudioEndpointVolume_SetMasterVolumeLevelScalar(pVol, 1.0f, NULL);
-        IAudioEndpointVolume_Release(pVol);
-        ok = 1;
+static DWORD WINAPI controlClientThread(LPVOID param) {
+    HANDLE hPipe = (HANDLE)param;
+    char cmd[CONTROL_MSG_MAX];
+    char reply[CONTROL_MSG_MAX];
+    DWORD bytes = 0;
+    
+    if (ReadFile(hPipe, cmd, sizeof(cmd) - 1, &bytes, NULL) && bytes > 0) {
+        /* Shell clients usually send a trailing newline */
+        while (bytes > 0 && (cmd[bytes - 1] == '\n' || cmd[bytes - 1] == '\r' || cmd[bytes - 1] == ' ')) bytes--;
+        cmd[bytes] = '\0';
+        
+        logAt(LOG_DEBUG, "[i] Control pipe: %s\n", cmd);
+        handleControlCommand(cmd, reply, sizeof(reply) - 1);
+        strcat(reply, "\n");
+        WriteFile(hPipe, reply, (DWORD)strlen(reply), &bytes, NULL);
+        FlushFileBuffers(hPipe);
     }
     
-    IMMDevice_Release(pDev);
-    return ok;
+    DisconnectNamedPipe(hPipe);
+    CloseHandle(hPipe);
+    return 0;
 }
 
-/* Get volume of default playback device */
-static float getDefaultPlaybackVolume(void) {
-    float volume = -1.0f;
-    
-    HRESULT hr = CoInitializeEx(NULL, COINIT_MULTITHREADED);
-    if (FAILED(hr) && hr != RPC_E_CHANGED_MODE) return volume;
-    
-    IMMDeviceEnumerator* pEnum = NULL;
-    hr = CoCreateInstance(&MY_CLSID_MMDeviceEnumerator, NULL, CLSCTX_ALL,
-                          &MY_IID_IMMDeviceEnumerator, (void**)&pEnum);
-    if (FAILED(hr)) {
-        CoUninitialize();
-        return volume;
-    }
-    
-    IMMDevice* pDev = NULL;
-    hr = IMMDeviceEnumerator_GetDefaultAudioEndpoint(pEnum, eRender, eConsole, &pDev);
-    if (SUCCEEDED(hr) && pDev) {
-        IAudioEndpointVolume* pVol = NULL;
-        hr = IMMDevice_Activate(pDev, &MY_IID_IAudioEndpointVolume, CLSCTX_ALL, NULL, (void**)&pVol);
-        if (SUCCEEDED(hr) && pVol) {
-            IAudioEndpointVolume_GetMasterVolumeLevelScalar(pVol, &volume);
-            IAudioEndpointVolume_Release(pVol);
-        }
-        IMMDevice_Release(pDev);
-    }
-    
-    IMMDeviceEnumerator_Release(pEnum);
-    CoUninitialize();
-    return volume;
+static HANDLE createControlPipe(int first) {
+    /* The owner runs elevated, but the interactive user's own scripts may send
+     * commands - they can only ask for the fixed actions above */
+    SECURITY_ATTRIBUTES sa = { sizeof(sa), NULL, FALSE };
+    ConvertStringSecurityDescriptorToSecurityDescriptorA("D:(A;;GA;;;SY)(A;;GA;;;BA)(A;;GRGW;;;IU)",
+                                                         SDDL_REVISION_1, &sa.lpSecurityDescriptor, NULL);
+    
+    HANDLE hPipe = CreateNamedPipeA(CONTROL_PIPE_NAME,
+                                    PIPE_ACCESS_DUPLEX | (first ? FILE_FLAG_FIRST_PIPE_INSTANCE : 0),
+                                    PIPE_TYPE_MESSAGE | PIPE_READMODE_MESSAGE | PIPE_WAIT | PIPE_REJECT_REMOTE_CLIENTS,
+                                    PIPE_UNLIMITED_INSTANCES, CONTROL_MSG_MAX, CONTROL_MSG_MAX, 0,
+                                    sa.lpSecurityDescriptor ? &sa : NULL);
+    if (sa.lpSecurityDescriptor) LocalFree(sa.lpSecurityDescriptor);
+    return hPipe;
 }
 
-/* Set volume of default playback device */
-static void setDefaultPlaybackVolume(float volume) {
-    if (volume < 0.0f || volume > 1.0f) return;
-    
-    HRESULT hr = CoInitializeEx(NULL, COINIT_MULTITHREADED);
-    if (FAILED(hr) && hr != RPC_E_CHANGED_MODE) return;
-    
-    IMMDeviceEnumerator* pEnum = NULL;
-    hr = CoCreateInstance(&MY_CLSID_MMDeviceEnumerator, NULL, CLSCTX_ALL,
-                          &MY_IID_IMMDeviceEnumerator, (void**)&pEnum);
-    if (FAILED(hr)) {
-        CoUninitialize();
-        return;
-    }
-    
-    IMMDevice* pDev = NULL;
-    hr = IMMDeviceEnumerator_GetDefaultAudioEndpoint(pEnum, eRender, eConsole, &pDev);
-    if (SUCCEEDED(hr) && pDev) {
-        IAudioEndpointVolume* pVol = NULL;
-        hr = IMMDevice_Activate(pDev, &MY_IID_IAudioEndpointVolume, CLSCTX_ALL, NULL, (void**)&pVol);
-        if (SUCCEEDED(hr) && pVol) {
-            IAudioEndpointVolume_SetMasterVolumeLevelScalar(pVol, volume, NULL);
-            IAudioEndpointVolume_Release(pVol);
+/* Accepts clients one after another; each gets its own thread because a
+ * reset request only gets its answer once the reset is done */
+static DWORD WINAPI controlServerThread(LPVOID param) {
+    HANDLE hPipe = (HANDLE)param;
+    for (;;) {
+        if (ConnectNamedPipe(hPipe, NULL) || GetLastError() == ERROR_PIPE_CONNECTED) {
+            HANDLE hThread = CreateThread(NULL, 0, controlClientThread, hPipe, 0, NULL);
+            if (hThread) {
+                CloseHandle(hThread);
+            } else {
+                DisconnectNamedPipe(hPipe);
+                CloseHandle(hPipe);
+            }
+        } else {
+            CloseHandle(hPipe);
+        }
+        
+        while ((hPipe = createControlPipe(0)) == INVALID_HANDLE_VALUE) {
+            Sleep(1000);
         }
-        IMMDevice_Release(pDev);
     }
-    
-    IMMDeviceEnumerator_Release(pEnum);
-    CoUninitialize();
+    return 0;
 }
 
-/* Save current volume, set to safe level */
-static void saveAndLowerVolume(void) {
-    g_savedPlaybackVolume = getDefaultPlaybackVolume();
-    if (g_savedPlaybackVolume >= 0) {
-        logMsg("[i] Saved volume: %.0f%%, lowering to 20%% for safety\n", g_savedPlaybackVolume * 100);
-        setDefaultPlaybackVolume(0.20f);
+/* Returns 0 if another process already owns the pipe */
+static int startControlServer(void) {
+    HANDLE hPipe = createControlPipe(1);
+    if (hPipe == INVALID_HANDLE_VALUE) return 0;
+    
+    HANDLE hThread = CreateThread(NULL, 0, controlServerThread, hPipe, 0, NULL);
+    if (!hThread) {
+        CloseHandle(hPipe);
+        return 0;
     }
+    CloseHandle(hThread);
+    return 1;
 }
 
-/* Restore previously saved volume */
-static void restoreVolume(void) {
-    if (g_savedPlaybackVolume >= 0) {
-        logMsg("[i] Restoring volume to %.0f%%\n", g_savedPlaybackVolume * 100);
-        setDefaultPlaybackVolume(g_savedPlaybackVolume);
-        g_savedPlaybackVolume = -1.0f;
+/* Send a command to the pipe owner and wait for its answer. Returns 0 if
+ * nobody is listening or the owner went away before answering. */
+static int sendControlCommand(const char* cmd, char* reply, size_t len) {
+    DWORD bytes = 0;
+    if (!CallNamedPipeA(CONTROL_PIPE_NAME, (LPVOID)cmd, (DWORD)strlen(cmd), reply, (DWORD)len - 1,
+                        &bytes, NMPWAIT_WAIT_FOREVER)) {
+        return 0;
     }
+    while (bytes > 0 && (reply[bytes - 1] == '\n' || reply[bytes - 1] == '\r')) bytes--;
+    reply[bytes] = '\0';
+    return 1;
 }
 
-static void setAudioDefaults(void) {
-    logMsg("[i] Setting audio defaults and volumes...\n");
+/* ========== Resident Mode ========== */
+/* One job with its own log file (and trace, if enabled) */
+static void runReset(const char* exePath, int job) {
+    initLog(exePath);
     
-    HRESULT hr = CoInitializeEx(NULL, COINIT_MULTITHREADED);
-    if (FAILED(hr) && hr != RPC_E_CHANGED_MODE) {
-        logMsg("[!] COM initialization failed.\n");
-        return;
-    }
+    SYSTEMTIME st;
+    GetLocalTime(&st);
+    logMsg("===== Elgato Reset %02d/%02d/%04d %02d:%02d:%02d =====\n",
+           st.wDay, st.wMonth, st.wYear, st.wHour, st.wMinute, st.wSecond);
     
-    IMMDeviceEnumerator* pEnum = NULL;
-    hr = CoCreateInstance(&MY_CLSID_MMDeviceEnumerator, NULL, CLSCTX_ALL,
-                          &MY_IID_IMMDeviceEnumerator, (void**)&pEnum);
-    if (FAILED(hr)) {
-        logMsg("[!] Failed to create device enumerator.\n");
-        CoUninitialize();
-        return;
+    /* Run the reset graph */
+    waitBudgetLoad();
+    if (job != JOB_DEFAULTS) waitBudgetLog();
+    statusJobBegin(job);
+    traceInit();
+    DWORD resetStart = GetTickCount();
+    LONGLONG span = traceBegin();
+    const ResetTier* resumed = resumeInterruptedRun();
+    if (resumed == FULL_RESET_TIER && job != JOB_DEFAULTS) {
+        logMsg("[i] The resumed full reset covers this request.\n");
+    } else if (job == JOB_DEFAULTS) {
+        runResetSteps(&g_platform, g_applyDefaultsSteps, 1, 1, 0);
+    } else if (job == JOB_ESCALATE) {
+        runEscalation();
+    } else {
+        runJournaledSteps(FULL_RESET_TIER, 0);
     }
+    traceEnd("reset", g_jobNames[job], NULL, span);
+    statusJobEnd();
+    waitBudgetSave();
     
-    IPolicyConfig* pPolicy = NULL;
-    hr = CoCreateInstance(&CLSID_PolicyConfigClient, NULL, CLSCTX_ALL,
-                          &IID_IPolicyConfig, (void**)&pPolicy);
-    if (FAILED(hr)) {
-        logMsg("[!] Failed to create policy config client.\n");
-        IMMDeviceEnumerator_Release(pEnum);
-        CoUninitialize();
-        return;
-    }
+    /* Done */
+    logMsg("\n[+] %s complete! (%.1f sec)\n", job == JOB_DEFAULTS ? "Apply defaults" : "Reset",
+           (GetTickCount() - resetStart) / 1000.0);
+    traceWrite();
+    logMsg("[i] Log saved to:\n    %s\n", g_logPath);
     
-    /* Set defaults: eRender = 0, eCapture = 1; eConsole = 0, eCommunications = 2 */
-    if (setDefaultDevice(pEnum, pPolicy, g_playbackDefault, eRender, eConsole)) {
-        logMsg("    [+] Playback default: %ls\n", g_playbackDefault);
-    } else {
-        logMsg("    [!] Playback default not found: %ls\n", g_playbackDefault);
+    logClose();
+}
+
+/* Run a job taken from the coordinator. If another process is already
+ * running one, wait for it first; its run serves this request only if the
+ * status block shows it finished a job at least as big (an apply-defaults
+ * doesn't answer a reset request). Otherwise, or if it died, run ours. */
+static void runJob(const char* exePath, int job) {
+    DWORD start = GetTickCount();
+    DWORD wait = g_coord.hRunMutex ? WaitForSingleObject(g_coord.hRunMutex, 0) : WAIT_OBJECT_0;
+    int served = 0;
+    
+    if (wait == WAIT_TIMEOUT) {
+        StatusBlock before;
+        if (!statusLatest(&before)) memset(&before, 0, sizeof(before));
+        logMsg("[i] Another instance is already running a job - waiting for it.\n");
+        if (g_trayHwnd) updateTrayStatus(L"Waiting for other reset...");
+        wait = waitWithMessages(g_coord.hRunMutex, 1);
+        
+        /* WAIT_ABANDONED: it died mid-job, so nothing was served */
+        StatusBlock after;
+        if (wait == WAIT_OBJECT_0 && statusLatest(&after) && after.state == STATUS_DONE &&
+            after.jobsCompleted != before.jobsCompleted && after.job <= JOB_RESET && jobCovers(after.job, job)) {
+            served = 1;
+            logMsg("[i] Its %s covered this request.\n", g_jobNames[after.job]);
+        }
     }
     
-    if (setDefaultDevice(pEnum, pPolicy, g_playbackComm, eRender, eCommunications)) {
-        logMsg("    [+] Playback comms: %ls\n", g_playbackComm);
-    } else {
-        logMsg("    [!] Playback comms not found: %ls\n", g_playbackComm);
+    if (!served) runReset(exePath, job);
+    if (g_coord.hRunMutex) ReleaseMutex(g_coord.hRunMutex);
+    coordinatorFinish(GetTickCount() - start);
+}
+
+/* --resident: stay in the tray between resets. The SCM and service handles
+ * and the install paths are set up once here and revalidated on use (the
+ * audio objects already live on the audio actor), so "Run Reset" goes
+ * straight into the step graph. The control pipe doubles as the
+ * single-instance check. */
+static int runResident(const char* exePath) {
+    coordinatorInit();
+    if (!startControlServer()) {
+        MessageBoxA(NULL, "Elgato Audio Reset is already running.", "Elgato Audio Reset", MB_OK | MB_ICONINFORMATION);
+        return 1;
     }
     
-    if (setDefaultDevice(pEnum, pPolicy, g_recordDefault, eCapture, eConsole)) {
-        logMsg("    [+] Recording default: %ls\n", g_recordDefault);
-    } else {
-        logMsg("    [!] Recording default not found: %ls\n", g_recordDefault);
-    }
+    openCachedService("audiosrv");
+    openCachedService("AudioEndpointBuilder");
+    discoverPaths();
+    if (g_watchdogEnabled) watchdogStart();
     
-    if (setDefaultDevice(pEnum, pPolicy, g_recordComm, eCapture, eCommunications)) {
-        logMsg("    [+] Recording comms: %ls\n", g_recordComm);
-    } else {
-        logMsg("    [!] Recording comms not found: %ls\n", g_recordComm);
-    }
+    /* A reset was cut short last time - finish it now */
+    if (journalLoad()) coordinatorSubmit(defaultResetJob());
     
-    /* Unmute and set volume */
-    unmuteDevice(pEnum, OUTPUT_RAZER_CHAT, eRender);
-    unmuteDevice(pEnum, OUTPUT_RAZER_GAME, eRender);
-    unmuteDevice(pEnum, g_recordDefault, eCapture);
+    initTrayIcon();
+    updateTrayStatus(L"Ready");
     
-    pPolicy->lpVtbl->Release(pPolicy);
-    IMMDeviceEnumerator_Release(pEnum);
-    CoUninitialize();
+    /* Nothing configured yet - start with the settings window */
+    if (!g_configExists) g_trayAction = 1;
     
-    logMsg("[+] Audio defaults configured.\n");
+    for (;;) {
+        int action = g_trayAction;
+        g_trayAction = 0;
+        
+        if (action == 1) {
+            /* Open config - its Reset Audio button runs a reset afterwards */
+            g_shouldRun = 0;
+            showConfigGUI();
+            if (g_shouldRun) coordinatorSubmit(defaultResetJob());
+        } else if (action == 2) {
+            coordinatorSubmit(defaultResetJob());
+        } else if (action == 3) {
+            break;
+        }
+        
+        int job = coordinatorTake();
+        if (job != JOB_NONE) {
+            g_configExists = loadConfig(exePath);  /* Pick up edits made by other instances */
+            runJob(exePath, job);
+            updateTrayStatus(L"Complete!");
+            if (g_showNotification) showTrayBalloon(L"Elgato Audio Reset", L"Elgato Audio Reset Complete");
+            updateTrayStatus(L"Ready");
+            
+            /* Run clicks made during the reset were covered by it */
+            if (g_trayAction == 2) g_trayAction = 0;
+            continue;
+        }
+        if (action) continue;
+        
+        /* Idle until a tray message or a queued job */
+        if (MsgWaitForMultipleObjects(1, &g_coord.hWork, FALSE, INFINITE, QS_ALLINPUT) == WAIT_OBJECT_0 + 1) {
+            MSG msg;
+            int quit = 0;
+            while (PeekMessageW(&msg, NULL, 0, 0, PM_REMOVE)) {
+                if (msg.message == WM_QUIT) quit = 1;
+                TranslateMessage(&msg);
+                DispatchMessageW(&msg);
+            }
+            if (quit) break;
+        }
+    }
+    
+    removeTrayIcon();
+    watchdogStop();
+    closeServiceHandles();
+    audioActorStop();
+    return 0;
 }
 
-/* ========== Check Admin ========== */
-static int isAdmin(void) {
-    BOOL isAdmin = FALSE;
-    PSID adminGroup = NULL;
-    SID_IDENTIFIER_AUTHORITY ntAuth = SECURITY_NT_AUTHORITY;
-    
-    if (AllocateAndInitializeSid(&ntAuth, 2, SECURITY_BUILTIN_DOMAIN_RID,
-                                  DOMAIN_ALIAS_RID_ADMINS, 0, 0, 0, 0, 0, 0, &adminGroup)) {
-        CheckTokenMembership(NULL, adminGroup, &isAdmin);
-        FreeSid(adminGroup);
+/* ========== Probe Mode ========== */
+/* Ask the instance that owns the control pipe (its audio thread is already
+ * warm), else probe in this process. Returns the probe code, or -1 with
+ * json untouched if the pipe answered with an error. */
+static int probeOnce(char* json, size_t len, int* viaPipe) {
+    char reply[CONTROL_MSG_MAX];
+    int code, used = 0;
+    *viaPipe = sendControlCommand("probe", reply, sizeof(reply));
+    if (*viaPipe) {
+        if (sscanf(reply, "OK probe %d %n", &code, &used) != 1 || used == 0) return -1;
+        snprintf(json, len, "%s", reply + used);
+        return code;
     }
-    return isAdmin;
+    
+    HealthReport report;
+    healthProbe(&report);
+    healthReportJson(&report, json, len);
+    return report.code;
 }
 
-static void elevateAndRestart(const char* exePath) {
-    SHELLEXECUTEINFOA sei = {0};
-    sei.cbSize = sizeof(sei);
-    sei.lpVerb = "runas";
-    sei.lpFile = exePath;
-    sei.nShow = SW_SHOWNORMAL;
-    sei.fMask = SEE_MASK_NOCLOSEPROCESS;
-    
-    if (ShellExecuteExA(&sei)) {
-        WaitForSingleObject(sei.hProcess, INFINITE);
-        CloseHandle(sei.hProcess);
+/* --probe: print one JSON line and exit with the probe code */
+static int runProbe(void) {
+    char json[256];
+    int viaPipe;
+    attachParentConsole();
+    int code = probeOnce(json, sizeof(json), &viaPipe);
+    if (code < 0) {
+        printf("{\"ok\":false,\"error\":\"probe failed\"}\n");
+        return 255;
     }
+    printf("%s\n", json);
+    fflush(stdout);
+    return code;
 }
 
-/* ========== System Tray Functions ========== */
-static LRESULT CALLBACK TrayWndProc(HWND hwnd, UINT msg, WPARAM wParam, LPARAM lParam) {
-    if (msg == WM_TRAYICON) {
-        if (lParam == WM_LBUTTONUP) {
-            /* Left click - open config GUI */
-            g_trayAction = 1;
-        } else if (lParam == WM_RBUTTONUP) {
-            /* Right click - show context menu */
-            POINT pt;
-            GetCursorPos(&pt);
-            
-            HMENU hMenu = CreatePopupMenu();
-            AppendMenuW(hMenu, MF_STRING, ID_TRAY_OPEN, L"Open Settings");
-            AppendMenuW(hMenu, MF_STRING, ID_TRAY_RUN, L"Run Reset");
-            AppendMenuW(hMenu, MF_SEPARATOR, 0, NULL);
-            AppendMenuW(hMenu, MF_STRING, ID_TRAY_EXIT, L"Exit");
-            
-            /* Required for menu to work properly */
-            SetForegroundWindow(hwnd);
-            
-            UINT cmd = TrackPopupMenu(hMenu, TPM_RETURNCMD | TPM_RIGHTBUTTON, 
-                                       pt.x, pt.y, 0, hwnd, NULL);
-            DestroyMenu(hMenu);
-            
-            if (cmd == ID_TRAY_OPEN) {
-                g_trayAction = 1;  /* Open config */
-            } else if (cmd == ID_TRAY_RUN) {
-                g_trayAction = 2;  /* Run reset */
-            } else if (cmd == ID_TRAY_EXIT) {
-                g_trayAction = 3;  /* Exit */
-            }
+static void printJsonString(const char* s) {
+    putchar('"');
+    for (; *s; s++) {
+        unsigned char c = (unsigned char)*s;
+        if (c == '"' || c == '\\') {
+            printf("\\%c", c);
+        } else if (c < 0x20) {
+            printf("\\u%04x", c);
+        } else {
+            putchar(c);
         }
-        return 0;
     }
-    return DefWindowProcW(hwnd, msg, wParam, lParam);
+    putchar('"');
 }
 
-static void initTrayIcon(void) {
-    /* Create hidden window for tray messages */
-    WNDCLASSW wc = {0};
-    wc.lpfnWndProc = TrayWndProc;
-    wc.hInstance = GetModuleHandle(NULL);
-    wc.lpszClassName = L"ElgatoResetTray";
-    RegisterClassW(&wc);
-    
-    g_trayHwnd = CreateWindowW(L"ElgatoResetTray", L"", 0, 0, 0, 0, 0, 
-                                HWND_MESSAGE, NULL, wc.hInstance, NULL);
-    
-    /* Set up notification icon */
-    g_nid.cbSize = sizeof(NOTIFYICONDATAW);
-    g_nid.hWnd = g_trayHwnd;
-    g_nid.uID = ID_TRAY_ICON;
-    g_nid.uFlags = NIF_ICON | NIF_TIP | NIF_MESSAGE;
-    g_nid.uCallbackMessage = WM_TRAYICON;
-    g_nid.hIcon = LoadIcon(NULL, IDI_APPLICATION);
-    wcscpy(g_nid.szTip, L"Elgato Audio Reset - Starting...");
+/* --status: one JSON line from the shared status block, read the way any
+ * external reader would (mapped read-only, seqlock). Exit code 1 if no
+ * process has published one. */
+static int runStatus(void) {
+    attachParentConsole();
+    HANDLE hMapping = OpenFileMappingA(FILE_MAP_READ, FALSE, STATUS_BLOCK_NAME);
+    const StatusBlock* shared = hMapping
+        ? (const StatusBlock*)MapViewOfFile(hMapping, FILE_MAP_READ, 0, 0, sizeof(StatusBlock)) : NULL;
+    StatusBlock b;
+    int ok = shared && shared->magic == STATUS_BLOCK_MAGIC && shared->version == STATUS_BLOCK_VERSION &&
+             shared->size >= sizeof(StatusBlock) && statusRead(shared, &b);
+    if (shared) UnmapViewOfFile(shared);
+    if (hMapping) CloseHandle(hMapping);
+    if (!ok) {
+        printf("{\"state\":\"unavailable\"}\n");
+        return 1;
+    }
     
-    Shell_NotifyIconW(NIM_ADD, &g_nid);
-}
-
-static void updateTrayStatus(const wchar_t* status) {
-    g_trayStatus = status;
-    swprintf(g_nid.szTip, 64, L"Elgato Reset - %s", status);
-    Shell_NotifyIconW(NIM_MODIFY, &g_nid);
-}
-
-static void removeTrayIcon(void) {
-    Shell_NotifyIconW(NIM_DELETE, &g_nid);
-    if (g_trayHwnd) {
-        DestroyWindow(g_trayHwnd);
-        g_trayHwnd = NULL;
+    static const char* const states[] = { "idle", "running", "done" };
+    ULONGLONG end = b.jobFinished ? b.jobFinished : statusNow();
+    printf("{\"state\":\"%s\",\"job\":\"%s\",\"pid\":%lu,\"jobs\":%ld,\"ms\":%.0f,\"status\":",
+           states[b.state >= 0 && b.state <= STATUS_DONE ? b.state : 0], g_jobNames[b.job >= 0 && b.job <= 3 ? b.job : 0],
+           b.pid, b.jobsCompleted, b.jobStarted ? (end - b.jobStarted) / 10000.0 : 0.0);
+    printJsonString(b.status);
+    printf(",\"step\":");
+    if (b.currentStep >= 0 && b.currentStep < b.stepCount) {
+        b.steps[b.currentStep].name[STATUS_STEP_NAME - 1] = '\0';
+        printJsonString(b.steps[b.currentStep].name);
+    } else {
+        printf("null");
+    }
+    printf(",\"steps\":[");
+    for (int i = 0; i < b.stepCount && i < STATUS_MAX_STEPS; i++) {
+        const StatusStep* st = &b.steps[i];
+        b.steps[i].name[STATUS_STEP_NAME - 1] = '\0';
+        printf("%s{\"name\":", i ? "," : "");
+        printJsonString(st->name);
+        if (!st->started) {
+            printf(",\"state\":\"pending\"}");
+        } else if (!st->finished) {
+            printf(",\"state\":\"running\",\"ms\":%.0f}", (statusNow() - st->started) / 10000.0);
+        } else {
+            printf(",\"state\":\"done\",\"ms\":%.0f}", (st->finished - st->started) / 10000.0);
+        }
+    }
+    printf("],\"lastError\":");
+    if (b.lastErrorLevel) {
+        b.lastError[STATUS_ERROR_LEN - 1] = '\0';
+        printJsonString(b.lastError);
+    } else {
+        printf("null");
     }
+    printf("}\n");
+    fflush(stdout);
+    return 0;
 }
 
-/* Sleep while pumping messages (for tray icon responsiveness) */
-static void sleepWithMessages(DWORD ms) {
-    DWORD start = GetTickCount();
-    while (GetTickCount() - start < ms) {
-        MSG msg;
-        while (PeekMessageW(&msg, NULL, 0, 0, PM_REMOVE)) {
-            TranslateMessage(&msg);
-            DispatchMessageW(&msg);
+/* --probe-benchmark [runs]: probe latency in this process (first call
+ * separately - it includes the audio thread starting up) and, when another
+ * instance owns the control pipe, the full round trip through it */
+static int runProbeBenchmark(const char* exePath, int runs) {
+    if (runs <= 0) runs = 200;
+    
+    attachParentConsole();
+    initLog(exePath);
+    logMsg("===== Elgato Reset probe benchmark: %d probes per path =====\n", runs);
+    
+    double* ms = (double*)malloc(runs * sizeof(double));
+    if (!ms) return 1;
+    
+    LARGE_INTEGER freq;
+    QueryPerformanceFrequency(&freq);
+    logMsg("%-16s %9s %9s %9s %9s\n", "path", "first", "p50 (ms)", "p95 (ms)", "max (ms)");
+    
+    for (int path = 0; path < 2; path++) {
+        char reply[CONTROL_MSG_MAX];
+        if (path == 1 && !sendControlCommand("probe", reply, sizeof(reply))) {
+            logMsg("%-16s (no instance owns the control pipe)\n", "pipe");
+            break;
         }
-        Sleep(50);  /* Small sleep between message checks */
+        double first = 0;
+        for (int run = 0; run <= runs; run++) {
+            LARGE_INTEGER t0, t1;
+            QueryPerformanceCounter(&t0);
+            if (path == 0) {
+                HealthReport report;
+                healthProbe(&report);
+            } else {
+                sendControlCommand("probe", reply, sizeof(reply));
+            }
+            QueryPerformanceCounter(&t1);
+            double took = (t1.QuadPart - t0.QuadPart) * 1000.0 / freq.QuadPart;
+            if (run == 0) {
+                first = took;
+            } else {
+                ms[run - 1] = took;
+            }
+        }
+        qsort(ms, runs, sizeof(double), compareDoubles);
+        logMsg("%-16s %9.1f %9.1f %9.1f %9.1f\n", path == 0 ? "in-process" : "pipe", first,
+               ms[runs * 50 / 100], ms[runs * 95 / 100], ms[runs - 1]);
     }
+    
+    free(ms);
+    logClose();
+    return 0;
 }
 
 /* ========== Main ========== */
@@ -1835,6 +5980,11 @@ int main(int argc, char* argv[]) {
     char exePath[MAX_PATH];
     GetModuleFileNameA(NULL, exePath, MAX_PATH);
     
+    /* Logger benchmark - doesn't touch the real audio setup */
+    if (argc > 1 && strcmp(argv[1], "--benchmark") == 0) {
+        return runBenchmark(exePath);
+    }
+    
     /* Check for install dir environment variable (set by PowerShell installer) */
     char* envInstallDir = getenv("ELGATO_INSTALL_DIR");
     if (envInstallDir && envInstallDir[0]) {
@@ -1843,7 +5993,32 @@ int main(int argc, char* argv[]) {
     
     /* Load config file - track if it exists for Run button state */
     g_configExists = loadConfig(exePath);
-    if (!g_configExists || !g_runInBackground) {
+    
+    /* Creates the audio objects in the background while the GUI comes up */
+    audioActorStart();
+    processTableInit();     /* Before the pipe thread can probe */
+    
+    /* Read-only health check for status indicators */
+    if (argc > 1 && strcmp(argv[1], "--probe") == 0) {
+        return runProbe();
+    }
+    if (argc > 1 && strcmp(argv[1], "--probe-benchmark") == 0) {
+        return runProbeBenchmark(exePath, argc > 2 ? atoi(argv[2]) : 200);
+    }
+    if (argc > 1 && strcmp(argv[1], "--status") == 0) {
+        return runStatus();
+    }
+    
+    /* Resident tray mode - stays running and resets on request */
+    if (argc > 1 && strcmp(argv[1], "--resident") == 0) {
+        return runResident(exePath);
+    }
+    
+    /* Finish an interrupted reset first; the settings window can wait */
+    int resume = journalLoad();
+    
+    int showTray = g_configExists && g_runInBackground;
+    if (!showTray && !resume) {
         /* First run, config deleted, or user wants to see GUI */
         showConfigGUI();
         
@@ -1851,79 +6026,28 @@ int main(int argc, char* argv[]) {
         if (!g_shouldRun) {
             return 0;
         }
-    } else {
-        /* Running in background - show system tray icon */
-        initTrayIcon();
     }
     
-    /* Initialize log */
-    initLog(exePath);
-    
-    SYSTEMTIME st;
-    GetLocalTime(&st);
-    logMsg("===== Elgato Reset %02d/%02d/%04d %02d:%02d:%02d =====\n",
-           st.wDay, st.wMonth, st.wYear, st.wHour, st.wMinute, st.wSecond);
-    
-    /* Discover paths */
-    discoverPaths();
-    
-    /* Save current volume and lower to safe level before reset */
-    saveAndLowerVolume();
-    
-    /* Step 1: Kill Elgato processes */
-    if (g_trayHwnd) updateTrayStatus(L"Stopping processes...");
-    killElgatoProcesses();
-    
-    /* Step 2: Restart audio services */
-    if (g_trayHwnd) updateTrayStatus(L"Restarting audio...");
-    restartAudioServices();
-    
-    /* Step 3: Launch WaveLink */
-    if (g_trayHwnd) updateTrayStatus(L"Starting WaveLink...");
-    if (g_waveLinkSEPath[0] && GetFileAttributesA(g_waveLinkSEPath) != INVALID_FILE_ATTRIBUTES) {
-        launchApp(g_waveLinkSEPath, "WaveLinkSE.exe", "WaveLinkSE");
-    }
-    if (g_waveLinkPath[0]) {
-        launchApp(g_waveLinkPath, "WaveLink.exe", "WaveLink");
+    /* A resident instance or a reset already in progress owns the control
+     * pipe - hand the reset to it so it's coalesced with whatever is running */
+    char reply[CONTROL_MSG_MAX];
+    if (sendControlCommand(g_jobNames[defaultResetJob()], reply, sizeof(reply))) {
+        return strncmp(reply, "OK", 2) == 0 ? 0 : 1;
     }
     
-    /* Step 4: Wait for Elgato devices */
-    if (g_trayHwnd) updateTrayStatus(L"Waiting for devices...");
-    waitForElgatoDevices();
-    
-    /* Step 5: Launch StreamDeck */
-    if (g_streamDeckPath[0]) {
-        if (g_trayHwnd) updateTrayStatus(L"Starting StreamDeck...");
-        launchApp(g_streamDeckPath, "StreamDeck.exe", "StreamDeck");
-        logMsg("[i] Waiting for StreamDeck to fully initialize...\n");
-        
-        /* Wait for StreamDeck window to appear (up to 30 seconds) */
-        for (int i = 0; i < 30; i++) {
-            if (g_trayHwnd) sleepWithMessages(1000); else Sleep(1000);
-            HWND hwnd = FindWindowA(NULL, "Stream Deck");
-            if (hwnd) {
-                if (g_trayHwnd) sleepWithMessages(2000); else Sleep(2000);
-                break;
-            }
-        }
-        
-        minimizeProcessWindows("StreamDeck.exe");
-        logMsg("[i] StreamDeck minimized.\n");
+    if (showTray) {
+        /* Running in background - show system tray icon */
+        initTrayIcon();
     }
     
-    /* Step 6: Set audio defaults */
-    if (g_trayHwnd) updateTrayStatus(L"Setting audio defaults...");
-    if (g_trayHwnd) sleepWithMessages(2000); else Sleep(2000);
-    setAudioDefaults();
-    
-    /* Restore original volume */
-    restoreVolume();
-    
-    /* Done */
-    logMsg("\n[+] Reset complete!\n");
-    logMsg("[i] Log saved to:\n    %s\n", g_logPath);
-    
-    if (g_logFile) fclose(g_logFile);
+    /* Own the pipe while we run, so a second hotkey press joins this reset */
+    coordinatorInit();
+    startControlServer();
+    coordinatorSubmit(defaultResetJob());
+    int job;
+    while ((job = coordinatorTake()) != JOB_NONE) {
+        runJob(exePath, job);
+    }
     
     /* Remove tray icon if shown */
     if (g_trayHwnd) {
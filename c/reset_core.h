@@ -0,0 +1,779 @@
+/*
+ * reset_core.h - Platform-independent parts of the Elgato Audio Reset Tool
+ *
+ * The logic in here has no Win32 dependency beyond a handful of types and
+ * interlocked operations, so it is compiled into elgato_audio_reset.c and
+ * also into the tests under tests/, which build and run on Linux. Anything
+ * that needs the OS (events, clocks, COM) reaches this code through the
+ * small interfaces declared below.
+ */
+#ifndef RESET_CORE_H
+#define RESET_CORE_H
+
+#ifndef _WIN32
+/* Outside Windows: just the types and primitives the code below uses, with
+ * the same sizes they have on Windows */
+#include <stdint.h>
+#include <wchar.h>
+#include <sched.h>
+typedef uint32_t DWORD;
+typedef int32_t LONG;
+typedef uint16_t WORD;
+typedef uint64_t ULONGLONG;
+typedef wchar_t WCHAR;
+#define InterlockedIncrement(p)     __atomic_add_fetch((p), 1, __ATOMIC_SEQ_CST)
+#define InterlockedExchange(p, v)   __atomic_exchange_n((p), (v), __ATOMIC_SEQ_CST)
+#define MemoryBarrier()             __atomic_thread_fence(__ATOMIC_SEQ_CST)
+#define YieldProcessor()            ((void)0)     /* Only a pause hint on Windows */
+#define SwitchToThread()            sched_yield()
+#endif
+
+#include <stddef.h>
+#include <stdio.h>
+#include <string.h>
+
+/* static_assert where the compiler has C11's, else a negative-size array */
+#if defined(__STDC_VERSION__) && __STDC_VERSION__ >= 201112L
+#define CORE_STATIC_ASSERT(cond, name)  _Static_assert(cond, #name)
+#else
+#define CORE_STATIC_ASSERT(cond, name)  typedef char core_static_assert_##name[(cond) ? 1 : -1]
+#endif
+
+/* ========== Wait Budgets ========== */
+/* How long one wait may take and how a wait that has to poll should pace
+ * itself (see Wait Budgets in elgato_audio_reset.c for where these come from) */
+#define BUDGET_SAMPLES      64
+#define BUDGET_MIN_SAMPLES  5
+#define BUDGET_MARGIN       1.5
+#define BUDGET_SLACK_MS     500
+#define BUDGET_POLL_MIN_MS  25
+
+typedef struct WaitBudget {
+    DWORD timeoutMs;
+    DWORD p50Ms;            /* 0 = no history: poll every pollMs */
+    DWORD pollMs;           /* Coarsest poll interval */
+    int learned;
+} WaitBudget;
+
+/* Size a wait from a phase's history of n durations (ms, sorted in place):
+ * the timeout is the p99 times BUDGET_MARGIN plus BUDGET_SLACK_MS, at least
+ * minMs and at most maxFactor times the default, and p50 shapes the poll
+ * schedule. Fewer than BUDGET_MIN_SAMPLES samples give the default. */
+static inline WaitBudget waitBudgetFromSamples(DWORD* samples, DWORD n, DWORD defaultMs, DWORD minMs,
+                                               int maxFactor, DWORD pollMs) {
+    WaitBudget b = { 0 };
+    b.timeoutMs = defaultMs;
+    b.pollMs = pollMs;
+    if (n < BUDGET_MIN_SAMPLES) return b;
+    
+    /* Insertion sort - there are at most BUDGET_SAMPLES */
+    for (DWORD i = 1; i < n; i++) {
+        DWORD v = samples[i];
+        DWORD j = i;
+        for (; j > 0 && samples[j - 1] > v; j--) samples[j] = samples[j - 1];
+        samples[j] = v;
+    }
+    
+    DWORD p99 = samples[(n - 1) * 99 / 100];
+    double scaled = p99 * BUDGET_MARGIN + BUDGET_SLACK_MS;
+    DWORD cap = defaultMs * (DWORD)maxFactor;
+    DWORD timeout = scaled >= (double)cap ? cap : (DWORD)scaled;
+    if (timeout < minMs) timeout = minMs;
+    if (timeout > cap) timeout = cap;
+    b.timeoutMs = timeout;
+    b.p50Ms = samples[(n - 1) / 2];
+    b.learned = 1;
+    return b;
+}
+
+/* How long a polling wait should sleep before its next check: the elapsed
+ * time again (exponential) until it nears the usual p50, fine-grained
+ * checks within a quarter of p50 either side, then backing off again. */
+static inline DWORD waitBudgetPollMs(const WaitBudget* b, DWORD elapsedMs) {
+    DWORD coarse = b->pollMs;
+    if (!b->p50Ms) return coarse;
+    
+    DWORD fine = b->p50Ms / 20;
+    if (fine < BUDGET_POLL_MIN_MS) fine = BUDGET_POLL_MIN_MS;
+    DWORD windowStart = b->p50Ms - b->p50Ms / 4;
+    DWORD windowEnd = b->p50Ms + b->p50Ms / 4;
+    DWORD next;
+    if (elapsedMs < windowStart) {
+        next = elapsedMs;
+        if (elapsedMs + next > windowStart) next = windowStart - elapsedMs;
+    } else if (elapsedMs < windowEnd) {
+        next = fine;
+    } else {
+        next = (elapsedMs - b->p50Ms) / 2;
+    }
+    if (next < fine) next = fine;
+    if (next > coarse) next = coarse;
+    return next;
+}
+
+/* Tables in here are used by some of the files that include it, not all */
+#if defined(__GNUC__)
+#define CORE_MAYBE_UNUSED   __attribute__((unused))
+#else
+#define CORE_MAYBE_UNUSED
+#endif
+
+/* ========== Reset Platform ========== */
+/* Everything a reset step does to the machine, so that the step graphs
+ * below can drive either Windows (Win32 Platform in elgato_audio_reset.c) or
+ * the simulated machine in tests/sim_platform.h. Each operation is one
+ * action on one part of the system, logging and waiting as the real one
+ * does; the steps decide which to run and in what order. */
+enum { APP_WAVELINK_SE, APP_WAVELINK, APP_STREAMDECK, APP_COUNT };
+enum { STOP_ELGATO, STOP_WAVELINK };            /* Process sets for stopProcesses */
+enum { SERVICES_AUDIO, SERVICES_AUDIOSRV };     /* Service sets for restartServices */
+
+static const char* const g_appNames[APP_COUNT] CORE_MAYBE_UNUSED = { "WaveLinkSE", "WaveLink", "StreamDeck" };
+
+typedef struct Platform Platform;
+struct Platform {
+    /* Clock: milliseconds on a monotonic clock */
+    DWORD (*now)(Platform* self);
+    /* One line for the run's log */
+    void (*log)(Platform* self, const char* line);
+    /* Registry: find the apps' install paths */
+    void (*discoverPaths)(Platform* self);
+    int  (*appInstalled)(Platform* self, int app);
+    /* Processes: stop a STOP_* set, returning how many were found */
+    int  (*stopProcesses)(Platform* self, int set);
+    int  (*isAppRunning)(Platform* self, int app);
+    /* Start the app and wait up to timeoutMs for it to come up (1) */
+    int  (*launchApp)(Platform* self, int app, DWORD timeoutMs);
+    /* Windows */
+    void (*minimizeApp)(Platform* self, int app);
+    /* Services: stop a SERVICES_* set and its dependents, start them back;
+     * 1 if all are running again */
+    int  (*restartServices)(Platform* self, int set);
+    /* Endpoints */
+    void (*lowerVolume)(Platform* self);
+    void (*restoreVolume)(Platform* self);
+    int  (*waitDevices)(Platform* self);        /* 1 once every configured device is active */
+    void (*waitSettle)(Platform* self);
+    int  (*setDefaults)(Platform* self);        /* 1 if every configured role was set */
+    int  (*verify)(Platform* self);             /* 1 if the configured devices are the active defaults */
+    /* 1 while the run continues an interrupted one */
+    int  (*resuming)(Platform* self);
+};
+
+/* ========== Step Graph ========== */
+/* A reset is a small DAG: each step names the steps it depends on, and
+ * whatever is ready runs (see Reset Scheduler in elgato_audio_reset.c for the
+ * worker pool around this). The bookkeeping below is the whole scheduling
+ * policy: which step may start next, and when the graph is done. Callers
+ * serialize access to a StepGraph. */
+#define MAX_RESET_STEPS 32
+#define RESET_WORKERS   4
+#define STEP_BIT(i)     (1u << (i))
+
+typedef struct ResetStep {
+    const char* name;
+    const wchar_t* status;  /* Tray text shown when the step starts (NULL = keep) */
+    void (*run)(Platform* p);
+    unsigned int deps;      /* STEP_BIT() mask of steps that must finish first */
+    int replay;             /* Its state lives in the process - run again when resuming */
+} ResetStep;
+
+typedef struct StepGraph {
+    const ResetStep* steps;
+    int count;
+    unsigned int started;
+    unsigned int done;
+} StepGraph;
+
+/* Mask with a bit for every step of a count-step graph */
+static inline unsigned int stepGraphAll(int count) {
+    return count >= 32 ? 0xFFFFFFFFu : STEP_BIT(count) - 1;
+}
+
+/* Returns 1 if every step can eventually run (no cycles or unknown deps) */
+static inline int schedulerValidate(const ResetStep* steps, int count) {
+    if (count <= 0 || count > MAX_RESET_STEPS) return 0;
+    unsigned int all = stepGraphAll(count);
+    unsigned int done = 0;
+    for (int pass = 0; pass < count; pass++) {
+        for (int i = 0; i < count; i++) {
+            if (!(done & STEP_BIT(i)) && (steps[i].deps & ~all) == 0 && (steps[i].deps & ~done) == 0) {
+                done |= STEP_BIT(i);
+            }
+        }
+    }
+    return done == all;
+}
+
+/* Steps in the skip mask count as already done */
+static inline void stepGraphInit(StepGraph* g, const ResetStep* steps, int count, unsigned int skip) {
+    g->steps = steps;
+    g->count = count;
+    g->started = skip;
+    g->done = skip;
+}
+
+static inline int stepGraphFinished(const StepGraph* g) {
+    return g->done == stepGraphAll(g->count);
+}
+
+/* Claim the first step whose dependencies are all done. Returns its index,
+ * -1 if none is ready yet, or -2 once every step has been started. */
+static inline int stepGraphPick(StepGraph* g) {
+    int pending = 0;
+    for (int i = 0; i < g->count; i++) {
+        if (g->started & STEP_BIT(i)) continue;
+        pending = 1;
+        if ((g->steps[i].deps & ~g->done) == 0) {
+            g->started |= STEP_BIT(i);
+            return i;
+        }
+    }
+    return pending ? -1 : -2;
+}
+
+/* A claimed step has finished. Returns 1 if that completed the graph. */
+static inline int stepGraphFinish(StepGraph* g, int idx) {
+    g->done |= STEP_BIT(idx);
+    return stepGraphFinished(g);
+}
+
+/* ========== Reset Graphs ========== */
+/* The steps of a reset and the graphs they make up: the full reset and the
+ * escalation tiers (TIERED_RESET=1), which try the cheapest fix first and
+ * only go on while the machine still fails verification. */
+#define LAUNCH_TIMEOUT_MS       20000
+#define STREAMDECK_TIMEOUT_MS   30000
+
+static inline void resetLog(Platform* p, const char* fmt, const char* arg) {
+    char line[256];
+    snprintf(line, sizeof(line), fmt, arg);
+    p->log(p, line);
+}
+
+/* A launch step the interrupted run didn't finish may still have got the app
+ * started - don't start a second copy */
+static inline int resumeFindsRunning(Platform* p, int app) {
+    if (!p->resuming(p) || !p->isAppRunning(p, app)) return 0;
+    resetLog(p, "[i] %s is already running.\n", g_appNames[app]);
+    return 1;
+}
+
+static inline void stepDiscoverPaths(Platform* p) {
+    p->discoverPaths(p);
+}
+
+static inline void stepLowerVolume(Platform* p) {
+    p->lowerVolume(p);
+}
+
+static inline void stepKillProcesses(Platform* p) {
+    p->log(p, "[i] Discovering and killing Elgato processes...\n");
+    if (p->stopProcesses(p, STOP_ELGATO) == 0) p->log(p, "    [i] No Elgato processes found to kill.\n");
+}
+
+static inline void stepKillWaveLink(Platform* p) {
+    p->log(p, "[i] Stopping WaveLink...\n");
+    if (p->stopProcesses(p, STOP_WAVELINK) == 0) p->log(p, "    [i] WaveLink wasn't running.\n");
+}
+
+static inline void stepRestartServices(Platform* p) {
+    p->log(p, "[i] Restarting audio services...\n");
+    p->restartServices(p, SERVICES_AUDIO);
+}
+
+/* Restart only audiosrv, leaving the endpoint builder (and endpoints) alone */
+static inline void stepRestartAudioSrv(Platform* p) {
+    p->log(p, "[i] Restarting audiosrv...\n");
+    p->restartServices(p, SERVICES_AUDIOSRV);
+}
+
+static inline void stepLaunchWaveLinkSE(Platform* p) {
+    if (resumeFindsRunning(p, APP_WAVELINK_SE)) return;
+    if (p->appInstalled(p, APP_WAVELINK_SE)) p->launchApp(p, APP_WAVELINK_SE, LAUNCH_TIMEOUT_MS);
+}
+
+static inline void stepLaunchWaveLink(Platform* p) {
+    if (resumeFindsRunning(p, APP_WAVELINK)) return;
+    if (p->appInstalled(p, APP_WAVELINK)) p->launchApp(p, APP_WAVELINK, LAUNCH_TIMEOUT_MS);
+}
+
+/* Minimized the moment its main window shows; the pass afterwards catches
+ * any other window it opened meanwhile */
+static inline void stepLaunchStreamDeck(Platform* p) {
+    if (!p->appInstalled(p, APP_STREAMDECK) || resumeFindsRunning(p, APP_STREAMDECK)) return;
+    p->launchApp(p, APP_STREAMDECK, STREAMDECK_TIMEOUT_MS);
+    p->minimizeApp(p, APP_STREAMDECK);
+    p->log(p, "[i] StreamDeck minimized.\n");
+}
+
+static inline void stepWaitDevices(Platform* p) {
+    p->waitDevices(p);
+}
+
+static inline void stepSetDefaults(Platform* p) {
+    p->waitSettle(p);
+    p->setDefaults(p);
+}
+
+/* Without the settle wait: nothing was restarted */
+static inline void stepApplyDefaults(Platform* p) {
+    p->setDefaults(p);
+}
+
+static inline void stepRestoreVolume(Platform* p) {
+    p->restoreVolume(p);
+}
+
+enum {
+    STEP_DISCOVER_PATHS,
+    STEP_LOWER_VOLUME,
+    STEP_KILL_PROCESSES,
+    STEP_RESTART_SERVICES,
+    STEP_LAUNCH_WAVELINK_SE,
+    STEP_LAUNCH_WAVELINK,
+    STEP_WAIT_DEVICES,
+    STEP_LAUNCH_STREAMDECK,
+    STEP_SET_DEFAULTS,
+    STEP_RESTORE_VOLUME,
+    STEP_COUNT
+};
+
+/* Order must match the enum above */
+static const ResetStep g_resetSteps[STEP_COUNT] CORE_MAYBE_UNUSED = {
+    { "discover-paths",    NULL,                            stepDiscoverPaths,    0, 1 },
+    { "lower-volume",      NULL,                            stepLowerVolume,      0, 1 },
+    { "kill-processes",    L"Stopping processes...",        stepKillProcesses,    0, 0 },
+    { "restart-services",  L"Restarting audio...",          stepRestartServices,
+        STEP_BIT(STEP_KILL_PROCESSES) | STEP_BIT(STEP_LOWER_VOLUME), 0 },
+    { "launch-wavelinkse", L"Starting WaveLink...",         stepLaunchWaveLinkSE,
+        STEP_BIT(STEP_DISCOVER_PATHS) | STEP_BIT(STEP_RESTART_SERVICES), 0 },
+    { "launch-wavelink",   L"Starting WaveLink...",         stepLaunchWaveLink,
+        STEP_BIT(STEP_DISCOVER_PATHS) | STEP_BIT(STEP_RESTART_SERVICES), 0 },
+    { "wait-devices",      L"Waiting for devices...",       stepWaitDevices,
+        STEP_BIT(STEP_RESTART_SERVICES), 0 },
+    { "launch-streamdeck", L"Starting StreamDeck...",       stepLaunchStreamDeck,
+        STEP_BIT(STEP_DISCOVER_PATHS) | STEP_BIT(STEP_RESTART_SERVICES), 0 },
+    { "set-defaults",      L"Setting audio defaults...",    stepSetDefaults,
+        STEP_BIT(STEP_LAUNCH_WAVELINK_SE) | STEP_BIT(STEP_LAUNCH_WAVELINK) |
+        STEP_BIT(STEP_WAIT_DEVICES) | STEP_BIT(STEP_LAUNCH_STREAMDECK), 0 },
+    { "restore-volume",    NULL,                            stepRestoreVolume,
+        STEP_BIT(STEP_SET_DEFAULTS), 0 },
+};
+
+/* Tier 1, and re-applying defaults without a reset (control pipe "apply-defaults") */
+static const ResetStep g_applyDefaultsSteps[] CORE_MAYBE_UNUSED = {
+    { "set-defaults",      L"Setting audio defaults...",    stepApplyDefaults,    0, 0 },
+};
+
+/* Tier 2: restart WaveLink only */
+static const ResetStep g_waveLinkTierSteps[] CORE_MAYBE_UNUSED = {
+    /* 0 */ { "discover-paths",    NULL,                            stepDiscoverPaths,    0, 1 },
+    /* 1 */ { "lower-volume",      NULL,                            stepLowerVolume,      0, 1 },
+    /* 2 */ { "kill-wavelink",     L"Stopping WaveLink...",         stepKillWaveLink,     STEP_BIT(1), 0 },
+    /* 3 */ { "launch-wavelinkse", L"Starting WaveLink...",         stepLaunchWaveLinkSE, STEP_BIT(0) | STEP_BIT(2), 0 },
+    /* 4 */ { "launch-wavelink",   L"Starting WaveLink...",         stepLaunchWaveLink,   STEP_BIT(0) | STEP_BIT(2), 0 },
+    /* 5 */ { "wait-devices",      L"Waiting for devices...",       stepWaitDevices,      STEP_BIT(4), 0 },
+    /* 6 */ { "set-defaults",      L"Setting audio defaults...",    stepSetDefaults,      STEP_BIT(3) | STEP_BIT(5), 0 },
+    /* 7 */ { "restore-volume",    NULL,                            stepRestoreVolume,    STEP_BIT(6), 0 },
+};
+
+/* Tier 3: restart audiosrv only */
+static const ResetStep g_audioSrvTierSteps[] CORE_MAYBE_UNUSED = {
+    /* 0 */ { "lower-volume",      NULL,                            stepLowerVolume,      0, 1 },
+    /* 1 */ { "restart-audiosrv",  L"Restarting audio...",          stepRestartAudioSrv,  STEP_BIT(0), 0 },
+    /* 2 */ { "wait-devices",      L"Waiting for devices...",       stepWaitDevices,      STEP_BIT(1), 0 },
+    /* 3 */ { "set-defaults",      L"Setting audio defaults...",    stepSetDefaults,      STEP_BIT(2), 0 },
+    /* 4 */ { "restore-volume",    NULL,                            stepRestoreVolume,    STEP_BIT(3), 0 },
+};
+
+typedef struct ResetTier {
+    const char* name;
+    const ResetStep* steps;
+    int count;
+} ResetTier;
+
+/* Tier 4 is the full reset */
+static const ResetTier g_resetTiers[] CORE_MAYBE_UNUSED = {
+    { "apply-defaults",   g_applyDefaultsSteps, (int)(sizeof(g_applyDefaultsSteps) / sizeof(g_applyDefaultsSteps[0])) },
+    { "restart-wavelink", g_waveLinkTierSteps,  (int)(sizeof(g_waveLinkTierSteps) / sizeof(g_waveLinkTierSteps[0])) },
+    { "restart-audiosrv", g_audioSrvTierSteps,  (int)(sizeof(g_audioSrvTierSteps) / sizeof(g_audioSrvTierSteps[0])) },
+    { "full-reset",       g_resetSteps,         STEP_COUNT },
+};
+#define TIER_COUNT ((int)(sizeof(g_resetTiers) / sizeof(g_resetTiers[0])))
+#define FULL_RESET_TIER (&g_resetTiers[TIER_COUNT - 1])
+
+static inline const ResetTier* findTier(const char* name) {
+    for (int t = 0; t < TIER_COUNT; t++) {
+        if (strcmp(g_resetTiers[t].name, name) == 0) return &g_resetTiers[t];
+    }
+    return NULL;
+}
+
+/* Run the tiers in order until the machine passes verification. runTier
+ * runs one tier's graph (on the worker pool, under the journal - whatever
+ * the caller does for a graph). Returns the index of the tier that fixed
+ * it, or -1 if the full reset didn't either. */
+static inline int resetEscalate(Platform* p, void (*runTier)(Platform* p, int tier)) {
+    for (int t = 0; t < TIER_COUNT; t++) {
+        runTier(p, t);
+        if (p->verify(p)) return t;
+    }
+    return -1;
+}
+
+/* ========== Job Queue ========== */
+/* The folding rules of the reset coordinator. Jobs are ordered by size and a
+ * bigger one covers everything a smaller one would do. A request that
+ * arrives while an equal or bigger job is running is served by it, and
+ * requests queued behind a running job collapse into the biggest of them.
+ * Callers serialize access to a JobQueue. */
+#define JOB_NONE      0
+#define JOB_DEFAULTS  1     /* Re-apply audio defaults only */
+#define JOB_ESCALATE  2     /* Tiered: cheapest fix first, verified between tiers */
+#define JOB_RESET     3     /* Full reset - covers everything below it */
+
+typedef struct JobQueue {
+    int running;            /* JOB_* in flight */
+    int pending;            /* JOB_* queued behind it */
+    LONG completed;         /* Jobs finished so far */
+} JobQueue;
+
+/* Whether having run job `ran` serves a request for `requested` */
+static inline int jobCovers(int ran, int requested) {
+    return ran >= requested;
+}
+
+/* Queue a job or fold it into one already running or queued. Returns the
+ * completed-job count at which the request has been served. */
+static inline LONG jobQueueSubmit(JobQueue* q, int job) {
+    if (jobCovers(q->running, job)) return q->completed + 1;
+    if (job > q->pending) q->pending = job;
+    return q->completed + (q->running ? 2 : 1);
+}
+
+/* Start the queued job (JOB_NONE if there isn't one) */
+static inline int jobQueueTake(JobQueue* q) {
+    int job = q->pending;
+    q->pending = JOB_NONE;
+    q->running = job;
+    return job;
+}
+
+/* The running job finished. Returns it. */
+static inline int jobQueueFinish(JobQueue* q) {
+    int job = q->running;
+    q->running = JOB_NONE;
+    q->completed++;
+    return job;
+}
+
+/* ========== Status Block ========== */
+/* Layout of the shared-memory progress block and its seqlock (see Status
+ * Block in elgato_audio_reset.c for who writes it). Readers are other
+ * processes built from other sources, so the layout is pinned by the
+ * asserts below. */
+#define STATUS_BLOCK_MAGIC      0x54534145u     /* "EAST" */
+#define STATUS_BLOCK_VERSION    1
+#define STATUS_MAX_STEPS        16
+#define STATUS_STEP_NAME        24
+#define STATUS_TEXT_LEN         64
+#define STATUS_ERROR_LEN        128
+#define STATUS_READ_TRIES       10000
+#define STATUS_READ_SPINS       16      /* Tries before giving up the time slice */
+
+enum { STATUS_IDLE, STATUS_RUNNING, STATUS_DONE };
+
+/* Every field sits at its natural alignment, so there is no padding and the
+ * offsets (in the comments) are the same for any compiler */
+typedef struct StatusStep {
+    char name[STATUS_STEP_NAME];    /*  0 */
+    ULONGLONG started;              /* 24: 0 = not yet */
+    ULONGLONG finished;             /* 32: 0 = not yet (both set, equal: done by an interrupted run) */
+} StatusStep;                       /* 40 */
+
+typedef struct StatusBlock {
+    DWORD magic;                    /*   0 */
+    WORD version;                   /*   4 */
+    WORD size;                      /*   6: sizeof(StatusBlock) */
+    volatile LONG sequence;         /*   8: odd while an update is in progress */
+    DWORD pid;                      /*  12: process running the current or last job */
+    LONG state;                     /*  16: STATUS_* */
+    LONG job;                       /*  20: JOB_* */
+    LONG currentStep;               /*  24: most recently started step, -1 none */
+    LONG stepCount;                 /*  28 */
+    ULONGLONG jobStarted;           /*  32 */
+    ULONGLONG jobFinished;          /*  40: 0 while running */
+    LONG jobsCompleted;             /*  48: since the block was created */
+    LONG lastErrorLevel;            /*  52: 2 warning, 3 error, 0 none this job */
+    ULONGLONG lastErrorTime;        /*  56 */
+    StatusStep steps[STATUS_MAX_STEPS];     /*  64 */
+    char status[STATUS_TEXT_LEN];           /* 704: tray text, UTF-8 */
+    char lastError[STATUS_ERROR_LEN];       /* 768 */
+} StatusBlock;                      /* 896 */
+
+CORE_STATIC_ASSERT(sizeof(StatusStep) == 40, status_step_size);
+CORE_STATIC_ASSERT(offsetof(StatusStep, started) == 24, status_step_started);
+CORE_STATIC_ASSERT(offsetof(StatusBlock, sequence) == 8, status_sequence);
+CORE_STATIC_ASSERT(offsetof(StatusBlock, pid) == 12, status_pid);
+CORE_STATIC_ASSERT(offsetof(StatusBlock, jobStarted) == 32, status_job_started);
+CORE_STATIC_ASSERT(offsetof(StatusBlock, jobsCompleted) == 48, status_jobs_completed);
+CORE_STATIC_ASSERT(offsetof(StatusBlock, lastErrorTime) == 56, status_last_error_time);
+CORE_STATIC_ASSERT(offsetof(StatusBlock, steps) == 64, status_steps);
+CORE_STATIC_ASSERT(offsetof(StatusBlock, status) == 704, status_text);
+CORE_STATIC_ASSERT(offsetof(StatusBlock, lastError) == 768, status_last_error);
+CORE_STATIC_ASSERT(sizeof(StatusBlock) == 896, status_block_size);
+
+/* Writer side, serialized by the caller: bump the sequence to odd, update
+ * the payload, bump it back to even. InterlockedIncrement is a full
+ * barrier, so the payload writes stay between the two bumps. */
+static inline void statusSeqBegin(StatusBlock* b) {
+    InterlockedIncrement(&b->sequence);
+}
+
+static inline void statusSeqEnd(StatusBlock* b) {
+    InterlockedIncrement(&b->sequence);
+}
+
+/* Reader side, the two halves around a copy. Begin returns the sequence to
+ * validate against, or -1 (never a valid, even sequence) while an update is
+ * in progress. */
+static inline LONG statusReadBegin(const StatusBlock* shared) {
+    LONG sequence = shared->sequence;
+    if (sequence & 1) return -1;
+    MemoryBarrier();
+    return sequence;
+}
+
+/* 1 if nothing was written since statusReadBegin() returned sequence */
+static inline int statusReadValid(const StatusBlock* shared, LONG sequence) {
+    MemoryBarrier();
+    return shared->sequence == sequence;
+}
+
+/* A consistent copy of a mapped block. Retries while an update is in
+ * progress or one happened during the copy: a few spins cover a writer on
+ * another core, after that each retry gives up the time slice, since the
+ * reader may have pre-empted a writer (possibly in another process) that
+ * has to run to finish. Returns 0 if the writer kept it busy for the
+ * whole retry budget. */
+static inline int statusRead(const StatusBlock* shared, StatusBlock* out) {
+    for (int tries = 0; tries < STATUS_READ_TRIES; tries++) {
+        LONG sequence = statusReadBegin(shared);
+        if (sequence != -1) {
+            memcpy(out, (const void*)shared, sizeof(*out));
+            if (statusReadValid(shared, sequence)) return 1;
+        }
+        if (tries < STATUS_READ_SPINS) YieldProcessor();
+        else SwitchToThread();
+    }
+    return 0;
+}
+
+/* ========== Log Ring ========== */
+/* The queue behind logMsg() (see Logging in elgato_audio_reset.c): a bounded
+ * multi-producer, single-consumer ring of fixed-size lines. Producers take a
+ * ticket with an interlocked increment; every slot carries a sequence number
+ * that says whose turn it is, so nothing here takes a lock. A slot is free
+ * for ticket t when seq == t and holds t's line when seq == t + 1; the
+ * consumer hands it to ticket t + slot count when it pops it. */
+#define LOG_LINE_MAX    512
+
+typedef struct LogSlot {
+    volatile LONG seq;
+    char text[LOG_LINE_MAX];
+} LogSlot;
+
+typedef struct LogRing {
+    LogSlot* slots;
+    LONG count;             /* Power of two */
+    volatile LONG head;     /* Next ticket to hand out */
+    volatile LONG tail;     /* Next ticket the consumer pops */
+} LogRing;
+
+static inline void logRingInit(LogRing* r, LogSlot* slots, LONG count) {
+    r->slots = slots;
+    r->count = count;
+    r->head = 0;
+    r->tail = 0;
+    for (LONG i = 0; i < count; i++) slots[i].seq = i;
+}
+
+/* Take the next ticket. Its slot may still hold an older line when the ring
+ * is full - wait for logRingSlotFree() before writing it. */
+static inline LONG logRingClaim(LogRing* r) {
+    return InterlockedIncrement(&r->head) - 1;
+}
+
+static inline LogSlot* logRingSlot(LogRing* r, LONG ticket) {
+    return &r->slots[ticket & (r->count - 1)];
+}
+
+static inline int logRingSlotFree(LogRing* r, LONG ticket) {
+    return logRingSlot(r, ticket)->seq == ticket;
+}
+
+/* Fill a free slot and hand it to the consumer */
+static inline void logRingPublish(LogRing* r, LONG ticket, const char* text) {
+    LogSlot* slot = logRingSlot(r, ticket);
+    strncpy(slot->text, text, LOG_LINE_MAX - 1);
+    slot->text[LOG_LINE_MAX - 1] = '\0';
+    InterlockedExchange(&slot->seq, ticket + 1);
+}
+
+/* Consumer only: the oldest line, or NULL if it isn't published yet */
+static inline const char* logRingPeek(LogRing* r) {
+    LogSlot* slot = logRingSlot(r, r->tail);
+    if (slot->seq != r->tail + 1) return NULL;
+    MemoryBarrier();
+    return slot->text;
+}
+
+/* Consumer only: release the line logRingPeek() returned */
+static inline void logRingPop(LogRing* r) {
+    LogSlot* slot = logRingSlot(r, r->tail);
+    InterlockedExchange(&slot->seq, r->tail + r->count);
+    InterlockedIncrement(&r->tail);
+}
+
+/* ========== Journal Parsing ========== */
+/* Reading back the reset journal (see Reset Journal in elgato_audio_reset.c).
+ * Every record is one '\n'-terminated line; the file can end in a torn
+ * line, or in a run of zeros, if the process or the machine died mid-write.
+ * Parsing stops at the first line that isn't whole, and validLen says how
+ * much of the file is good, so a resumed run can cut the rest off before it
+ * appends. */
+#define JOURNAL_LINE_MAX    512
+#define JOURNAL_NAME_MAX    32
+#define MAX_JOURNAL_STEPS   32
+#define MAX_JOURNAL_VOLUMES 32
+
+typedef struct JournalRecords {
+    char graph[JOURNAL_NAME_MAX];               /* "" = no run record */
+    char steps[MAX_JOURNAL_STEPS][JOURNAL_NAME_MAX];
+    int stepCount;
+    struct {
+        float level;
+        char id[JOURNAL_LINE_MAX];              /* UTF-8 endpoint ID */
+    } volumes[MAX_JOURNAL_VOLUMES];
+    int volumeCount;
+    size_t validLen;                            /* Bytes of whole lines */
+} JournalRecords;
+
+/* Names longer than the field are cut */
+static inline void journalCopyName(char* out, const char* name) {
+    size_t n = strlen(name);
+    if (n > JOURNAL_NAME_MAX - 1) n = JOURNAL_NAME_MAX - 1;
+    memcpy(out, name, n);
+    out[n] = '\0';
+}
+
+static inline void journalParseLine(JournalRecords* r, const char* line) {
+    if (strncmp(line, "run ", 4) == 0) {
+        journalCopyName(r->graph, line + 4);
+    } else if (strncmp(line, "step ", 5) == 0 && r->stepCount < MAX_JOURNAL_STEPS) {
+        journalCopyName(r->steps[r->stepCount++], line + 5);
+    } else if (strncmp(line, "volume ", 7) == 0 && r->volumeCount < MAX_JOURNAL_VOLUMES) {
+        int used = 0;
+        float level;
+        if (sscanf(line + 7, "%f %n", &level, &used) == 1 && used > 0 && line[7 + used]) {
+            r->volumes[r->volumeCount].level = level;
+            snprintf(r->volumes[r->volumeCount].id, JOURNAL_LINE_MAX, "%s", line + 7 + used);
+            r->volumeCount++;
+        }
+    }
+    /* Anything else ("resume", unknown records) carries no state */
+}
+
+/* Parse len bytes of journal. Returns 1 if they hold a run record. */
+static inline int journalParse(const char* data, size_t len, JournalRecords* r) {
+    memset(r, 0, sizeof(*r));
+    char line[JOURNAL_LINE_MAX];
+    size_t pos = 0;
+    while (pos < len) {
+        const char* nl = (const char*)memchr(data + pos, '\n', len - pos);
+        if (!nl) break;                                     /* Torn last line */
+        size_t n = (size_t)(nl - (data + pos));
+        if (memchr(data + pos, '\0', n)) break;             /* Zero-filled tail */
+        if (n < sizeof(line)) {
+            memcpy(line, data + pos, n);
+            line[n] = '\0';
+            journalParseLine(r, line);
+        }
+        pos += n + 1;
+        r->validLen = pos;
+    }
+    return r->graph[0] != '\0';
+}
+
+/* ========== Device Event Source ========== */
+/* Abstract source of audio endpoint events. The readiness waiter only needs
+ * to be woken when something changes, to refresh its view once per wake, and
+ * to ask whether an endpoint is active, so the MMDevice implementation in
+ * elgato_audio_reset.c can be swapped for a scripted one. The clock comes
+ * from the source as well, so a scripted source can run on virtual time. */
+enum { DEVICE_FLOW_RENDER, DEVICE_FLOW_CAPTURE };   /* Same values as eRender/eCapture */
+
+typedef struct DeviceEventSource DeviceEventSource;
+struct DeviceEventSource {
+    /* Start waking waitChange() on every endpoint add/remove/state change */
+    int  (*subscribe)(DeviceEventSource* self);
+    void (*unsubscribe)(DeviceEventSource* self);
+    /* Re-read endpoint state; isDeviceActive answers from the last refresh */
+    void (*refresh)(DeviceEventSource* self);
+    /* A device matches by stored ID when one is given, else by friendly name */
+    int  (*isDeviceActive)(DeviceEventSource* self, const WCHAR* id, const WCHAR* name, int dataFlow);
+    /* Milliseconds on a monotonic clock */
+    DWORD (*now)(DeviceEventSource* self);
+    /* Sleep until a change (1) or timeoutMs (0). Unsubscribed, it just sleeps. */
+    int  (*waitChange)(DeviceEventSource* self, DWORD timeoutMs);
+};
+
+/* ========== Device Readiness ========== */
+typedef struct {
+    const WCHAR* id;
+    const WCHAR* name;
+    int dataFlow;           /* DEVICE_FLOW_* */
+    const char* label;
+} ReadyTarget;
+
+/* Returns the number of targets not yet active (0 = all ready) */
+static inline int countMissingDevices(DeviceEventSource* src, const ReadyTarget* targets, int count) {
+    int missing = 0;
+    src->refresh(src);
+    for (int i = 0; i < count; i++) {
+        if (!targets[i].name[0]) continue;
+        if (!src->isDeviceActive(src, targets[i].id, targets[i].name, targets[i].dataFlow)) missing++;
+    }
+    return missing;
+}
+
+/* Block until every target is active or the budget's timeout elapses. Wakes
+ * on endpoint events; if the source can't subscribe it falls back to the
+ * budget's poll schedule. Returns 1 if all targets became active. */
+static inline int waitForDevicesReady(DeviceEventSource* src, const ReadyTarget* targets, int count,
+                                      const WaitBudget* budget, DWORD* elapsedMs) {
+    /* Subscribe before the first check so no arrival can slip between them */
+    int subscribed = src->subscribe(src);
+    DWORD timeoutMs = budget->timeoutMs;
+    DWORD start = src->now(src);
+    int ready = 0;
+    
+    for (;;) {
+        if (countMissingDevices(src, targets, count) == 0) {
+            ready = 1;
+            break;
+        }
+        DWORD elapsed = src->now(src) - start;
+        if (elapsed >= timeoutMs) break;
+        DWORD remaining = timeoutMs - elapsed;
+        DWORD slice = subscribed ? remaining : waitBudgetPollMs(budget, elapsed);
+        src->waitChange(src, remaining < slice ? remaining : slice);
+    }
+    
+    if (elapsedMs) *elapsedMs = src->now(src) - start;
+    src->unsubscribe(src);
+    return ready;
+}
+
+#endif /* RESET_CORE_H */
@@ -0,0 +1,112 @@
+/*
+ * log_bench.c - Call-site cost of logging, on the log ring from reset_core.h
+ *
+ * Run with `make -C c/tests bench`. Times a log line formatted and written
+ * through (fputs + fflush, what logMsg() used to do on every call) against
+ * the same line formatted and queued to a writer thread, the way logMsg()
+ * does it now. Output goes to a scratch file that is removed afterwards.
+ * The exe's --benchmark measures the same thing on Windows.
+ */
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <pthread.h>
+
+#include "reset_core.h"
+
+#define LOG_BENCH_SLOTS  1024   /* LOG_RING_SLOTS in the tool */
+#define LOG_BENCH_BURSTS 200
+#define LOG_BENCH_BURST  256    /* Under the ring size, so a burst never waits for the writer */
+
+typedef struct LogBench {
+    LogRing ring;
+    FILE* file;
+    volatile LONG stop;
+} LogBench;
+
+static double nowNs(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+/* Stands in for logWriterThread(): drain, flush, sleep a little when idle */
+static void* logBenchWriter(void* param) {
+    LogBench* b = (LogBench*)param;
+    for (;;) {
+        int stopping = b->stop;
+        const char* text;
+        int written = 0;
+        while ((text = logRingPeek(&b->ring)) != NULL) {
+            fputs(text, b->file);
+            logRingPop(&b->ring);
+            written++;
+        }
+        if (written) fflush(b->file);
+        if (stopping) return NULL;
+        if (!written) usleep(1000);
+    }
+}
+
+static void logBenchLine(LogBench* b, int queued, const char* fmt, ...) {
+    char buf[LOG_LINE_MAX];
+    va_list args;
+    va_start(args, fmt);
+    vsnprintf(buf, sizeof(buf), fmt, args);
+    va_end(args);
+    
+    if (queued) {
+        LONG ticket = logRingClaim(&b->ring);
+        while (!logRingSlotFree(&b->ring, ticket)) SwitchToThread();
+        logRingPublish(&b->ring, ticket, buf);
+    } else {
+        fputs(buf, b->file);
+        fflush(b->file);
+    }
+}
+
+int main(void) {
+    char scratchPath[] = "/tmp/log_bench_XXXXXX";
+    int fd = mkstemp(scratchPath);
+    LogBench b;
+    memset(&b, 0, sizeof(b));
+    LogSlot* slots = (LogSlot*)malloc(LOG_BENCH_SLOTS * sizeof(LogSlot));
+    b.file = fd >= 0 ? fdopen(fd, "w") : NULL;
+    if (!slots || !b.file) {
+        fprintf(stderr, "log_bench: couldn't set up the scratch file\n");
+        return 1;
+    }
+    logRingInit(&b.ring, slots, LOG_BENCH_SLOTS);
+    pthread_t writer;
+    pthread_create(&writer, NULL, logBenchWriter, &b);
+    
+    double nsPerCall[2];
+    for (int mode = 0; mode < 2; mode++) {
+        double ns = 0;
+        for (int burst = 0; burst < LOG_BENCH_BURSTS; burst++) {
+            double t0 = nowNs();
+            for (int i = 0; i < LOG_BENCH_BURST; i++) {
+                logBenchLine(&b, mode, "    [i] Benchmark line %d of burst %d\n", i, burst);
+            }
+            ns += nowNs() - t0;
+    
+            /* Let the writer catch up so the next burst starts with an empty ring */
+            while (b.ring.tail != b.ring.head) usleep(1000);
+        }
+        nsPerCall[mode] = ns / (LOG_BENCH_BURSTS * LOG_BENCH_BURST);
+    }
+    
+    InterlockedExchange(&b.stop, 1);
+    pthread_join(writer, NULL);
+    fclose(b.file);
+    free(slots);
+    unlink(scratchPath);
+    
+    printf("%-33s %9s\n", "logMsg() call-site cost", "ns/call");
+    printf("%-33s %9.0f\n", "write-through (fputs + fflush)", nsPerCall[0]);
+    printf("%-33s %9.0f\n", "ring buffer + writer thread", nsPerCall[1]);
+    return 0;
+}
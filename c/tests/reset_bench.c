@@ -0,0 +1,60 @@
+/*
+ * reset_bench.c - Reset strategies on the simulated machine
+ *
+ * Run with `make -C c/tests bench`. Replays the reset graphs from
+ * reset_core.h thousands of times per profile on the virtual clock of
+ * sim_platform.h - the full reset, and escalation (TIERED_RESET=1) from
+ * the cheapest tier up - and prints the p50/p95 duration of each and how
+ * often the machine came out healthy. Runs cycle through the faults, so
+ * every tier gets its share, and each run has its own jitter seed; the
+ * numbers are the same on every machine.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "sim_platform.h"
+
+#define BENCH_RUNS 4000     /* Per profile and strategy */
+
+enum { STRATEGY_FULL_RESET, STRATEGY_ESCALATE, STRATEGY_COUNT };
+static const char* const g_strategyNames[STRATEGY_COUNT] = { "full-reset", "escalate" };
+
+static int compareDwords(const void* a, const void* b) {
+    DWORD x = *(const DWORD*)a, y = *(const DWORD*)b;
+    return (x > y) - (x < y);
+}
+
+/* Nearest-rank percentile of sorted samples */
+static DWORD percentile(const DWORD* sorted, int n, int pct) {
+    return sorted[(n - 1) * pct / 100];
+}
+
+int main(void) {
+    DWORD* took = (DWORD*)malloc(BENCH_RUNS * sizeof(DWORD));
+    if (!took) return 1;
+    
+    printf("%-14s %-11s %6s %8s %8s %7s\n", "profile", "strategy", "runs", "p50 ms", "p95 ms", "fixed");
+    for (int p = 0; p < SIM_PROFILE_COUNT; p++) {
+        for (int strategy = 0; strategy < STRATEGY_COUNT; strategy++) {
+            int fixed = 0;
+            for (int run = 0; run < BENCH_RUNS; run++) {
+                SimPlatform sim;
+                initSimPlatform(&sim, &g_simProfiles[p], run % FAULT_COUNT, 0x9E3779B9u * (unsigned int)(run + 1));
+                if (strategy == STRATEGY_FULL_RESET) {
+                    simRunSteps(&sim, g_resetSteps, STEP_COUNT);
+                    fixed += simHealthy(&sim);
+                } else {
+                    fixed += resetEscalate(&sim.base, simRunTier) >= 0;
+                }
+                took[run] = sim.now;
+            }
+            qsort(took, BENCH_RUNS, sizeof(DWORD), compareDwords);
+            printf("%-14s %-11s %6d %8lu %8lu %6.1f%%\n", g_simProfiles[p].name, g_strategyNames[strategy],
+                   BENCH_RUNS, (unsigned long)percentile(took, BENCH_RUNS, 50),
+                   (unsigned long)percentile(took, BENCH_RUNS, 95), 100.0 * fixed / BENCH_RUNS);
+        }
+    }
+    free(took);
+    return 0;
+}
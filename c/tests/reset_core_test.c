@@ -0,0 +1,992 @@
+/*
+ * reset_core_test.c - Tests for reset_core.h
+ *
+ * Build and run with `make -C c/tests`. Prints each failed check and exits
+ * non-zero if there was one.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+
+#include "reset_core.h"
+#include "sim_platform.h"
+
+static int g_checks = 0;
+static int g_failures = 0;
+
+#define CHECK(cond) do { \
+    g_checks++; \
+    if (!(cond)) { \
+        g_failures++; \
+        printf("FAIL %s:%d: %s\n", __FILE__, __LINE__, #cond); \
+    } \
+} while (0)
+
+/* ========== Wait Budget Tests ========== */
+/* Fewer than BUDGET_MIN_SAMPLES: the default, unlearned */
+static void testBudgetNeedsHistory(void) {
+    DWORD samples[BUDGET_SAMPLES] = { 100, 100, 100, 100 };
+    WaitBudget b = waitBudgetFromSamples(samples, BUDGET_MIN_SAMPLES - 1, 10000, 2000, 2, 1000);
+    CHECK(b.timeoutMs == 10000 && !b.learned && b.p50Ms == 0 && b.pollMs == 1000);
+}
+
+/* p99 and p50 come from the sorted samples, whatever order they arrive in */
+static void testBudgetPercentiles(void) {
+    DWORD samples[BUDGET_SAMPLES];
+    /* 64 samples, 100..6400 shuffled: p99 index (63 * 99) / 100 = 62 -> 6300,
+     * p50 index 31 -> 3200 */
+    for (DWORD i = 0; i < BUDGET_SAMPLES; i++) samples[i] = ((i * 37) % BUDGET_SAMPLES + 1) * 100;
+    WaitBudget b = waitBudgetFromSamples(samples, BUDGET_SAMPLES, 10000, 0, 2, 1000);
+    CHECK(b.learned);
+    CHECK(b.timeoutMs == (DWORD)(6300 * BUDGET_MARGIN) + BUDGET_SLACK_MS);
+    CHECK(b.p50Ms == 3200);
+    int sorted = 1;
+    for (int i = 1; i < BUDGET_SAMPLES; i++) if (samples[i - 1] > samples[i]) sorted = 0;
+    CHECK(sorted);
+    
+    /* Five samples: p99 index (4 * 99) / 100 = 3, the second largest */
+    DWORD five[5] = { 900, 100, 500, 300, 700 };
+    b = waitBudgetFromSamples(five, 5, 10000, 0, 2, 1000);
+    CHECK(b.timeoutMs == (DWORD)(700 * BUDGET_MARGIN) + BUDGET_SLACK_MS);
+    CHECK(b.p50Ms == 500);
+}
+
+static void testBudgetClamps(void) {
+    DWORD fast[5] = { 10, 10, 10, 10, 10 };
+    WaitBudget b = waitBudgetFromSamples(fast, 5, 10000, 2000, 2, 1000);
+    CHECK(b.timeoutMs == 2000);                     /* Raised to minMs */
+    
+    DWORD slow[5] = { 30000, 30000, 30000, 30000, 30000 };
+    b = waitBudgetFromSamples(slow, 5, 10000, 2000, 2, 1000);
+    CHECK(b.timeoutMs == 20000);                    /* Capped at maxFactor x default */
+    
+    /* A sample near the top of the range mustn't wrap the timeout */
+    DWORD huge[5] = { 0xFFFFFFF0u, 0xFFFFFFF0u, 0xFFFFFFF0u, 0xFFFFFFF0u, 0xFFFFFFF0u };
+    b = waitBudgetFromSamples(huge, 5, 10000, 2000, 2, 1000);
+    CHECK(b.timeoutMs == 20000);
+    
+    /* The cap wins over minMs when they cross */
+    b = waitBudgetFromSamples(fast, 5, 1000, 5000, 1, 1000);
+    CHECK(b.timeoutMs == 1000);
+}
+
+/* Exponential toward p50, fine around it, backing off after, never above pollMs */
+static void testBudgetPollSchedule(void) {
+    WaitBudget b = { 20000, 4000, 1000, 1 };
+    CHECK(waitBudgetPollMs(&b, 0) == 200);          /* Fine step floor: p50 / 20 */
+    CHECK(waitBudgetPollMs(&b, 400) == 400);
+    CHECK(waitBudgetPollMs(&b, 2800) == 200);       /* Stops at the window start (3000) */
+    CHECK(waitBudgetPollMs(&b, 3500) == 200);
+    CHECK(waitBudgetPollMs(&b, 6000) == 1000);      /* (6000 - 4000) / 2, capped */
+    
+    WaitBudget unlearned = { 20000, 0, 1000, 0 };
+    CHECK(waitBudgetPollMs(&unlearned, 0) == 1000);
+}
+
+/* ========== Step Graph Tests ========== */
+/* Same shape as the full reset: two roots feed a restart, which fans out to
+ * four steps that all join before the last two */
+static const ResetStep g_diamond[] = {
+    /* 0 */ { "discover",  NULL, NULL, 0, 1 },
+    /* 1 */ { "kill",      NULL, NULL, 0, 0 },
+    /* 2 */ { "restart",   NULL, NULL, STEP_BIT(1), 0 },
+    /* 3 */ { "launch-a",  NULL, NULL, STEP_BIT(0) | STEP_BIT(2), 0 },
+    /* 4 */ { "launch-b",  NULL, NULL, STEP_BIT(0) | STEP_BIT(2), 0 },
+    /* 5 */ { "wait",      NULL, NULL, STEP_BIT(2), 0 },
+    /* 6 */ { "defaults",  NULL, NULL, STEP_BIT(3) | STEP_BIT(4) | STEP_BIT(5), 0 },
+    /* 7 */ { "restore",   NULL, NULL, STEP_BIT(6), 0 },
+};
+#define DIAMOND_COUNT 8
+
+static void testGraphValidation(void) {
+    ResetStep steps[33];
+    memset(steps, 0, sizeof(steps));
+    
+    CHECK(schedulerValidate(g_diamond, DIAMOND_COUNT));
+    CHECK(!schedulerValidate(g_diamond, 0));
+    /* A prefix is a graph of its own; shifted by one, "restart" and
+     * "launch-a" end up waiting on each other */
+    CHECK(schedulerValidate(g_diamond, 3));
+    CHECK(!schedulerValidate(g_diamond + 1, 3));
+    
+    CHECK(schedulerValidate(steps, 32));
+    CHECK(!schedulerValidate(steps, 33));
+    steps[31].deps = STEP_BIT(0);
+    steps[0].deps = STEP_BIT(30);
+    CHECK(schedulerValidate(steps, 32));
+    steps[30].deps = STEP_BIT(31);
+    CHECK(!schedulerValidate(steps, 32));           /* 0 -> 30 -> 31 -> 0 */
+    
+    memset(steps, 0, sizeof(steps));
+    steps[2].deps = STEP_BIT(2);
+    CHECK(!schedulerValidate(steps, 4));            /* Depends on itself */
+    steps[2].deps = STEP_BIT(4);
+    CHECK(!schedulerValidate(steps, 4));            /* Unknown step */
+    CHECK(schedulerValidate(steps, 5));
+}
+
+/* Picks in index order among the ready steps, -1 while blocked, -2 at the end */
+static void testGraphPickOrder(void) {
+    StepGraph g;
+    stepGraphInit(&g, g_diamond, DIAMOND_COUNT, 0);
+    
+    CHECK(stepGraphPick(&g) == 0);
+    CHECK(stepGraphPick(&g) == 1);
+    CHECK(stepGraphPick(&g) == -1);
+    CHECK(stepGraphFinish(&g, 1) == 0);
+    CHECK(stepGraphPick(&g) == 2);
+    CHECK(stepGraphFinish(&g, 2) == 0);
+    CHECK(stepGraphPick(&g) == 5);                  /* 3 and 4 still need step 0 */
+    CHECK(stepGraphPick(&g) == -1);
+    CHECK(stepGraphFinish(&g, 0) == 0);
+    CHECK(stepGraphPick(&g) == 3);
+    CHECK(stepGraphPick(&g) == 4);
+    CHECK(stepGraphPick(&g) == -1);
+    stepGraphFinish(&g, 5);
+    stepGraphFinish(&g, 4);
+    CHECK(stepGraphPick(&g) == -1);
+    stepGraphFinish(&g, 3);
+    CHECK(stepGraphPick(&g) == 6);
+    stepGraphFinish(&g, 6);
+    CHECK(stepGraphPick(&g) == 7);
+    CHECK(stepGraphPick(&g) == -2);
+    CHECK(!stepGraphFinished(&g));
+    CHECK(stepGraphFinish(&g, 7) == 1);
+}
+
+/* Steps done by an interrupted run are neither picked nor waited for */
+static void testGraphSkip(void) {
+    StepGraph g;
+    stepGraphInit(&g, g_diamond, DIAMOND_COUNT, STEP_BIT(0) | STEP_BIT(1) | STEP_BIT(2) | STEP_BIT(3));
+    CHECK(stepGraphPick(&g) == 4);
+    CHECK(stepGraphPick(&g) == 5);
+    CHECK(stepGraphPick(&g) == -1);
+    
+    stepGraphInit(&g, g_diamond, DIAMOND_COUNT, stepGraphAll(DIAMOND_COUNT));
+    CHECK(stepGraphFinished(&g));
+    CHECK(stepGraphPick(&g) == -2);
+    CHECK(stepGraphAll(32) == 0xFFFFFFFFu);
+    CHECK(stepGraphAll(3) == 7u);
+}
+
+/* Run the graph on a pool of virtual workers, each step taking its own
+ * time: every step must run once, never before its dependencies finished */
+static void runGraphOnWorkers(const ResetStep* steps, int count, const DWORD* durations, int workers,
+                              DWORD* startAt, DWORD* endAt, DWORD* total) {
+    StepGraph g;
+    int busy[8];
+    DWORD freeAt[8];
+    DWORD now = 0;
+    for (int w = 0; w < workers; w++) {
+        busy[w] = -1;
+        freeAt[w] = 0;
+    }
+    stepGraphInit(&g, steps, count, 0);
+    
+    while (!stepGraphFinished(&g)) {
+        /* Idle workers take whatever is ready now */
+        for (int w = 0; w < workers; w++) {
+            if (busy[w] >= 0) continue;
+            int idx = stepGraphPick(&g);
+            if (idx < 0) break;
+            busy[w] = idx;
+            startAt[idx] = now;
+            freeAt[w] = now + durations[idx];
+        }
+        /* Advance to the next step to finish */
+        int next = -1;
+        for (int w = 0; w < workers; w++) {
+            if (busy[w] >= 0 && (next < 0 || freeAt[w] < freeAt[next])) next = w;
+        }
+        if (next < 0) break;                        /* Nothing running and nothing ready: stuck */
+        now = freeAt[next];
+        endAt[busy[next]] = now;
+        stepGraphFinish(&g, busy[next]);
+        busy[next] = -1;
+    }
+    *total = now;
+}
+
+static void testGraphOnWorkers(void) {
+    static const DWORD durations[DIAMOND_COUNT] = { 50, 900, 4000, 2500, 3000, 6000, 700, 100 };
+    for (int workers = 1; workers <= 4; workers++) {
+        DWORD startAt[DIAMOND_COUNT], endAt[DIAMOND_COUNT], total = 0;
+        memset(startAt, 0xFF, sizeof(startAt));
+        runGraphOnWorkers(g_diamond, DIAMOND_COUNT, durations, workers, startAt, endAt, &total);
+    
+        int ordered = 1;
+        for (int i = 0; i < DIAMOND_COUNT; i++) {
+            if (startAt[i] == 0xFFFFFFFFu) ordered = 0;
+            for (int d = 0; d < DIAMOND_COUNT; d++) {
+                if ((g_diamond[i].deps & STEP_BIT(d)) && startAt[i] < endAt[d]) ordered = 0;
+            }
+        }
+        CHECK(ordered);
+        if (workers == 1) CHECK(total == 17250);    /* Serial: the sum */
+        if (workers >= 3) CHECK(total == 11700);    /* Critical path: kill, restart, wait, defaults, restore */
+    }
+}
+
+/* ========== Job Queue Tests ========== */
+/* Submitting while idle queues; the request is served by the next finish */
+static void testJobQueueIdle(void) {
+    JobQueue q = {0};
+    CHECK(jobQueueSubmit(&q, JOB_DEFAULTS) == 1);
+    CHECK(q.pending == JOB_DEFAULTS);
+    CHECK(jobQueueTake(&q) == JOB_DEFAULTS);
+    CHECK(q.running == JOB_DEFAULTS && q.pending == JOB_NONE);
+    CHECK(jobQueueFinish(&q) == JOB_DEFAULTS);
+    CHECK(q.completed == 1 && q.running == JOB_NONE);
+    CHECK(jobQueueTake(&q) == JOB_NONE);
+    jobQueueFinish(&q);
+}
+
+/* An equal or smaller request folds into the running job */
+static void testJobQueueFoldsIntoRunning(void) {
+    for (int running = JOB_DEFAULTS; running <= JOB_RESET; running++) {
+        for (int job = JOB_DEFAULTS; job <= JOB_RESET; job++) {
+            JobQueue q = {0};
+            q.completed = 5;
+            jobQueueSubmit(&q, running);
+            jobQueueTake(&q);
+            LONG target = jobQueueSubmit(&q, job);
+            if (job <= running) {
+                CHECK(target == 6);
+                CHECK(q.pending == JOB_NONE);
+            } else {
+                /* A bigger one waits for the running job and then its own */
+                CHECK(target == 7);
+                CHECK(q.pending == job);
+            }
+        }
+    }
+}
+
+/* Requests queued behind a running job collapse into the biggest */
+static void testJobQueueCollapsesPending(void) {
+    JobQueue q = {0};
+    jobQueueSubmit(&q, JOB_DEFAULTS);
+    jobQueueTake(&q);
+    LONG a = jobQueueSubmit(&q, JOB_ESCALATE);
+    LONG b = jobQueueSubmit(&q, JOB_RESET);
+    LONG c = jobQueueSubmit(&q, JOB_ESCALATE);
+    CHECK(a == 2 && b == 2 && c == 2);
+    CHECK(q.pending == JOB_RESET);
+    
+    CHECK(jobQueueFinish(&q) == JOB_DEFAULTS);
+    CHECK(q.completed < a);
+    CHECK(jobQueueTake(&q) == JOB_RESET);
+    LONG d = jobQueueSubmit(&q, JOB_DEFAULTS);
+    CHECK(d == 2);                                  /* Folded into the running reset */
+    CHECK(jobQueueFinish(&q) == JOB_RESET);
+    CHECK(q.completed >= a && q.completed >= d);
+    CHECK(jobQueueTake(&q) == JOB_NONE);
+}
+
+/* Another process's run only serves an equal or smaller request */
+static void testJobCovers(void) {
+    CHECK(jobCovers(JOB_RESET, JOB_RESET));
+    CHECK(jobCovers(JOB_RESET, JOB_DEFAULTS));
+    CHECK(jobCovers(JOB_ESCALATE, JOB_DEFAULTS));
+    CHECK(!jobCovers(JOB_DEFAULTS, JOB_RESET));
+    CHECK(!jobCovers(JOB_ESCALATE, JOB_RESET));
+    CHECK(!jobCovers(JOB_NONE, JOB_DEFAULTS));
+}
+
+/* ========== Status Block Tests ========== */
+/* Every payload field of update k holds k */
+static void fillStatus(StatusBlock* b, unsigned int k) {
+    b->pid = k;
+    b->jobsCompleted = (LONG)k;
+    b->jobStarted = k;
+    for (int i = 0; i < STATUS_MAX_STEPS; i++) {
+        b->steps[i].started = k;
+        b->steps[i].finished = k;
+    }
+    memset(b->status, (char)('a' + k % 26), STATUS_TEXT_LEN - 1);
+    memset(b->lastError, (char)('a' + k % 26), STATUS_ERROR_LEN - 1);
+}
+
+static int statusConsistent(const StatusBlock* b) {
+    unsigned int k = b->pid;
+    if (b->jobsCompleted != (LONG)k || b->jobStarted != k) return 0;
+    for (int i = 0; i < STATUS_MAX_STEPS; i++) {
+        if (b->steps[i].started != k || b->steps[i].finished != k) return 0;
+    }
+    for (int i = 0; i < STATUS_TEXT_LEN - 1; i++) if (b->status[i] != (char)('a' + k % 26)) return 0;
+    for (int i = 0; i < STATUS_ERROR_LEN - 1; i++) if (b->lastError[i] != (char)('a' + k % 26)) return 0;
+    return 1;
+}
+
+static void testStatusReadStable(void) {
+    static StatusBlock shared, copy;
+    memset(&shared, 0, sizeof(shared));
+    shared.magic = STATUS_BLOCK_MAGIC;
+    statusSeqBegin(&shared);
+    shared.jobsCompleted = 7;
+    strcpy(shared.status, "Setting audio defaults...");
+    statusSeqEnd(&shared);
+    
+    CHECK(shared.sequence == 2);
+    CHECK(statusRead(&shared, &copy));
+    CHECK(copy.magic == STATUS_BLOCK_MAGIC && copy.jobsCompleted == 7);
+    CHECK(strcmp(copy.status, "Setting audio defaults...") == 0);
+}
+
+/* A copy that overlapped an update - started before, or begun mid-way and
+ * finished after - fails validation */
+static void testStatusTearDetected(void) {
+    static StatusBlock shared, copy;
+    memset(&shared, 0, sizeof(shared));
+    fillStatus(&shared, 1);
+    
+    LONG sequence = statusReadBegin(&shared);
+    CHECK(sequence == 0);
+    memcpy(&copy, &shared, offsetof(StatusBlock, steps));  /* First half of the copy */
+    statusSeqBegin(&shared);
+    fillStatus(&shared, 2);
+    statusSeqEnd(&shared);
+    memcpy(&copy.steps, &shared.steps, sizeof(copy) - offsetof(StatusBlock, steps));
+    CHECK(!statusConsistent(&copy));                        /* The copy is torn... */
+    CHECK(!statusReadValid(&shared, sequence));             /* ...and that is detected */
+    
+    /* An update still in progress when the copy ends */
+    sequence = statusReadBegin(&shared);
+    CHECK(sequence == 2);
+    statusSeqBegin(&shared);
+    CHECK(statusReadBegin(&shared) == -1);
+    CHECK(!statusReadValid(&shared, sequence));
+    statusSeqEnd(&shared);
+    
+    /* Nothing written in between: valid */
+    sequence = statusReadBegin(&shared);
+    memcpy(&copy, &shared, sizeof(copy));
+    CHECK(statusReadValid(&shared, sequence) && statusConsistent(&copy));
+}
+
+/* A writer that never finishes (died mid-update) makes the read give up */
+static void testStatusReadGivesUp(void) {
+    static StatusBlock shared, copy;
+    memset(&shared, 0, sizeof(shared));
+    statusSeqBegin(&shared);
+    CHECK(!statusRead(&shared, &copy));
+    statusSeqEnd(&shared);
+    CHECK(statusRead(&shared, &copy));
+}
+
+/* A writer rewriting the whole block as fast as it can: every copy a
+ * reader gets is from a single update */
+#define STATUS_READS 20000
+
+typedef struct {
+    StatusBlock* shared;
+    volatile int stop;
+    unsigned int writes;
+} StatusWriter;
+
+static void* statusWriterThread(void* param) {
+    StatusWriter* w = (StatusWriter*)param;
+    while (!w->stop) {
+        statusSeqBegin(w->shared);
+        fillStatus(w->shared, ++w->writes);
+        statusSeqEnd(w->shared);
+    }
+    return NULL;
+}
+
+static void testStatusReadNoTears(void) {
+    static StatusBlock shared, copy;
+    memset(&shared, 0, sizeof(shared));
+    fillStatus(&shared, 0);
+    StatusWriter w = { &shared, 0, 0 };
+    pthread_t thread;
+    pthread_create(&thread, NULL, statusWriterThread, &w);
+    
+    int torn = 0;
+    unsigned int last = 0;
+    int monotonic = 1;
+    for (int reads = 0; reads < STATUS_READS; ) {
+        if (!statusRead(&shared, &copy)) continue;
+        reads++;
+        if (!statusConsistent(&copy)) torn++;
+        if (copy.pid < last) monotonic = 0;
+        last = copy.pid;
+    }
+    w.stop = 1;
+    pthread_join(thread, NULL);
+    
+    CHECK(torn == 0);
+    CHECK(monotonic);
+    CHECK(statusRead(&shared, &copy) && copy.pid == w.writes);
+}
+
+/* ========== Log Ring Tests ========== */
+#define TEST_RING_SLOTS 8
+
+static void pushLine(LogRing* r, const char* text) {
+    LONG ticket = logRingClaim(r);
+    logRingPublish(r, ticket, text);
+}
+
+/* Tickets run past the slot count and reuse slots in order */
+static void testLogRingWraparound(void) {
+    LogSlot slots[TEST_RING_SLOTS];
+    LogRing r;
+    logRingInit(&r, slots, TEST_RING_SLOTS);
+    CHECK(logRingPeek(&r) == NULL);
+    
+    char text[32];
+    int ok = 1;
+    for (int i = 0; i < TEST_RING_SLOTS * 5 + 3; i++) {
+        snprintf(text, sizeof(text), "line %d", i);
+        pushLine(&r, text);
+        const char* got = logRingPeek(&r);
+        if (!got || strcmp(got, text) != 0) ok = 0;
+        logRingPop(&r);
+        if (logRingPeek(&r) != NULL) ok = 0;
+    }
+    CHECK(ok);
+    CHECK(r.head == TEST_RING_SLOTS * 5 + 3 && r.tail == r.head);
+}
+
+/* A full ring hands out tickets whose slot isn't free until the consumer
+ * pops the line still in it; published lines are never overwritten */
+static void testLogRingOverflow(void) {
+    LogSlot slots[TEST_RING_SLOTS];
+    LogRing r;
+    logRingInit(&r, slots, TEST_RING_SLOTS);
+    
+    char text[32];
+    for (int i = 0; i < TEST_RING_SLOTS; i++) {
+        LONG ticket = logRingClaim(&r);
+        CHECK(logRingSlotFree(&r, ticket));
+        snprintf(text, sizeof(text), "line %d", i);
+        logRingPublish(&r, ticket, text);
+    }
+    LONG late = logRingClaim(&r);
+    CHECK(!logRingSlotFree(&r, late));
+    CHECK(logRingPeek(&r) && strcmp(logRingPeek(&r), "line 0") == 0);
+    
+    logRingPop(&r);
+    CHECK(logRingSlotFree(&r, late));
+    logRingPublish(&r, late, "late");
+    
+    /* Order is ticket order, the late line last */
+    int ok = 1;
+    for (int i = 1; i < TEST_RING_SLOTS; i++) {
+        snprintf(text, sizeof(text), "line %d", i);
+        const char* got = logRingPeek(&r);
+        if (!got || strcmp(got, text) != 0) ok = 0;
+        logRingPop(&r);
+    }
+    CHECK(ok);
+    CHECK(logRingPeek(&r) && strcmp(logRingPeek(&r), "late") == 0);
+    logRingPop(&r);
+    CHECK(logRingPeek(&r) == NULL);
+}
+
+/* Over-long lines are cut at LOG_LINE_MAX - 1 */
+static void testLogRingTruncates(void) {
+    LogSlot slots[TEST_RING_SLOTS];
+    LogRing r;
+    logRingInit(&r, slots, TEST_RING_SLOTS);
+    char longLine[LOG_LINE_MAX * 2];
+    memset(longLine, 'x', sizeof(longLine) - 1);
+    longLine[sizeof(longLine) - 1] = '\0';
+    pushLine(&r, longLine);
+    CHECK(strlen(logRingPeek(&r)) == LOG_LINE_MAX - 1);
+}
+
+/* Producers racing on a small ring against one consumer: every line arrives
+ * exactly once and each producer's lines stay in order */
+#define RING_PRODUCERS      4
+#define RING_LINES_EACH     20000
+
+typedef struct {
+    LogRing* ring;
+    int id;
+} RingProducer;
+
+static void* ringProducerThread(void* param) {
+    RingProducer* p = (RingProducer*)param;
+    char text[32];
+    for (int i = 0; i < RING_LINES_EACH; i++) {
+        snprintf(text, sizeof(text), "%d %d", p->id, i);
+        LONG ticket = logRingClaim(p->ring);
+        while (!logRingSlotFree(p->ring, ticket)) sched_yield();
+        logRingPublish(p->ring, ticket, text);
+    }
+    return NULL;
+}
+
+static void testLogRingProducers(void) {
+    LogSlot slots[TEST_RING_SLOTS];
+    LogRing r;
+    logRingInit(&r, slots, TEST_RING_SLOTS);
+    
+    pthread_t threads[RING_PRODUCERS];
+    RingProducer producers[RING_PRODUCERS];
+    for (int i = 0; i < RING_PRODUCERS; i++) {
+        producers[i].ring = &r;
+        producers[i].id = i;
+        pthread_create(&threads[i], NULL, ringProducerThread, &producers[i]);
+    }
+    
+    int next[RING_PRODUCERS] = {0};
+    int ordered = 1;
+    for (int received = 0; received < RING_PRODUCERS * RING_LINES_EACH; ) {
+        const char* text = logRingPeek(&r);
+        if (!text) {
+            sched_yield();
+            continue;
+        }
+        int id = -1, seq = -1;
+        if (sscanf(text, "%d %d", &id, &seq) != 2 || id < 0 || id >= RING_PRODUCERS || seq != next[id]) {
+            ordered = 0;
+        } else {
+            next[id]++;
+        }
+        logRingPop(&r);
+        received++;
+    }
+    for (int i = 0; i < RING_PRODUCERS; i++) pthread_join(threads[i], NULL);
+    
+    CHECK(ordered);
+    for (int i = 0; i < RING_PRODUCERS; i++) CHECK(next[i] == RING_LINES_EACH);
+    CHECK(logRingPeek(&r) == NULL);
+}
+
+/* ========== Journal Parsing Tests ========== */
+#define JOURNAL_TEXT(s) (s), sizeof(s) - 1
+
+static void testJournalWhole(void) {
+    static JournalRecords r;
+    const char text[] =
+        "run full-reset\n"
+        "volume 0.7500 {0.0.0.00000000}.{aaaa}\n"
+        "step discover\n"
+        "volume 1.0000 {0.0.0.00000000}.{bbbb}\n"
+        "step kill\n";
+    CHECK(journalParse(JOURNAL_TEXT(text), &r));
+    CHECK(strcmp(r.graph, "full-reset") == 0);
+    CHECK(r.stepCount == 2 && strcmp(r.steps[0], "discover") == 0 && strcmp(r.steps[1], "kill") == 0);
+    CHECK(r.volumeCount == 2);
+    CHECK(r.volumes[0].level == 0.75f && strcmp(r.volumes[0].id, "{0.0.0.00000000}.{aaaa}") == 0);
+    CHECK(r.volumes[1].level == 1.0f && strcmp(r.volumes[1].id, "{0.0.0.00000000}.{bbbb}") == 0);
+    CHECK(r.validLen == sizeof(text) - 1);
+}
+
+/* A record cut off mid-write is ignored and excluded from validLen, wherever
+ * the cut falls */
+static void testJournalTornLine(void) {
+    static JournalRecords r;
+    const char text[] = "run full-reset\nstep discover\nstep kill\n";
+    size_t whole = strlen("run full-reset\nstep discover\n");
+    int ok = 1;
+    for (size_t cut = whole + 1; cut < sizeof(text) - 1; cut++) {
+        journalParse(text, cut, &r);
+        if (r.stepCount != 1 || strcmp(r.steps[0], "discover") != 0 || r.validLen != whole) ok = 0;
+    }
+    CHECK(ok);
+    
+    /* Cut inside the run record: nothing to resume */
+    CHECK(!journalParse(text, 5, &r));
+    CHECK(r.validLen == 0);
+    
+    /* A torn volume record doesn't yield a half-written ID */
+    const char vol[] = "run full-reset\nvolume 0.5000 {0.0.0.0000";
+    journalParse(JOURNAL_TEXT(vol), &r);
+    CHECK(r.volumeCount == 0);
+}
+
+/* Zeros where the last writes never landed end the journal like a torn line */
+static void testJournalZeroTail(void) {
+    static JournalRecords r;
+    char text[64] = "run full-reset\nstep discover\n";
+    size_t whole = strlen(text);
+    memset(text + whole, 0, 16);
+    text[whole + 16] = '\n';
+    memcpy(text + whole + 17, "step kill\n", 10);
+    CHECK(journalParse(text, whole + 27, &r));
+    CHECK(r.stepCount == 1);
+    CHECK(r.validLen == whole);
+}
+
+/* After a resume cut the torn line off, the appended records parse again */
+static void testJournalResumeAfterTear(void) {
+    static JournalRecords r;
+    char text[256] = "run full-reset\nstep discover\nstep ki";
+    journalParse(text, strlen(text), &r);
+    size_t valid = r.validLen;
+    strcpy(text + valid, "resume\nstep kill\n");
+    CHECK(journalParse(text, strlen(text), &r));
+    CHECK(r.stepCount == 2 && strcmp(r.steps[1], "kill") == 0);
+    CHECK(r.validLen == strlen(text));
+}
+
+/* Unknown and over-long lines are skipped, malformed volumes dropped, and
+ * the step and volume tables stop at their size */
+static void testJournalLimits(void) {
+    static JournalRecords r;
+    static char text[(MAX_JOURNAL_STEPS + 8) * 16 + JOURNAL_LINE_MAX * 2];
+    size_t len = 0;
+    len += (size_t)sprintf(text + len, "run full-reset\nfuture-record x\nvolume abc {id}\nvolume 0.5\n");
+    memset(text + len, 'x', JOURNAL_LINE_MAX + 10);
+    len += JOURNAL_LINE_MAX + 10;
+    text[len++] = '\n';
+    for (int i = 0; i < MAX_JOURNAL_STEPS + 8; i++) len += (size_t)sprintf(text + len, "step s%d\n", i);
+    
+    CHECK(journalParse(text, len, &r));
+    CHECK(r.volumeCount == 0);
+    CHECK(r.stepCount == MAX_JOURNAL_STEPS);
+    CHECK(strcmp(r.steps[MAX_JOURNAL_STEPS - 1], "s31") == 0);
+    CHECK(r.validLen == len);
+}
+
+/* ========== Scripted Device Event Source ========== */
+/* A DeviceEventSource on virtual time. Each script entry turns one endpoint
+ * on or off at a given millisecond; waitChange() jumps the clock to the next
+ * entry (a notification) or to the timeout, and refresh() applies everything
+ * due by then. */
+#define SCRIPT_MAX  16
+#define FAKE_DEVICES 8
+
+typedef struct ScriptedEvent {
+    DWORD atMs;
+    int device;
+    int active;
+} ScriptedEvent;
+
+typedef struct FakeDevice {
+    const WCHAR* id;
+    const WCHAR* name;
+    int dataFlow;
+    int active;             /* Live state */
+    int seen;               /* As of the last refresh */
+} FakeDevice;
+
+typedef struct ScriptedSource {
+    DeviceEventSource base;
+    FakeDevice devices[FAKE_DEVICES];
+    int deviceCount;
+    ScriptedEvent script[SCRIPT_MAX];
+    int scriptCount;
+    int nextEvent;
+    DWORD now;
+    int canSubscribe;
+    int subscribed;
+    int refreshes;
+    int wakeups;            /* waitChange() calls that ended in a notification */
+    int waits;
+} ScriptedSource;
+
+static void scriptedApplyDue(ScriptedSource* s) {
+    while (s->nextEvent < s->scriptCount && s->script[s->nextEvent].atMs <= s->now) {
+        const ScriptedEvent* e = &s->script[s->nextEvent++];
+        s->devices[e->device].active = e->active;
+    }
+}
+
+static int scripted_subscribe(DeviceEventSource* self) {
+    ScriptedSource* s = (ScriptedSource*)self;
+    s->subscribed = s->canSubscribe;
+    return s->subscribed;
+}
+
+static void scripted_unsubscribe(DeviceEventSource* self) {
+    ((ScriptedSource*)self)->subscribed = 0;
+}
+
+static void scripted_refresh(DeviceEventSource* self) {
+    ScriptedSource* s = (ScriptedSource*)self;
+    scriptedApplyDue(s);
+    for (int i = 0; i < s->deviceCount; i++) s->devices[i].seen = s->devices[i].active;
+    s->refreshes++;
+}
+
+static int scripted_isDeviceActive(DeviceEventSource* self, const WCHAR* id, const WCHAR* name, int dataFlow) {
+    ScriptedSource* s = (ScriptedSource*)self;
+    for (int i = 0; i < s->deviceCount; i++) {
+        const FakeDevice* d = &s->devices[i];
+        if (!d->seen) continue;
+        if (id && id[0] && d->id && wcscmp(d->id, id) == 0) return 1;
+        if (d->dataFlow == dataFlow && wcscmp(d->name, name) == 0) return 1;
+    }
+    return 0;
+}
+
+static DWORD scripted_now(DeviceEventSource* self) {
+    return ((ScriptedSource*)self)->now;
+}
+
+static int scripted_waitChange(DeviceEventSource* self, DWORD timeoutMs) {
+    ScriptedSource* s = (ScriptedSource*)self;
+    DWORD deadline = s->now + timeoutMs;
+    s->waits++;
+    if (s->subscribed && s->nextEvent < s->scriptCount && s->script[s->nextEvent].atMs <= deadline) {
+        if (s->script[s->nextEvent].atMs > s->now) s->now = s->script[s->nextEvent].atMs;
+        s->wakeups++;
+        return 1;
+    }
+    s->now = deadline;
+    return 0;
+}
+
+static void initScriptedSource(ScriptedSource* s) {
+    memset(s, 0, sizeof(*s));
+    s->base.subscribe = scripted_subscribe;
+    s->base.unsubscribe = scripted_unsubscribe;
+    s->base.refresh = scripted_refresh;
+    s->base.isDeviceActive = scripted_isDeviceActive;
+    s->base.now = scripted_now;
+    s->base.waitChange = scripted_waitChange;
+    s->canSubscribe = 1;
+}
+
+static int scriptedAddDevice(ScriptedSource* s, const WCHAR* id, const WCHAR* name, int dataFlow, int active) {
+    FakeDevice* d = &s->devices[s->deviceCount];
+    d->id = id;
+    d->name = name;
+    d->dataFlow = dataFlow;
+    d->active = active;
+    return s->deviceCount++;
+}
+
+static void scriptedAt(ScriptedSource* s, DWORD atMs, int device, int active) {
+    ScriptedEvent* e = &s->script[s->scriptCount++];
+    e->atMs = atMs;
+    e->device = device;
+    e->active = active;
+}
+
+/* The four configured roles of a typical setup */
+static const ReadyTarget g_targets[] = {
+    { L"{render-system}", L"System (Elgato Virtual Audio)",     DEVICE_FLOW_RENDER,  "Playback default" },
+    { L"{render-chat}",   L"Voice Chat (Elgato Virtual Audio)", DEVICE_FLOW_RENDER,  "Playback comms" },
+    { L"{capture-mic}",   L"Microphone (Headset)",              DEVICE_FLOW_CAPTURE, "Recording default" },
+    { L"{capture-mic}",   L"Microphone (Headset)",              DEVICE_FLOW_CAPTURE, "Recording comms" },
+};
+#define TARGET_COUNT 4
+
+static void addTargetDevices(ScriptedSource* s, int active) {
+    scriptedAddDevice(s, L"{render-system}", L"System (Elgato Virtual Audio)", DEVICE_FLOW_RENDER, active);
+    scriptedAddDevice(s, L"{render-chat}", L"Voice Chat (Elgato Virtual Audio)", DEVICE_FLOW_RENDER, active);
+    scriptedAddDevice(s, L"{capture-mic}", L"Microphone (Headset)", DEVICE_FLOW_CAPTURE, active);
+}
+
+static WaitBudget testBudget(DWORD timeoutMs, DWORD p50Ms) {
+    WaitBudget b = { timeoutMs, p50Ms, 2000, p50Ms != 0 };
+    return b;
+}
+
+/* ========== Device Readiness Tests ========== */
+static void testReadyAtOnce(void) {
+    ScriptedSource s;
+    initScriptedSource(&s);
+    addTargetDevices(&s, 1);
+    WaitBudget b = testBudget(60000, 0);
+    DWORD elapsed = 1;
+    
+    CHECK(waitForDevicesReady(&s.base, g_targets, TARGET_COUNT, &b, &elapsed) == 1);
+    CHECK(elapsed == 0);
+    CHECK(s.refreshes == 1);
+    CHECK(s.waits == 0);
+    CHECK(!s.subscribed);
+}
+
+/* Woken once per arrival, done the moment the last one is active */
+static void testWakesOnArrivals(void) {
+    ScriptedSource s;
+    initScriptedSource(&s);
+    addTargetDevices(&s, 0);
+    scriptedAt(&s, 400, 2, 1);
+    scriptedAt(&s, 1500, 0, 1);
+    scriptedAt(&s, 3200, 1, 1);
+    WaitBudget b = testBudget(60000, 0);
+    DWORD elapsed = 0;
+    
+    CHECK(waitForDevicesReady(&s.base, g_targets, TARGET_COUNT, &b, &elapsed) == 1);
+    CHECK(elapsed == 3200);
+    CHECK(s.wakeups == 3);
+    CHECK(s.refreshes == 4);
+    CHECK(!s.subscribed);
+}
+
+/* An endpoint that flaps off again before the rest arrive isn't counted */
+static void testFlappingEndpoint(void) {
+    ScriptedSource s;
+    initScriptedSource(&s);
+    addTargetDevices(&s, 0);
+    scriptedAt(&s, 100, 0, 1);
+    scriptedAt(&s, 200, 2, 1);
+    scriptedAt(&s, 300, 0, 0);
+    scriptedAt(&s, 500, 1, 1);
+    scriptedAt(&s, 900, 0, 1);
+    WaitBudget b = testBudget(60000, 0);
+    DWORD elapsed = 0;
+    
+    CHECK(waitForDevicesReady(&s.base, g_targets, TARGET_COUNT, &b, &elapsed) == 1);
+    CHECK(elapsed == 900);
+}
+
+/* A device that never shows runs out the budget exactly */
+static void testTimesOut(void) {
+    ScriptedSource s;
+    initScriptedSource(&s);
+    addTargetDevices(&s, 0);
+    scriptedAt(&s, 100, 0, 1);
+    scriptedAt(&s, 200, 2, 1);
+    WaitBudget b = testBudget(5000, 0);
+    DWORD elapsed = 0;
+    
+    CHECK(waitForDevicesReady(&s.base, g_targets, TARGET_COUNT, &b, &elapsed) == 0);
+    CHECK(elapsed == 5000);
+    CHECK(countMissingDevices(&s.base, g_targets, TARGET_COUNT) == 1);
+}
+
+/* Stored IDs win over names; an empty name means the role isn't configured */
+static void testMatchesByIdAndSkipsUnset(void) {
+    ScriptedSource s;
+    initScriptedSource(&s);
+    scriptedAddDevice(&s, L"{render-system}", L"Renamed by the driver", DEVICE_FLOW_RENDER, 1);
+    scriptedAddDevice(&s, L"{other}", L"Voice Chat (Elgato Virtual Audio)", DEVICE_FLOW_RENDER, 1);
+    const ReadyTarget targets[] = {
+        { L"{render-system}", L"System (Elgato Virtual Audio)",     DEVICE_FLOW_RENDER,  "Playback default" },
+        { L"",                L"Voice Chat (Elgato Virtual Audio)", DEVICE_FLOW_RENDER,  "Playback comms" },
+        { L"",                L"Voice Chat (Elgato Virtual Audio)", DEVICE_FLOW_CAPTURE, "Wrong flow" },
+        { L"",                L"",                                  DEVICE_FLOW_CAPTURE, "Unset" },
+    };
+    
+    CHECK(countMissingDevices(&s.base, targets, 4) == 1);
+    CHECK(countMissingDevices(&s.base, targets, 3) == 1);
+    CHECK(countMissingDevices(&s.base, targets, 2) == 0);
+}
+
+/* Without notifications the waiter polls on the budget's schedule: coarse
+ * without history, finely around the usual p50 with it */
+static void testPollsWithoutNotifications(void) {
+    ScriptedSource s;
+    initScriptedSource(&s);
+    s.canSubscribe = 0;
+    addTargetDevices(&s, 0);
+    scriptedAt(&s, 0, 0, 1);
+    scriptedAt(&s, 0, 2, 1);
+    scriptedAt(&s, 3100, 1, 1);
+    WaitBudget coarse = testBudget(60000, 0);
+    DWORD elapsed = 0;
+    
+    CHECK(waitForDevicesReady(&s.base, g_targets, TARGET_COUNT, &coarse, &elapsed) == 1);
+    CHECK(elapsed == 4000);
+    CHECK(s.wakeups == 0);
+    
+    initScriptedSource(&s);
+    s.canSubscribe = 0;
+    addTargetDevices(&s, 0);
+    scriptedAt(&s, 0, 0, 1);
+    scriptedAt(&s, 0, 2, 1);
+    scriptedAt(&s, 3100, 1, 1);
+    WaitBudget learned = testBudget(60000, 3000);
+    
+    CHECK(waitForDevicesReady(&s.base, g_targets, TARGET_COUNT, &learned, &elapsed) == 1);
+    CHECK(elapsed >= 3100 && elapsed <= 3100 + 150);
+}
+
+/* ========== Reset Graph Tests ========== */
+/* These run the real graphs and the escalation loop on sim_platform.h */
+static void testResetGraphsValid(void) {
+    for (int t = 0; t < TIER_COUNT; t++) {
+        CHECK(schedulerValidate(g_resetTiers[t].steps, g_resetTiers[t].count));
+        CHECK(findTier(g_resetTiers[t].name) == &g_resetTiers[t]);
+    }
+    CHECK(FULL_RESET_TIER->steps == g_resetSteps);
+    CHECK(findTier("unknown") == NULL);
+}
+
+/* The full reset fixes every fault, well inside the device wait */
+static void testSimFullReset(void) {
+    for (int fault = 0; fault < FAULT_COUNT; fault++) {
+        SimPlatform sim;
+        initSimPlatform(&sim, &g_simProfiles[SIM_TYPICAL], fault, 7);
+        DWORD took = simRunSteps(&sim, g_resetSteps, STEP_COUNT);
+        CHECK(simHealthy(&sim));
+        CHECK(took > 0 && took < SIM_DEVICE_WAIT_MS);
+        CHECK(sim.appRunningAt[APP_STREAMDECK] != SIM_NEVER);
+    }
+}
+
+/* Each fault is fixed by its own tier, not an earlier one */
+static void testSimEscalationTiers(void) {
+    for (int fault = 0; fault < FAULT_COUNT; fault++) {
+        SimPlatform sim;
+        initSimPlatform(&sim, &g_simProfiles[SIM_TYPICAL], fault, 11);
+        CHECK(resetEscalate(&sim.base, simRunTier) == fault);
+        CHECK(simHealthy(&sim));
+    }
+}
+
+/* Same seed, same draws: only audiosrv's start (900 -> 4000 ms, +/- 30%) differs */
+static void testSimSlowAudioSrv(void) {
+    SimPlatform typical, slow;
+    initSimPlatform(&typical, &g_simProfiles[SIM_TYPICAL], FAULT_DEFAULTS, 3);
+    initSimPlatform(&slow, &g_simProfiles[SIM_SLOW_AUDIOSRV], FAULT_DEFAULTS, 3);
+    DWORD typicalMs = simRunSteps(&typical, g_resetSteps, STEP_COUNT);
+    DWORD slowMs = simRunSteps(&slow, g_resetSteps, STEP_COUNT);
+    CHECK(slowMs > typicalMs + 2000);
+    CHECK(simHealthy(&slow));
+}
+
+/* A device that never comes back: the full reset waits out the device wait
+ * and every tier fails verification */
+static void testSimMissingEndpoint(void) {
+    SimPlatform sim;
+    initSimPlatform(&sim, &g_simProfiles[SIM_NO_VOICE_CHAT], FAULT_DEFAULTS, 5);
+    CHECK(simRunSteps(&sim, g_resetSteps, STEP_COUNT) >= SIM_DEVICE_WAIT_MS);
+    CHECK(!simHealthy(&sim));
+    
+    initSimPlatform(&sim, &g_simProfiles[SIM_NO_VOICE_CHAT], FAULT_DEFAULTS, 5);
+    CHECK(resetEscalate(&sim.base, simRunTier) == -1);
+}
+
+/* ========== Main ========== */
+int main(void) {
+    testBudgetNeedsHistory();
+    testBudgetPercentiles();
+    testBudgetClamps();
+    testBudgetPollSchedule();
+    testGraphValidation();
+    testGraphPickOrder();
+    testGraphSkip();
+    testGraphOnWorkers();
+    testJobQueueIdle();
+    testJobQueueFoldsIntoRunning();
+    testJobQueueCollapsesPending();
+    testJobCovers();
+    testStatusReadStable();
+    testStatusTearDetected();
+    testStatusReadGivesUp();
+    testStatusReadNoTears();
+    testLogRingWraparound();
+    testLogRingOverflow();
+    testLogRingTruncates();
+    testLogRingProducers();
+    testJournalWhole();
+    testJournalTornLine();
+    testJournalZeroTail();
+    testJournalResumeAfterTear();
+    testJournalLimits();
+    testReadyAtOnce();
+    testWakesOnArrivals();
+    testFlappingEndpoint();
+    testTimesOut();
+    testMatchesByIdAndSkipsUnset();
+    testPollsWithoutNotifications();
+    testResetGraphsValid();
+    testSimFullReset();
+    testSimEscalationTiers();
+    testSimSlowAudioSrv();
+    testSimMissingEndpoint();
+    
+    printf("%d checks, %d failed\n", g_checks, g_failures);
+    return g_failures ? 1 : 0;
+}
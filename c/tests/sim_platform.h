@@ -0,0 +1,415 @@
+/*
+ * sim_platform.h - A simulated machine for the reset graphs in reset_core.h
+ *
+ * SimPlatform implements Platform on a virtual clock: every operation moves
+ * the clock by a latency drawn from a profile with seeded jitter, and waits
+ * jump straight to whatever they were waiting for. Profiles inject failures
+ * ("audiosrv takes 4 s to start", "WaveLink never creates the Voice Chat
+ * endpoint"), and every run starts from one of a few broken states, so the
+ * escalation tiers have something to fix. Used by reset_core_test.c and by
+ * reset_bench.c.
+ */
+#ifndef SIM_PLATFORM_H
+#define SIM_PLATFORM_H
+
+#include "reset_core.h"
+
+/* ========== Simulated Machine ========== */
+#define SIM_NEVER           0xFFFFFFFFu
+#define SIM_DEVICE_WAIT_MS  60000   /* MAX_DEVICE_WAIT */
+#define SIM_SERVICE_WAIT_MS 30000   /* MAX_SERVICE_WAIT */
+#define SIM_SETTLE_MS       2000    /* SETTLE_TIME */
+#define SIM_SETTLE_QUIET_MS 300     /* SETTLE_QUIET_MS */
+#define SIM_POLL_MS         1000
+
+enum { SVC_AUDIOSRV, SVC_ENDPOINT_BUILDER, SVC_COUNT };
+enum { ROLE_PLAYBACK_DEFAULT, ROLE_PLAYBACK_COMM, ROLE_RECORD_DEFAULT, ROLE_RECORD_COMM, ROLE_COUNT };
+
+/* What is wrong before the reset; each tier fixes one more of these */
+enum {
+    FAULT_DEFAULTS,         /* Defaults point elsewhere: apply-defaults */
+    FAULT_WAVELINK,         /* WaveLink lost its endpoints: restart-wavelink */
+    FAULT_AUDIOSRV,         /* audiosrv is wedged: restart-audiosrv */
+    FAULT_ENDPOINT_BUILDER, /* The endpoint builder is wedged: only the full reset */
+    FAULT_COUNT
+};
+
+/* Playback roles are WaveLink's virtual endpoints; recording roles are hardware */
+static const int g_simRoleIsVirtual[ROLE_COUNT] = { 1, 1, 0, 0 };
+static const WCHAR* const g_simRoleNames[ROLE_COUNT] = {
+    L"System (Elgato Wave:3)", L"Voice Chat (Elgato Wave:3)", L"Elgato Wave:3", L"Elgato Wave:3",
+};
+
+typedef struct SimProfile {
+    const char* name;
+    DWORD registryMs;               /* One discovery pass */
+    DWORD snapshotMs;               /* One process snapshot */
+    DWORD audioCallMs;              /* One COM round-trip */
+    DWORD enumerateMs;              /* Full endpoint enumeration */
+    DWORD processStopMs;            /* One process, close to exit */
+    DWORD serviceStopMs[SVC_COUNT];
+    DWORD serviceStartMs[SVC_COUNT];
+    DWORD appStartMs[APP_COUNT];    /* CreateProcess -> up */
+    DWORD windowMs;                 /* StreamDeck up -> main window */
+    DWORD hardwareEndpointMs;       /* Services up -> physical endpoints active */
+    DWORD virtualEndpointMs;        /* WaveLink up -> its endpoints active */
+    double jitter;                  /* Each latency varies by +/- this fraction */
+    int roleNeverAppears;           /* ROLE_* whose device never comes back, or -1 */
+} SimProfile;
+
+enum { SIM_TYPICAL, SIM_SLOW_AUDIOSRV, SIM_SLOW_MACHINE, SIM_NO_VOICE_CHAT };  /* Order of g_simProfiles */
+
+static const SimProfile g_simProfiles[] = {
+    { "typical",       60, 15, 3, 25, 400, { 600, 400 }, { 900, 700 },  { 1500, 2500, 3000 }, 2500,
+      500, 1500, 0.3, -1 },
+    { "slow-audiosrv", 60, 15, 3, 25, 400, { 600, 400 }, { 4000, 700 }, { 1500, 2500, 3000 }, 2500,
+      500, 1500, 0.3, -1 },
+    { "slow-machine", 150, 40, 8, 80, 900, { 1500, 1000 }, { 2500, 1800 }, { 4000, 6000, 8000 }, 6000,
+      1500, 4000, 0.4, -1 },
+    { "no-voice-chat", 60, 15, 3, 25, 400, { 600, 400 }, { 900, 700 },  { 1500, 2500, 3000 }, 2500,
+      500, 1500, 0.3, ROLE_PLAYBACK_COMM },
+};
+#define SIM_PROFILE_COUNT ((int)(sizeof(g_simProfiles) / sizeof(g_simProfiles[0])))
+
+typedef struct SimPlatform SimPlatform;
+
+typedef struct SimDeviceSource {
+    DeviceEventSource base;
+    SimPlatform* sim;
+    DWORD refreshedAt;
+} SimDeviceSource;
+
+/* Machine state is kept as the times things happen (SIM_NEVER = not until
+ * something else changes it), so a step that starts later on the virtual
+ * clock sees what earlier steps set in motion. */
+struct SimPlatform {
+    Platform base;
+    SimDeviceSource devices;
+    const SimProfile* profile;
+    unsigned int rng;
+    DWORD now;
+    DWORD serviceRunningAt[SVC_COUNT];
+    DWORD appRunningAt[APP_COUNT];
+    DWORD hardwareDelay;            /* Drawn when the services start */
+    DWORD virtualDelay;             /* Drawn when WaveLink starts */
+    int waveLinkWedged;             /* Cleared when WaveLink is stopped */
+    int serviceWedged[SVC_COUNT];   /* Cleared when the service is restarted */
+    int defaultsSet;                /* Cleared whenever endpoints go away */
+};
+
+/* xorshift32 - small, fast and reproducible across compilers */
+static inline double simRandom(SimPlatform* sp) {
+    sp->rng ^= sp->rng << 13;
+    sp->rng ^= sp->rng >> 17;
+    sp->rng ^= sp->rng << 5;
+    return (sp->rng & 0xFFFFFF) / (double)0x1000000;
+}
+
+static inline DWORD simLatency(SimPlatform* sp, DWORD ms) {
+    return (DWORD)(ms * (1.0 + sp->profile->jitter * (2.0 * simRandom(sp) - 1.0)));
+}
+
+static inline void simSpend(SimPlatform* sp, DWORD ms) {
+    sp->now += simLatency(sp, ms);
+}
+
+static inline DWORD simMax(DWORD a, DWORD b) {
+    return a > b ? a : b;
+}
+
+static inline DWORD simRoleActiveAt(const SimPlatform* sp, int role) {
+    if (role == sp->profile->roleNeverAppears) return SIM_NEVER;
+    if (sp->serviceWedged[SVC_AUDIOSRV] || sp->serviceWedged[SVC_ENDPOINT_BUILDER]) return SIM_NEVER;
+    DWORD servicesUp = simMax(sp->serviceRunningAt[SVC_AUDIOSRV], sp->serviceRunningAt[SVC_ENDPOINT_BUILDER]);
+    if (servicesUp == SIM_NEVER) return SIM_NEVER;
+    if (!g_simRoleIsVirtual[role]) return servicesUp + sp->hardwareDelay;
+    if (sp->waveLinkWedged || sp->appRunningAt[APP_WAVELINK] == SIM_NEVER) return SIM_NEVER;
+    return simMax(servicesUp, sp->appRunningAt[APP_WAVELINK]) + sp->virtualDelay;
+}
+
+static inline int simAllRolesActive(const SimPlatform* sp, DWORD at) {
+    for (int r = 0; r < ROLE_COUNT; r++) {
+        if (simRoleActiveAt(sp, r) > at) return 0;
+    }
+    return 1;
+}
+
+/* What verification would find right now, without spending any time */
+static inline int simHealthy(const SimPlatform* sp) {
+    return sp->defaultsSet && simAllRolesActive(sp, sp->now);
+}
+
+/* The next endpoint arrival after the current time, or SIM_NEVER */
+static inline DWORD simNextArrival(const SimPlatform* sp) {
+    DWORD next = SIM_NEVER;
+    for (int r = 0; r < ROLE_COUNT; r++) {
+        DWORD at = simRoleActiveAt(sp, r);
+        if (at > sp->now && at < next) next = at;
+    }
+    return next;
+}
+
+/* ========== Simulated Device Events ========== */
+/* The DeviceEventSource that waitForDevicesReady() runs on in sim_waitDevices */
+static inline int simSource_subscribe(DeviceEventSource* self) {
+    (void)self;
+    return 1;
+}
+
+static inline void simSource_unsubscribe(DeviceEventSource* self) {
+    (void)self;
+}
+
+static inline void simSource_refresh(DeviceEventSource* self) {
+    SimDeviceSource* src = (SimDeviceSource*)self;
+    simSpend(src->sim, src->sim->profile->enumerateMs);
+    src->refreshedAt = src->sim->now;
+}
+
+static inline int simSource_isDeviceActive(DeviceEventSource* self, const WCHAR* id, const WCHAR* name, int dataFlow) {
+    SimDeviceSource* src = (SimDeviceSource*)self;
+    (void)id;
+    for (int r = 0; r < ROLE_COUNT; r++) {
+        int flow = r < ROLE_RECORD_DEFAULT ? DEVICE_FLOW_RENDER : DEVICE_FLOW_CAPTURE;
+        if (flow == dataFlow && wcscmp(g_simRoleNames[r], name) == 0) {
+            return simRoleActiveAt(src->sim, r) <= src->refreshedAt;
+        }
+    }
+    return 0;
+}
+
+static inline DWORD simSource_now(DeviceEventSource* self) {
+    return ((SimDeviceSource*)self)->sim->now;
+}
+
+/* Jump to the next endpoint arrival, like a notification wake-up */
+static inline int simSource_waitChange(DeviceEventSource* self, DWORD timeoutMs) {
+    SimPlatform* sp = ((SimDeviceSource*)self)->sim;
+    DWORD next = simNextArrival(sp);
+    DWORD deadline = sp->now + timeoutMs;
+    sp->now = next < deadline ? next : deadline;
+    return next < deadline;
+}
+
+/* ========== Simulated Platform ========== */
+static inline DWORD sim_now(Platform* self) {
+    return ((SimPlatform*)self)->now;
+}
+
+static inline void sim_log(Platform* self, const char* line) {
+    (void)self;
+    (void)line;
+}
+
+static inline void sim_discoverPaths(Platform* self) {
+    SimPlatform* sp = (SimPlatform*)self;
+    simSpend(sp, sp->profile->registryMs);
+}
+
+static inline int sim_appInstalled(Platform* self, int app) {
+    (void)self;
+    (void)app;
+    return 1;
+}
+
+static inline int sim_stopProcesses(Platform* self, int set) {
+    SimPlatform* sp = (SimPlatform*)self;
+    int found = 0;
+    simSpend(sp, sp->profile->snapshotMs);
+    for (int app = 0; app < APP_COUNT; app++) {
+        if (set == STOP_WAVELINK && app == APP_STREAMDECK) continue;
+        if (sp->appRunningAt[app] == SIM_NEVER) continue;
+        found++;
+        sp->appRunningAt[app] = SIM_NEVER;
+    }
+    /* Processes are waited on together */
+    if (found) simSpend(sp, sp->profile->processStopMs);
+    if (sp->appRunningAt[APP_WAVELINK] == SIM_NEVER) {
+        sp->waveLinkWedged = 0;
+        sp->defaultsSet = 0;
+    }
+    return found;
+}
+
+static inline int sim_isAppRunning(Platform* self, int app) {
+    SimPlatform* sp = (SimPlatform*)self;
+    simSpend(sp, sp->profile->snapshotMs);
+    return sp->now >= sp->appRunningAt[app];
+}
+
+static inline int sim_launchApp(Platform* self, int app, DWORD timeoutMs) {
+    SimPlatform* sp = (SimPlatform*)self;
+    DWORD start = sp->now;
+    sp->appRunningAt[app] = start + simLatency(sp, sp->profile->appStartMs[app]);
+    if (app == APP_WAVELINK) sp->virtualDelay = simLatency(sp, sp->profile->virtualEndpointMs);
+    
+    DWORD readyAt = sp->appRunningAt[app];
+    if (app == APP_STREAMDECK) readyAt += simLatency(sp, sp->profile->windowMs);
+    if (readyAt - start > timeoutMs) {
+        sp->now = start + timeoutMs;
+        return 0;
+    }
+    sp->now = readyAt;
+    return 1;
+}
+
+static inline void sim_minimizeApp(Platform* self, int app) {
+    SimPlatform* sp = (SimPlatform*)self;
+    (void)app;
+    simSpend(sp, sp->profile->snapshotMs);
+}
+
+/* Stop audiosrv before the endpoint builder it depends on, start in reverse,
+ * waiting on each transition */
+static inline int sim_restartServices(Platform* self, int set) {
+    SimPlatform* sp = (SimPlatform*)self;
+    int count = set == SERVICES_AUDIOSRV ? 1 : SVC_COUNT;
+    for (int svc = 0; svc < count; svc++) {
+        sp->serviceRunningAt[svc] = SIM_NEVER;
+        simSpend(sp, sp->profile->serviceStopMs[svc]);
+    }
+    sp->defaultsSet = 0;
+    for (int svc = count - 1; svc >= 0; svc--) {
+        DWORD took = simLatency(sp, sp->profile->serviceStartMs[svc]);
+        if (took > SIM_SERVICE_WAIT_MS) {
+            sp->now += SIM_SERVICE_WAIT_MS;
+            return 0;
+        }
+        sp->now += took;
+        sp->serviceRunningAt[svc] = sp->now;
+        sp->serviceWedged[svc] = 0;
+    }
+    sp->hardwareDelay = simLatency(sp, sp->profile->hardwareEndpointMs);
+    return 1;
+}
+
+static inline void sim_lowerVolume(Platform* self) {
+    SimPlatform* sp = (SimPlatform*)self;
+    simSpend(sp, sp->profile->enumerateMs + 2 * ROLE_COUNT * sp->profile->audioCallMs);
+}
+
+static inline void sim_restoreVolume(Platform* self) {
+    SimPlatform* sp = (SimPlatform*)self;
+    simSpend(sp, ROLE_COUNT * sp->profile->audioCallMs);
+}
+
+static inline int sim_waitDevices(Platform* self) {
+    SimPlatform* sp = (SimPlatform*)self;
+    ReadyTarget targets[ROLE_COUNT];
+    for (int r = 0; r < ROLE_COUNT; r++) {
+        targets[r].id = L"";
+        targets[r].name = g_simRoleNames[r];
+        targets[r].dataFlow = r < ROLE_RECORD_DEFAULT ? DEVICE_FLOW_RENDER : DEVICE_FLOW_CAPTURE;
+        targets[r].label = "";
+    }
+    WaitBudget budget = { 0 };
+    budget.timeoutMs = SIM_DEVICE_WAIT_MS;
+    budget.pollMs = SIM_POLL_MS;
+    return waitForDevicesReady(&sp->devices.base, targets, ROLE_COUNT, &budget, NULL);
+}
+
+/* Returns once no endpoint has arrived for the quiet period, or the budget ran out */
+static inline void sim_waitSettle(Platform* self) {
+    SimPlatform* sp = (SimPlatform*)self;
+    DWORD deadline = sp->now + SIM_SETTLE_MS;
+    for (;;) {
+        DWORD next = simNextArrival(sp);
+        DWORD quietUntil = sp->now + SIM_SETTLE_QUIET_MS;
+        if (quietUntil >= deadline) {
+            sp->now = deadline;
+            return;
+        }
+        if (next >= quietUntil) {
+            sp->now = quietUntil;
+            return;
+        }
+        sp->now = next;
+    }
+}
+
+static inline int sim_setDefaults(Platform* self) {
+    SimPlatform* sp = (SimPlatform*)self;
+    simSpend(sp, sp->profile->enumerateMs + ROLE_COUNT * sp->profile->audioCallMs);
+    sp->defaultsSet = simAllRolesActive(sp, sp->now);
+    return sp->defaultsSet;
+}
+
+static inline int sim_verify(Platform* self) {
+    SimPlatform* sp = (SimPlatform*)self;
+    simSpend(sp, sp->profile->enumerateMs + sp->profile->snapshotMs + ROLE_COUNT * sp->profile->audioCallMs);
+    return simHealthy(sp);
+}
+
+static inline int sim_resuming(Platform* self) {
+    (void)self;
+    return 0;
+}
+
+/* A machine where everything has been running for a while, except for the
+ * one thing the fault breaks */
+static inline void initSimPlatform(SimPlatform* sp, const SimProfile* profile, int fault, unsigned int seed) {
+    static const Platform ops = {
+        sim_now, sim_log, sim_discoverPaths, sim_appInstalled, sim_stopProcesses, sim_isAppRunning,
+        sim_launchApp, sim_minimizeApp, sim_restartServices, sim_lowerVolume, sim_restoreVolume,
+        sim_waitDevices, sim_waitSettle, sim_setDefaults, sim_verify, sim_resuming,
+    };
+    static const DeviceEventSource sourceOps = {
+        simSource_subscribe, simSource_unsubscribe, simSource_refresh, simSource_isDeviceActive,
+        simSource_now, simSource_waitChange,
+    };
+    memset(sp, 0, sizeof(*sp));
+    sp->base = ops;
+    sp->devices.base = sourceOps;
+    sp->devices.sim = sp;
+    sp->profile = profile;
+    sp->rng = seed ? seed : 1;
+    sp->defaultsSet = 0;    /* Every fault leaves the defaults wrong */
+    if (fault == FAULT_WAVELINK) sp->waveLinkWedged = 1;
+    if (fault == FAULT_AUDIOSRV) sp->serviceWedged[SVC_AUDIOSRV] = 1;
+    if (fault == FAULT_ENDPOINT_BUILDER) sp->serviceWedged[SVC_ENDPOINT_BUILDER] = 1;
+}
+
+/* ========== Simulated Scheduler ========== */
+/* Run a graph the way runResetSteps() does - RESET_WORKERS workers, each
+ * taking the next ready step as soon as it is free - on the virtual clock.
+ * A step runs whole at its start time, so its changes are in place (with
+ * their future times) before a step that starts later looks at them. That
+ * holds for the reset graphs because a step only reads what its
+ * dependencies produced. Returns how long the graph took. */
+static inline DWORD simRunSteps(SimPlatform* sp, const ResetStep* steps, int count) {
+    StepGraph g;
+    int busy[RESET_WORKERS];
+    DWORD freeAt[RESET_WORKERS];
+    DWORD start = sp->now;
+    DWORD clock = start;
+    for (int w = 0; w < RESET_WORKERS; w++) busy[w] = -1;
+    stepGraphInit(&g, steps, count, 0);
+    
+    while (!stepGraphFinished(&g)) {
+        for (int w = 0; w < RESET_WORKERS; w++) {
+            if (busy[w] >= 0) continue;
+            int idx = stepGraphPick(&g);
+            if (idx < 0) break;
+            sp->now = clock;
+            steps[idx].run(&sp->base);
+            busy[w] = idx;
+            freeAt[w] = sp->now;
+        }
+        int next = -1;
+        for (int w = 0; w < RESET_WORKERS; w++) {
+            if (busy[w] >= 0 && (next < 0 || freeAt[w] < freeAt[next])) next = w;
+        }
+        if (next < 0) break;
+        clock = freeAt[next];
+        stepGraphFinish(&g, busy[next]);
+        busy[next] = -1;
+    }
+    sp->now = clock;
+    return clock - start;
+}
+
+static inline void simRunTier(Platform* p, int tier) {
+    simRunSteps((SimPlatform*)p, g_resetTiers[tier].steps, g_resetTiers[tier].count);
+}
+
+#endif /* SIM_PLATFORM_H */